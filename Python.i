@@ -19,8 +19,34 @@
 
 %{
 #include "sitkPyCommand.h"
+#include "sitkSharedMemoryImage.h"
+#include "sitkRawFileImage.h"
 %}
 
+// The raw file is read by the ITK threads, the GIL is released so that
+// other python threads run meanwhile. The python exception is set after
+// the GIL is acquired again.
+%exception itk::simple::ImageFromRawFile {
+  {
+  std::string errorMessage;
+  bool        failed = false;
+  Py_BEGIN_ALLOW_THREADS
+  try {
+    $action
+  } catch( std::exception &ex ) {
+    errorMessage = std::string( "Exception thrown in SimpleITK $symname: " ) + ex.what();
+    failed = true;
+  } catch( ... ) {
+    errorMessage = "Unknown exception thrown in SimpleITK $symname";
+    failed = true;
+  }
+  Py_END_ALLOW_THREADS
+  if( failed ) {
+    SWIG_exception( SWIG_RuntimeError, errorMessage.c_str() );
+  }
+  }
+}
+
 %include "PythonDocstrings.i"
 
 // ignore overload methods of int type when there is an enum
@@ -117,60 +143,78 @@
             their element values after deletion of this sitk::Image object. """
 
         def _addExportedNumPyArrayView(self, numpyarray):
-            try:
-                self._ExportedNumPyArrayViewsList
-            except:
-                self._ExportedNumPyArrayViewsList = []
-            self._ExportedNumPyArrayViewsList.append(numpyarray)
+            # setdefault and append are atomic, also without the GIL, so
+            # views exported by several threads are all kept
+            self.__dict__.setdefault('_ExportedNumPyArrayViewsList', []).append(numpyarray)
+
+        # NumPy integration, see _image_array_ufunc and _image_array_function
+
+        def __array__( self, dtype = None, copy = None ):
+            if copy is False:
+              arr = GetArrayFromImage( self, arrayview = True )
+            else:
+              arr = GetArrayFromImage( self )
+            return arr if dtype is None else arr.astype( dtype, copy = False )
+
+        def __array_ufunc__( self, ufunc, method, *inputs, **kwargs ):
+            return _image_array_ufunc( ufunc, method, inputs, kwargs )
+
+        def __array_function__( self, func, types, args, kwargs ):
+            return _image_array_function( func, types, args, kwargs )
+
+        # pickle support, see _image_reduce
+
+        def __reduce_ex__( self, protocol ):
+            return _image_reduce( self, protocol )
 
         # mathematical operators
 
         def __add__( self, other ):
-            if isinstance( other, Image ):
-               return Add( self, other )
+            if isinstance( other, _get_image_types() ):
+               return _apply_image_operator( Add, self, other )
             try:
-               return Add( self, float(other)  )
+               return _apply_image_operator( Add, self, float(other) )
             except ValueError:
                return NotImplemented
         def __sub__( self, other ):
-            if isinstance( other, Image ):
-               return Subtract( self, other )
+            if isinstance( other, _get_image_types() ):
+               return _apply_image_operator( Subtract, self, other )
             try:
-               return Subtract( self, float(other) )
+               return _apply_image_operator( Subtract, self, float(other) )
             except ValueError:
                return NotImplemented
         def __mul__( self, other ):
-            if isinstance( other, Image ):
-               return Multiply( self, other )
+            if isinstance( other, _get_image_types() ):
+               return _apply_image_operator( Multiply, self, other )
             try:
-               return Multiply( self, float(other) )
+               return _apply_image_operator( Multiply, self, float(other) )
             except ValueError:
                return NotImplemented
         def __div__( self, other ):
-            if isinstance( other, Image ):
-               return Divide( self, other )
+            if isinstance( other, _get_image_types() ):
+               return _apply_image_operator( Divide, self, other )
             try:
-               return Divide( self, float(other) )
+               return _apply_image_operator( Divide, self, float(other) )
             except ValueError:
                return NotImplemented
         def __floordiv__( self, other ):
-            if isinstance( other, Image ):
-               return DivideFloor( self, other )
+            if isinstance( other, _get_image_types() ):
+               return _apply_image_operator( DivideFloor, self, other )
             try:
-               return DivideFloor( self, float(other) )
+               return _apply_image_operator( DivideFloor, self, float(other) )
             except ValueError:
                return NotImplemented
         def __truediv__( self, other ):
-            if isinstance( other, Image ):
-               return DivideReal( self, other )
+            if isinstance( other, _get_image_types() ):
+               return _apply_image_operator( DivideReal, self, other )
             try:
-               return DivideReal( self, float(other) )
+               return _apply_image_operator( DivideReal, self, float(other) )
             except ValueError:
                return NotImplemented
 
 
         def __neg__( self ):
-            return UnaryMinus( self )
+            return _apply_image_operator( UnaryMinus, self )
         def __pos__( self ):
             return self
 
@@ -179,127 +223,145 @@
 
         def __radd__( self, other ):
             try:
-               return Add( float(other), self )
+               return _apply_image_operator( Add, float(other), self )
             except ValueError:
                return NotImplemented
         def __rsub__( self, other ):
             try:
-               return Subtract( float(other), self )
+               return _apply_image_operator( Subtract, float(other), self )
             except ValueError:
                return NotImplemented
         def __rmul__( self, other ):
             try:
-               return Multiply( float(other), self )
+               return _apply_image_operator( Multiply, float(other), self )
             except ValueError:
                return NotImplemented
         def __rdiv__( self, other ):
             try:
-               return Divide( float(other), self )
+               return _apply_image_operator( Divide, float(other), self )
             except ValueError:
                return NotImplemented
         def __rfloordiv__( self, other ):
             try:
-               return DivideFloor( float(other), self )
+               return _apply_image_operator( DivideFloor, float(other), self )
             except ValueError:
                return NotImplemented
         def __rtruediv__( self, other ):
             try:
-               return DivideReal( float(other), self )
+               return _apply_image_operator( DivideReal, float(other), self )
             except ValueError:
                return NotImplemented
 
 
 
-         # NOTE: the __i*__ methods are not implemented because there
-         # currently in no way to make the underlying filters run
-         # inplace. But python will implement a default version based
-         # on the standard method
-        def __iadd__ ( self, other ):
-            self = Add( self, other )
-            return self;
+        # in-place operators, which write the result into the pixel
+        # buffer of the image when it has the same pixel type
+
+        def __iadd__( self, other ):
+            return _apply_inplace_image_operator( Add, self, other, float )
+        def __isub__( self, other ):
+            return _apply_inplace_image_operator( Subtract, self, other, float )
+        def __imul__( self, other ):
+            return _apply_inplace_image_operator( Multiply, self, other, float )
+        def __idiv__( self, other ):
+            return _apply_inplace_image_operator( Divide, self, other, float )
+        def __ifloordiv__( self, other ):
+            return _apply_inplace_image_operator( DivideFloor, self, other, float )
+        def __itruediv__( self, other ):
+            return _apply_inplace_image_operator( DivideReal, self, other, float )
+        def __ipow__( self, other ):
+            return _apply_inplace_image_operator( Pow, self, other, float )
+        def __imod__( self, other ):
+            return _apply_inplace_image_operator( Modulus, self, other, int )
+        def __iand__( self, other ):
+            return _apply_inplace_image_operator( And, self, other, int )
+        def __ior__( self, other ):
+            return _apply_inplace_image_operator( Or, self, other, int )
+        def __ixor__( self, other ):
+            return _apply_inplace_image_operator( Xor, self, other, int )
 
         # logic operators
 
         def __and__( self, other ):
-            if isinstance( other, Image ):
-               return And( self, other )
+            if isinstance( other, _get_image_types() ):
+               return _apply_image_operator( And, self, other )
             try:
-               return And( self, int(other) )
+               return _apply_image_operator( And, self, int(other) )
             except ValueError:
                return NotImplemented
         def __rand__( self, other ):
             try:
-               return And( int(other), self )
+               return _apply_image_operator( And, int(other), self )
             except ValueError:
                return NotImplemented
         def __or__( self, other ):
-            if isinstance( other, Image ):
-               return Or( self, other )
+            if isinstance( other, _get_image_types() ):
+               return _apply_image_operator( Or, self, other )
             try:
-               return Or( self, int(other) )
+               return _apply_image_operator( Or, self, int(other) )
             except ValueError:
                return NotImplemented
         def __ror__( self, other ):
             try:
-               return Or( int(other), self )
+               return _apply_image_operator( Or, int(other), self )
             except ValueError:
                return NotImplemented
         def __xor__( self, other ):
-            if isinstance( other, Image ):
-               return Xor( self, other )
+            if isinstance( other, _get_image_types() ):
+               return _apply_image_operator( Xor, self, other )
             try:
-               return Xor( self, int(other) )
+               return _apply_image_operator( Xor, self, int(other) )
             except ValueError:
                return NotImplemented
         def __rxor__( self, other ):
             try:
-               return Xor( int(other), self )
+               return _apply_image_operator( Xor, int(other), self )
             except ValueError:
                return NotImplemented
-        def __invert__( self ): return BitwiseNot( self )
+        def __invert__( self ): return _apply_image_operator( BitwiseNot, self )
 
         # Relational and Equality operators
 
         def __lt__( self, other ):
-            if isinstance( other, Image ):
-               return Less( self, other )
+            if isinstance( other, _get_image_types() ):
+               return _apply_image_operator( Less, self, other )
             try:
-               return Less( self, float(other) )
+               return _apply_image_operator( Less, self, float(other) )
             except (ValueError, TypeError):
                return NotImplemented
         def __le__( self, other ):
-            if isinstance( other, Image ):
-               return LessEqual( self, other )
+            if isinstance( other, _get_image_types() ):
+               return _apply_image_operator( LessEqual, self, other )
             try:
-               return LessEqual( self, float(other) )
+               return _apply_image_operator( LessEqual, self, float(other) )
             except (ValueError, TypeError):
                return NotImplemented
         def __eq__( self, other ):
-            if isinstance( other, Image ):
-               return Equal( self, other )
+            if isinstance( other, _get_image_types() ):
+               return _apply_image_operator( Equal, self, other )
             try:
-               return Equal( self, float(other) )
+               return _apply_image_operator( Equal, self, float(other) )
             except (ValueError, TypeError):
                return NotImplemented
         def __ne__( self, other ):
-            if isinstance( other, Image ):
-               return NotEqual( self, other )
+            if isinstance( other, _get_image_types() ):
+               return _apply_image_operator( NotEqual, self, other )
             try:
-               return NotEqual( self, float(other) )
+               return _apply_image_operator( NotEqual, self, float(other) )
             except (ValueError, TypeError):
                return NotImplemented
         def __gt__( self, other ):
-            if isinstance( other, Image ):
-               return Greater( self, other )
+            if isinstance( other, _get_image_types() ):
+               return _apply_image_operator( Greater, self, other )
             try:
-               return Greater( self, float(other) )
+               return _apply_image_operator( Greater, self, float(other) )
             except (ValueError, TypeError):
                return NotImplemented
         def __ge__( self, other ):
-            if isinstance( other, Image ):
-               return GreaterEqual( self, other )
+            if isinstance( other, _get_image_types() ):
+               return _apply_image_operator( GreaterEqual, self, other )
             try:
-               return GreaterEqual( self, float(other) )
+               return _apply_image_operator( GreaterEqual, self, float(other) )
             except (ValueError, TypeError):
                return NotImplemented
 
@@ -307,19 +369,19 @@
         # "function" operators
 
         def __pow__( self, other ):
-            if isinstance( other, Image ):
-               return Pow( self, other )
+            if isinstance( other, _get_image_types() ):
+               return _apply_image_operator( Pow, self, other )
             try:
-               return Pow( self, float(other) )
+               return _apply_image_operator( Pow, self, float(other) )
             except ValueError:
                return NotImplemented
         def __rpow__( self, other ):
             try:
-               return Pow( float(other), self )
+               return _apply_image_operator( Pow, float(other), self )
             except ValueError:
                return NotImplemented
         def __mod__( self, other ): return Modulus( self, other )
-        def __abs__( self ): return Abs( self )
+        def __abs__( self ): return _apply_image_operator( Abs, self )
 
         # iterator and container methods
 
@@ -577,6 +639,9 @@
             idx = idx[0]
           value = args[-1]
 
+          # the pixel is written in place when the image is unique
+          _SimpleITK._InvalidateCachedArray( self )
+
           if pixelID == sitkInt8:
             return self.__SetPixelAsInt8__( idx, value )
           if pixelID == sitkUInt8 or pixelID == sitkLabelUInt8:
@@ -630,15 +695,313 @@
 
 }
 
+%pythoncode %{
+
+# Lazy evaluation of the image operators
+
+_lazy_image_operators = False
+
+def LazyImageOperatorsOn():
+    """Make the arithmetic, logic and relational operators of images
+    lazy.
+
+    With lazy operators an expression such as (a*w1 + b*w2 - c) > t is
+    not computed by a chain of filters, each creating a new image, but
+    it is recorded and computed in a single fused, multithreaded pass
+    over the input images when the result is first used: when a pixel
+    is accessed, the image is converted to an array or passed to a
+    filter. The result is the same as with the filters."""
+    global _lazy_image_operators
+    _lazy_image_operators = True
+
+def LazyImageOperatorsOff():
+    """Make the image operators compute their result immediately, the default."""
+    global _lazy_image_operators
+    _lazy_image_operators = False
+
+def GetLazyImageOperators():
+    return _lazy_image_operators
+
+
+def _apply_image_operator( function, *operands ):
+    """Applies the filter function of an image operator or, with lazy
+    image operators, returns an expression which applies it when used."""
+    if _lazy_image_operators:
+      expression = _ImageExpression._Create( function, operands )
+      if expression is not None:
+        return expression
+    return function( *operands )
+
+
+def _apply_inplace_image_operator( function, image, other, constant_type ):
+    """Applies the filter function of an in-place image operator.
+
+    When the result has the pixel type of the image, it is computed
+    directly into the pixel buffer of the image, which is only copied
+    if it is shared with another image. NumPy array views of the image
+    see the result. Otherwise the result is a new image, as with the
+    binary operator."""
+
+    if not isinstance( other, _get_image_types() ):
+      try:
+        other = constant_type( other )
+      except ValueError:
+        return NotImplemented
+
+    # an expression is immutable, its in-place operators create a new one
+    if type(image) is not _ImageExpression:
+      expression = _ImageExpression._Create( function, ( image, other ), snapshot = False )
+      if expression is not None and expression._node[1] == image.GetPixelIDValue():
+        expression._EvaluateInto( image )
+        return image
+    return _apply_image_operator( function, image, other )
+
+
+class _ImageExpression(object):
+    """The lazily evaluated result of image operators.
+
+    The expression behaves as the image it evaluates to. SWIG gets the
+    image from the "this" attribute, so the expression is evaluated
+    when passed to a filter, and all other attributes are those of the
+    evaluated image. Its type is not Image, isinstance( expression,
+    Image ) is false, Evaluate returns the image. Expressions are
+    hashable by identity.
+
+    The expression is a tree of nodes, which are tuples of the name of
+    the filter, the pixel ID of the result, the operands, the geometry
+    of the result and the number of nodes of the tree. The leaves are
+    "Image" nodes with a shallow copy of the image, which shares the
+    pixel buffer until either is modified, and "Constant" nodes."""
+
+    __slots__ = ( '_node', '_image' )
+
+    # trees larger than this are split, by evaluating their largest operand
+    _MaximumNumberOfNodes = 64
+
+    _Operations = frozenset( [ 'Add', 'Subtract', 'Multiply', 'Divide', 'DivideFloor',
+                               'DivideReal', 'Pow', 'Less', 'LessEqual', 'Equal',
+                               'NotEqual', 'Greater', 'GreaterEqual', 'And', 'Or',
+                               'Xor', 'UnaryMinus', 'Abs', 'BitwiseNot' ] )
+
+    _BitwiseOperations = frozenset( [ 'And', 'Or', 'Xor', 'BitwiseNot' ] )
+
+    _RelationalOperations = frozenset( [ 'Less', 'LessEqual', 'Equal', 'NotEqual',
+                                         'Greater', 'GreaterEqual' ] )
+
+    def __init__( self, node ):
+      self._node = node
+      self._image = None
+
+    @property
+    def this( self ):
+      return self.Evaluate().this
+
+    def __getattr__( self, name ):
+      return getattr( self.Evaluate(), name )
+
+    def __str__( self ):
+      return str( self.Evaluate() )
+
+    __hash__ = object.__hash__
+
+    def Evaluate( self ):
+      """Computes the image of the expression, once."""
+      if self._image is None:
+        program = []
+        images = []
+        _ImageExpression._Compile( self._node, program, images, {} )
+        self._image = _SimpleITK._EvaluateImageExpression( program, images )
+        self._node = None
+      return self._image
+
+    def _EvaluateInto( self, image ):
+      """Computes the expression into the pixel buffer of an image with
+      the size and pixel type of the result, in place."""
+      program = []
+      images = []
+      _ImageExpression._Compile( self._node, program, images, {} )
+      _SimpleITK._EvaluateImageExpression( program, images, image )
+
+    @staticmethod
+    def _Compile( node, program, images, indices ):
+      name, pixelID, operands = node[:3]
+      if name == 'Image':
+        if id(operands) not in indices:
+          indices[id(operands)] = len(images)
+          images.append( operands )
+        program.append( ( name, pixelID, indices[id(operands)] ) )
+      elif name == 'Constant':
+        program.append( ( name, pixelID, operands ) )
+      else:
+        for operand in operands:
+          _ImageExpression._Compile( operand, program, images, indices )
+        program.append( ( name, pixelID, None ) )
+
+    @staticmethod
+    def _GetNode( operand, snapshot = True ):
+      """Returns the node of an image or expression operand, or None if
+      its pixel type is not supported. Without snapshot the node refers
+      to the image itself, which must not change before evaluation."""
+
+      if type(operand) is _ImageExpression:
+        if operand._image is None:
+          return operand._node
+        operand = operand._image
+
+      pixelID = operand.GetPixelIDValue()
+      # the values of 64 bit integers are not exact as doubles
+      if pixelID not in ( sitkUInt8, sitkInt8, sitkUInt16, sitkInt16,
+                          sitkUInt32, sitkInt32, sitkFloat32, sitkFloat64 ):
+        return None
+      geometry = ( operand.GetSize(), operand.GetOrigin(),
+                   operand.GetSpacing(), operand.GetDirection() )
+      return ( 'Image', pixelID, Image( operand ) if snapshot else operand, geometry, 1 )
+
+    @staticmethod
+    def _SameGeometry( geometry1, geometry2 ):
+      """Checks the geometry with the tolerances of the ITK filters."""
+      if geometry1 is geometry2:
+        return True
+      size1, origin1, spacing1, direction1 = geometry1
+      size2, origin2, spacing2, direction2 = geometry2
+      tolerance = 1e-6 * abs( spacing1[0] )
+      return ( size1 == size2
+               and all( abs(a - b) <= tolerance for a, b in zip( origin1, origin2 ) )
+               and all( abs(a - b) <= tolerance for a, b in zip( spacing1, spacing2 ) )
+               and all( abs(a - b) <= 1e-6 for a, b in zip( direction1, direction2 ) ) )
+
+    @staticmethod
+    def _Create( function, operands, snapshot = True ):
+      """Returns an expression of a filter function applied to the
+      operands, or None if the filter must be run instead."""
+
+      name = getattr( function, '__name__', None )
+      if name not in _ImageExpression._Operations:
+        return None
+
+      nodes = []
+      image = None
+      for operand in operands:
+        if isinstance( operand, _get_image_types() ):
+          node = _ImageExpression._GetNode( operand, snapshot )
+          if node is None:
+            return None
+          if image is None:
+            image = node
+          elif node[1] != image[1] or not _ImageExpression._SameGeometry( node[3], image[3] ):
+            # let the filter report the mismatch
+            return None
+          nodes.append( node )
+        else:
+          nodes.append( operand )
+
+      pixelID = image[1]
+      integer = pixelID not in ( sitkFloat32, sitkFloat64 )
+      if name in _ImageExpression._BitwiseOperations and not integer:
+        return None
+      if name in ( 'Multiply', 'Pow' ) and pixelID in ( sitkUInt32, sitkInt32 ):
+        return None
+
+      # constants have the pixel type of the image
+      for i, operand in enumerate( nodes ):
+        if type(operand) is not tuple:
+          constant = float( operand )
+          if name in ( 'Divide', 'DivideFloor' ) and i == 1 and ( int( constant ) if integer else constant ) == 0:
+            return None
+          nodes[i] = ( 'Constant', pixelID, constant, None, 1 )
+
+      # evaluate the largest operand first, if the tree gets too large
+      count = 1 + sum( node[4] for node in nodes )
+      while count > _ImageExpression._MaximumNumberOfNodes:
+        i = max( range( len(nodes) ), key = lambda i: nodes[i][4] )
+        nodes[i] = _ImageExpression._GetNode( _ImageExpression( nodes[i] ).Evaluate() )
+        count = 1 + sum( node[4] for node in nodes )
+
+      # the pixel type of the output of the filter
+      if name == 'DivideReal':
+        pixelID = sitkFloat64
+      elif name in _ImageExpression._RelationalOperations:
+        pixelID = sitkUInt8
+      return _ImageExpression( ( name, pixelID, tuple(nodes), image[3], count ) )
+
+
+def _image_expression_method( name ):
+    def method( self, *args, **kwargs ):
+      return Image.__dict__[name]( self, *args, **kwargs )
+    method.__name__ = name
+    return method
+
+# the operators and container methods of an expression are those of
+# Image, the in-place operators fall back to the binary operators
+for _name in ( '__add__', '__sub__', '__mul__', '__div__', '__floordiv__', '__truediv__',
+               '__neg__', '__pos__', '__radd__', '__rsub__', '__rmul__', '__rdiv__',
+               '__rfloordiv__', '__rtruediv__', '__and__', '__rand__', '__or__',
+               '__ror__', '__xor__', '__rxor__', '__invert__', '__lt__', '__le__', '__eq__',
+               '__ne__', '__gt__', '__ge__', '__pow__', '__rpow__', '__mod__', '__abs__',
+               '__iter__', '__len__', '__getitem__', '__setitem__', '__array__',
+               '__array_ufunc__', '__array_function__', '__reduce_ex__' ):
+    setattr( _ImageExpression, _name, _image_expression_method( _name ) )
+del _name
+
+_image_types = None
+
+def _get_image_types():
+    """Returns the types which are images to the operators and NumPy
+    functions. Image is wrapped after this code, so the tuple is
+    created on the first call."""
+    global _image_types
+    if _image_types is None:
+      _image_types = ( Image, _ImageExpression )
+    return _image_types
+
+%}
+
 // This is included inline because SwigMethods (SimpleITKPYTHON_wrap.cxx)
 // is declared static.
 %{
 #include "sitkNumpyArrayConversion.cxx"
+#include "sitkPyImageExpression.cxx"
+#include "sitkPyRunLengthEncoding.cxx"
+#include "sitkPyConversionCache.cxx"
 %}
 // Numpy array conversion support
 %native(_GetByteArrayFromImage) PyObject *sitk_GetByteArrayFromImage( PyObject *self, PyObject *args );
 %native(_SetImageFromArray) PyObject *sitk_SetImageFromArray( PyObject *self, PyObject *args );
 %native(_SetRefenceCountImage) PyObject *sitk_SetRefenceCountImage( PyObject *self, PyObject *args );
+%native(_GetArrayFromImageRegion) PyObject *sitk_GetArrayFromImageRegion( PyObject *self, PyObject *args );
+%native(_PasteArrayIntoImage) PyObject *sitk_PasteArrayIntoImage( PyObject *self, PyObject *args );
+%native(_GetDownsampledArraysFromImage) PyObject *sitk_GetDownsampledArraysFromImage( PyObject *self, PyObject *args );
+%native(_PasteArrayBlocksIntoImage) PyObject *sitk_PasteArrayBlocksIntoImage( PyObject *self, PyObject *args );
+%native(_GetArrayFromImageWithAxisOrder) PyObject *sitk_GetArrayFromImageWithAxisOrder( PyObject *self, PyObject *args );
+%native(_SetImageFromArrayWithAxisOrder) PyObject *sitk_SetImageFromArrayWithAxisOrder( PyObject *self, PyObject *args );
+
+// Run length encoded label image support
+%native(_EncodeRunLength) PyObject *sitk_EncodeRunLength( PyObject *self, PyObject *args );
+%native(_DecodeRunLength) PyObject *sitk_DecodeRunLength( PyObject *self, PyObject *args );
+
+// Conversion cache support
+%native(_GetCachedArrayFromImage) PyObject *sitk_GetCachedArrayFromImage( PyObject *self, PyObject *args );
+%native(_SetConversionCacheBudget) PyObject *sitk_SetConversionCacheBudget( PyObject *self, PyObject *args );
+%native(_GetConversionCacheStatistics) PyObject *sitk_GetConversionCacheStatistics( PyObject *self, PyObject *args );
+%native(_ClearConversionCache) PyObject *sitk_ClearConversionCache( PyObject *self, PyObject *args );
+%native(_InvalidateCachedArray) PyObject *sitk_InvalidateCachedArray( PyObject *self, PyObject *args );
+
+// Lazy image expression support
+%native(_EvaluateImageExpression) PyObject *sitk_EvaluateImageExpression( PyObject *self, PyObject *args );
+
+// The fast path conversion functions are added to the module directly.
+%init %{
+  if( sitk_AddFastConversionFunctions( d ) < 0 )
+    {
+    PyErr_Print();
+    }
+#ifdef Py_GIL_DISABLED
+  // The module does not rely on the GIL, the shared state of the
+  // bridge has its own locks, so a free-threaded python keeps the GIL
+  // disabled when the module is imported.
+  PyUnstable_Module_SetGIL( m, Py_MOD_GIL_NOT_USED );
+#endif
+%}
 
 %pythoncode %{
 
@@ -671,44 +1034,100 @@ class sitkndarray(numpy.ndarray):
       super(sitkndarray, self).itemset(*args)
 
 
+# The mappings between the pixel IDs and the NumPy types, created on
+# first use because the pixel ID constants are wrapped after this code.
+_sitk_np = None
+_np_sitk = None
+_np_sitk_vector = None
+
+def _get_pixelid_maps():
+    """Returns the mappings from the pixel IDs to the NumPy types, and
+    from the NumPy types to the scalar and the vector pixel IDs."""
+    global _sitk_np, _np_sitk, _np_sitk_vector
+
+    if _sitk_np is not None:
+      return _sitk_np, _np_sitk, _np_sitk_vector
+
+    # this is a mapping from sitk's pixel id to numpy's dtype
+    sitk_np = {sitkUInt8:numpy.uint8,
+               sitkUInt16:numpy.uint16,
+               sitkUInt32:numpy.uint32,
+               sitkUInt64:numpy.uint64,
+               sitkInt8:numpy.int8,
+               sitkInt16:numpy.int16,
+               sitkInt32:numpy.int32,
+               sitkInt64:numpy.int64,
+               sitkFloat32:numpy.float32,
+               sitkFloat64:numpy.float64,
+               sitkComplexFloat32:numpy.complex64,
+               sitkComplexFloat64:numpy.complex128,
+               sitkVectorUInt8:numpy.uint8,
+               sitkVectorInt8:numpy.int8,
+               sitkVectorUInt16:numpy.uint16,
+               sitkVectorInt16:numpy.int16,
+               sitkVectorUInt32:numpy.uint32,
+               sitkVectorInt32:numpy.int32,
+               sitkVectorUInt64:numpy.uint64,
+               sitkVectorInt64:numpy.int64,
+               sitkVectorFloat32:numpy.float32,
+               sitkVectorFloat64:numpy.float64,
+               sitkLabelUInt8:numpy.uint8,
+               sitkLabelUInt16:numpy.uint16,
+               sitkLabelUInt32:numpy.uint32,
+               sitkLabelUInt64:numpy.uint64
+               }
+
+    # This is a Mapping from numpy array types to sitks pixel types.
+    np_sitk = {numpy.character:sitkUInt8,
+               numpy.uint8:sitkUInt8,
+               numpy.uint16:sitkUInt16,
+               numpy.uint32:sitkUInt32,
+               numpy.uint64:sitkUInt64,
+               numpy.int8:sitkInt8,
+               numpy.int16:sitkInt16,
+               numpy.int32:sitkInt32,
+               numpy.int64:sitkInt64,
+               numpy.float32:sitkFloat32,
+               numpy.float64:sitkFloat64,
+               numpy.complex64:sitkComplexFloat32,
+               numpy.complex128:sitkComplexFloat64
+               }
+
+    # This is a Mapping from numpy array types to sitks vector pixel types.
+    np_sitk_vector = {numpy.character:sitkVectorUInt8,
+                      numpy.uint8:sitkVectorUInt8,
+                      numpy.uint16:sitkVectorUInt16,
+                      numpy.uint32:sitkVectorUInt32,
+                      numpy.uint64:sitkVectorUInt64,
+                      numpy.int8:sitkVectorInt8,
+                      numpy.int16:sitkVectorInt16,
+                      numpy.int32:sitkVectorInt32,
+                      numpy.int64:sitkVectorInt64,
+                      numpy.float32:sitkVectorFloat32,
+                      numpy.float64:sitkVectorFloat64,
+                      }
+
+    _np_sitk = np_sitk
+    _np_sitk_vector = np_sitk_vector
+    _sitk_np = sitk_np
+    return _sitk_np, _np_sitk, _np_sitk_vector
+
 def _get_numpy_dtype( sitkImage ):
     """Given a SimpleITK image, returns the numpy.dtype which describes the data"""
 
     if not HAVE_NUMPY:
         raise ImportError('Numpy not available.')
 
-    # this is a mapping from sitk's pixel id to numpy's dtype
-    _sitk_np = {sitkUInt8:numpy.uint8,
-                sitkUInt16:numpy.uint16,
-                sitkUInt32:numpy.uint32,
-                sitkUInt64:numpy.uint64,
-                sitkInt8:numpy.int8,
-                sitkInt16:numpy.int16,
-                sitkInt32:numpy.int32,
-                sitkInt64:numpy.int64,
-                sitkFloat32:numpy.float32,
-                sitkFloat64:numpy.float64,
-                sitkComplexFloat32:numpy.complex64,
-                sitkComplexFloat64:numpy.complex128,
-                sitkVectorUInt8:numpy.uint8,
-                sitkVectorInt8:numpy.int8,
-                sitkVectorUInt16:numpy.uint16,
-                sitkVectorInt16:numpy.int16,
-                sitkVectorUInt32:numpy.uint32,
-                sitkVectorInt32:numpy.int32,
-                sitkVectorUInt64:numpy.uint64,
-                sitkVectorInt64:numpy.int64,
-                sitkVectorFloat32:numpy.float32,
-                sitkVectorFloat64:numpy.float64,
-                sitkLabelUInt8:numpy.uint8,
-                sitkLabelUInt16:numpy.uint16,
-                sitkLabelUInt32:numpy.uint32,
-                sitkLabelUInt64:numpy.uint64
-                }
-
-    return _sitk_np[ sitkImage.GetPixelIDValue() ]
+    return _get_pixelid_maps()[0][ sitkImage.GetPixelIDValue() ]
 
 
+def _lookup_sitk_pixelid(numpy_array_type, _np_sitk_map):
+    try:
+        return _np_sitk_map[numpy_array_type.dtype]
+    except KeyError:
+        for key in _np_sitk_map:
+            if numpy.issubdtype(numpy_array_type.dtype, key):
+                return _np_sitk_map[key]
 
 def _get_sitk_pixelid(numpy_array_type):
     """Returns a SimpleITK PixelID given a numpy array."""
@@ -716,28 +1135,7 @@ def _get_sitk_pixelid(numpy_array_type):
     if not HAVE_NUMPY:
         raise ImportError('Numpy not available.')
 
-    # This is a Mapping from numpy array types to sitks pixel types.
-    _np_sitk = {numpy.character:sitkUInt8,
-                numpy.uint8:sitkUInt8,
-                numpy.uint16:sitkUInt16,
-                numpy.uint32:sitkUInt32,
-                numpy.uint64:sitkUInt64,
-                numpy.int8:sitkInt8,
-                numpy.int16:sitkInt16,
-                numpy.int32:sitkInt32,
-                numpy.int64:sitkInt64,
-                numpy.float32:sitkFloat32,
-                numpy.float64:sitkFloat64,
-                numpy.complex64:sitkComplexFloat32,
-                numpy.complex128:sitkComplexFloat64
-                }
-
-    try:
-        return _np_sitk[numpy_array_type.dtype]
-    except KeyError:
-        for key in _np_sitk:
-            if numpy.issubdtype(numpy_array_type.dtype, key):
-                return _np_sitk[key]
+    return _lookup_sitk_pixelid(numpy_array_type, _get_pixelid_maps()[1])
 
 def _get_sitk_vector_pixelid(numpy_array_type):
     """Returns a SimpleITK vecotr PixelID given a numpy array."""
@@ -745,32 +1143,90 @@ def _get_sitk_vector_pixelid(numpy_array_type):
     if not HAVE_NUMPY:
         raise ImportError('Numpy not available.')
 
-    # This is a Mapping from numpy array types to sitks pixel types.
-    _np_sitk = {numpy.character:sitkVectorUInt8,
-                numpy.uint8:sitkVectorUInt8,
-                numpy.uint16:sitkVectorUInt16,
-                numpy.uint32:sitkVectorUInt32,
-                numpy.uint64:sitkVectorUInt64,
-                numpy.int8:sitkVectorInt8,
-                numpy.int16:sitkVectorInt16,
-                numpy.int32:sitkVectorInt32,
-                numpy.int64:sitkVectorInt64,
-                numpy.float32:sitkVectorFloat32,
-                numpy.float64:sitkVectorFloat64,
-                }
-
-    try:
-        return _np_sitk[numpy_array_type.dtype]
-    except KeyError:
-        for key in _np_sitk:
-            if numpy.issubdtype(numpy_array_type.dtype, key):
-                return _np_sitk[key]
+    return _lookup_sitk_pixelid(numpy_array_type, _get_pixelid_maps()[2])
 
 
 # SimplyITK <-> Numpy Array conversion support.
 
-def GetArrayFromImage(image, arrayview = False, writeable = False):
-    """Get a NumPy array/ array view from a SimpleITK Image."""
+def _get_statistics_request( statistics, histogramBins, histogramRange ):
+    """Returns the statistics argument of the native conversions."""
+
+    if not statistics:
+      return None
+    if histogramBins:
+      if histogramRange is None:
+        raise ValueError( "A histogram range is required for the histogram bins." )
+      return ( int( histogramBins ), float( histogramRange[0] ), float( histogramRange[1] ) )
+    return ( 0, 0.0, 0.0 )
+
+_axis_names = 'xyzt'
+
+def _get_axis_order( axisOrder, dim, isVector ):
+    """Returns the image axes of the array axes, 0 for x and dim for the
+    components of a vector image, from a string such as 'xyz' or 'czyx',
+    or a sequence of the axes. Returns None for the default order,
+    the reverse of the image axes with the components last."""
+
+    if axisOrder is None:
+      return None
+    numberOfAxes = dim + int( isVector )
+    if isinstance( axisOrder, str ):
+      names = _axis_names[:dim] + ( 'c' if isVector else '' )
+      if len( axisOrder ) != numberOfAxes or any( a not in names for a in axisOrder ):
+        raise ValueError( "The axis order must be a permutation of '{0}'.".format( names ) )
+      axes = tuple( names.index( a ) for a in axisOrder )
+    else:
+      axes = tuple( int( a ) for a in axisOrder )
+    if sorted( axes ) != list( range( numberOfAxes ) ):
+      raise ValueError( "The axis order {0} is not a permutation of the image axes.".format( axisOrder ) )
+    default = tuple( range( dim - 1, -1, -1 ) ) + ( ( dim, ) if isVector else () )
+    if axes == default:
+      return None
+    return axes
+
+def _get_planar_axis_order( axisOrder, dim ):
+    """Returns the axis order of a planar vector image array."""
+
+    if axisOrder is not None:
+      raise ValueError( "The axisOrder and planar arguments are exclusive." )
+    return ( dim, ) + tuple( range( dim - 1, -1, -1 ) )
+
+def GetArrayFromImage(image, arrayview = False, writeable = False,
+                      statistics = False, histogramBins = 0, histogramRange = None,
+                      axisOrder = None, planar = False, cached = False,
+                      index = None, size = None):
+    """Get a NumPy array/ array view from a SimpleITK Image.
+
+    With statistics, a tuple of the array and a dictionary of the
+    Minimum, Maximum, Mean, Variance, Sigma, Sum and Count of the pixel
+    components is returned, which are computed in the same pass as the
+    copy. With histogramBins, the dictionary has the Histogram of the
+    components in histogramRange, as with numpy.histogram. Not a number
+    components are not counted.
+
+    The axisOrder is the order of the image axes in the array shape, as
+    a string of 'x', 'y', 'z', 't' and 'c' for the components of a
+    vector image, e.g. 'xyz' or 'czyx', or as a sequence of the axis
+    numbers. The default is 'zyx', with the components last. Other
+    orders are copied with a cache blocked transpose, and can not be
+    array views.
+
+    With planar, the components of a vector image are the first axis
+    of the array, as with axisOrder 'czyx'. The components are copied
+    into the planes by kernels for each number of components.
+
+    With cached, the array is read only and is kept in the conversion
+    cache, which returns the same array while the image is unchanged,
+    see SetConversionCacheBudget. The cache does not keep the image,
+    so writing the image does not copy its pixels. The cache is not
+    used for the other options, while the image has exported array
+    views, or for images which do not own their pixels, e.g. array
+    views, shared memory and mapped files, which may be written by
+    others.
+
+    With index and size, only the region of the image with the index of
+    its first pixel and its size is copied, in the default axis order,
+    without a copy of the whole image."""
 
     if not HAVE_NUMPY:
         raise ImportError('Numpy not available.')
@@ -778,19 +1234,42 @@ def GetArrayFromImage(image, arrayview = False, writeable = False):
     pixelID = image.GetPixelIDValue()
     assert pixelID != sitkUnknown, "An SimpleITK image of Unknow pixel type should now exists!"
 
-    dtype = _get_numpy_dtype( image )
-
-    shape = image.GetSize();
-    if image.GetNumberOfComponentsPerPixel() > 1:
-      shape = ( image.GetNumberOfComponentsPerPixel(), ) + shape
+    if index is not None or size is not None:
+      if index is None or size is None:
+        raise ValueError( "A region requires both the index and the size." )
+      if arrayview or statistics or histogramBins or axisOrder is not None or planar or cached:
+        raise ValueError( "A region is only copied in the default axis order, without statistics." )
+      return _SimpleITK._GetArrayFromImageRegion( image, index, size )
+
+    request = _get_statistics_request( statistics, histogramBins, histogramRange )
+
+    if cached:
+      if arrayview or request is not None or axisOrder is not None or planar:
+        raise ValueError( "Only default copies are cached." )
+      if not getattr( image, '_ExportedNumPyArrayViewsList', None ):
+        return _SimpleITK._GetCachedArrayFromImage( image )
+
+    if planar and image.GetNumberOfComponentsPerPixel() > 1:
+      axisOrder = _get_planar_axis_order( axisOrder, image.GetDimension() )
+    axes = _get_axis_order( axisOrder, image.GetDimension(), image.GetNumberOfComponentsPerPixel() > 1 )
+    if axes is not None:
+      if arrayview:
+        raise ValueError( "An array view has the axes of the image buffer." )
+      return _SimpleITK._GetArrayFromImageWithAxisOrder( image, axes, request )
 
     if arrayview == False:
-      imageByteArray = _SimpleITK._GetByteArrayFromImage(image, int(arrayview))
-      arr = numpy.frombuffer(imageByteArray, dtype )
-      arr.shape = shape[::-1]
-      return arr
+      # the native function returns the final array, a copy of the buffer
+      return _SimpleITK._GetByteArrayFromImage(image, int(arrayview), request)
     else:
-      imageMemoryView = _SimpleITK._GetByteArrayFromImage(image, int(arrayview))
+      dtype = _get_numpy_dtype( image )
+
+      shape = image.GetSize();
+      if image.GetNumberOfComponentsPerPixel() > 1:
+        shape = ( image.GetNumberOfComponentsPerPixel(), ) + shape
+
+      imageMemoryView = _SimpleITK._GetByteArrayFromImage(image, int(arrayview), request)
+      if request is not None:
+        imageMemoryView, imageStatistics = imageMemoryView
       _SimpleITK._SetRefenceCountImage(image, int(True))
       arrayView = numpy.asarray(imageMemoryView).view(dtype = dtype).reshape(shape[::-1]).view(sitkndarray)
       if writeable == True:
@@ -799,12 +1278,27 @@ def GetArrayFromImage(image, arrayview = False, writeable = False):
         arrayView.setflags(write = writeable)
 
       image._addExportedNumPyArrayView(arrayView)
+      if request is not None:
+        return arrayView, imageStatistics
       return arrayView
 
-def GetImageFromArray( arr, isVector=False, imageview = False):
+def GetImageFromArray( arr, isVector=False, imageview = False,
+                       statistics = False, histogramBins = 0, histogramRange = None,
+                       axisOrder = None, planar = False):
     """Get a SimpleITK Image/ Image view from a numpy array.
     If isVector is True, then a 3D array will be treated as a 2D vector image,
-    otherwise it will be treated as a 3D image"""
+    otherwise it will be treated as a 3D image
+
+    With statistics, a tuple of the image and a dictionary of the
+    statistics of the pixel components is returned, as with
+    GetArrayFromImage.
+
+    The axisOrder is the order of the image axes in the array shape, as
+    with GetArrayFromImage. An axisOrder string with 'c' is a vector
+    image.
+
+    With planar, the array is a vector image with the components as
+    the first axis, e.g. of shape (C, Z, Y, X)."""
 
     if not HAVE_NUMPY:
         raise ImportError('Numpy not available.')
@@ -812,15 +1306,810 @@ def GetImageFromArray( arr, isVector=False, imageview = False):
     assert arr.ndim in ( 2, 3, 4 ), \
       "Only arrays of 2, 3 or 4 dimensions are supported."
 
+    request = _get_statistics_request( statistics, histogramBins, histogramRange )
+
+    if planar:
+      axisOrder = _get_planar_axis_order( axisOrder, arr.ndim - 1 )
+      isVector = True
+
+    if axisOrder is not None:
+      if isinstance( axisOrder, str ):
+        isVector = 'c' in axisOrder
+      else:
+        isVector = ( arr.ndim == 3 and isVector ) or arr.ndim == 4
+      axes = _get_axis_order( axisOrder, arr.ndim - int( isVector ), isVector )
+      if axes is not None:
+        if imageview:
+          raise ValueError( "An image view has the axes of the array." )
+        if isVector:
+          id = _get_sitk_vector_pixelid( arr )
+        else:
+          id = _get_sitk_pixelid( arr )
+        return _SimpleITK._SetImageFromArrayWithAxisOrder( arr, axes, id, int( isVector ), request )
+
     if ( arr.ndim == 3 and isVector ) or (arr.ndim == 4):
       id = _get_sitk_vector_pixelid( arr )
-      img = _SimpleITK._SetImageFromArray( arr, int(imageview), arr.shape[-2::-1], id, arr.shape[-1] )
+      img = _SimpleITK._SetImageFromArray( arr, int(imageview), arr.shape[-2::-1], id, arr.shape[-1], request )
     elif arr.ndim in ( 2, 3 ):
       id = _get_sitk_pixelid( arr )
-      img = _SimpleITK._SetImageFromArray( arr, int(imageview), arr.shape[::-1], id )
+      img = _SimpleITK._SetImageFromArray( arr, int(imageview), arr.shape[::-1], id, 1, request )
 
     return img
 
+def PasteArrayIntoImage( image, arr, index ):
+    """Copy a NumPy array into the region of an image with the index of
+    its first pixel, in place.
+
+    The array has the default axis order of GetArrayFromImage, so its
+    reversed shape is the size of the region, and the pixel type of the
+    image. The rows of the region are copied without a copy of the rest
+    of the image, and without the GIL."""
+
+    if not HAVE_NUMPY:
+        raise ImportError('Numpy not available.')
+
+    _SimpleITK._PasteArrayIntoImage( image, arr, index )
+
+def _get_nearest_reduction( reduction ):
+    if reduction not in ( 'nearest', 'mean' ):
+      raise ValueError( "The reduction must be 'nearest' or 'mean'." )
+    return int( reduction == 'nearest' )
+
+def GetDownsampledArrayFromImage( image, shrinkFactors, reduction = 'nearest' ):
+    """Get a NumPy array of an image shrunk by integer factors along
+    each axis, without a copy of the whole image.
+
+    The shrinkFactors are a factor for each image axis, x first, or a
+    single factor for all the axes. The array has the size of the image
+    divided by the factors and rounded up. With the 'nearest' reduction
+    the array is the first pixel of each block, as with the slice
+    [::f] of GetArrayFromImage, and only those pixels are read. With
+    'mean' it is the mean of each block, rounded for integer types."""
+
+    if not HAVE_NUMPY:
+        raise ImportError('Numpy not available.')
+
+    shrinkFactors = _as_sequence( shrinkFactors, image.GetDimension() )
+    return _SimpleITK._GetDownsampledArraysFromImage( image, shrinkFactors, _get_nearest_reduction( reduction ), 1 )[0]
+
+def GetArrayPyramidFromImage( image, numberOfLevels, shrinkFactors = 2, reduction = 'mean' ):
+    """Get a list of the NumPy arrays of the levels of a pyramid of an
+    image, the coarsest last, e.g. for the overviews of a viewer.
+
+    Each level is the previous level, or the image for the first, shrunk
+    by the shrinkFactors with the reduction of
+    GetDownsampledArrayFromImage. All the levels are computed in a
+    single call, which reads the image once. With 'mean', a block at the
+    border of a coarser level is the mean of the clipped blocks of the
+    previous level."""
+
+    if not HAVE_NUMPY:
+        raise ImportError('Numpy not available.')
+
+    shrinkFactors = _as_sequence( shrinkFactors, image.GetDimension() )
+    return _SimpleITK._GetDownsampledArraysFromImage( image, shrinkFactors, _get_nearest_reduction( reduction ), int( numberOfLevels ) )
+
+def SetConversionCacheBudget( budget ):
+    """Sets the maximum size in bytes of the arrays of the conversion
+    cache of GetArrayFromImage, evicting the least recently used
+    arrays. A budget of 0 disables the cache."""
+
+    _SimpleITK._SetConversionCacheBudget( int( budget ) )
+
+def GetConversionCacheStatistics():
+    """Returns a dictionary of the Hits, Misses and Evictions of the
+    conversion cache, its NumberOfEntries, Size and Budget in bytes."""
+
+    return _SimpleITK._GetConversionCacheStatistics()
+
+def ClearConversionCache():
+    """Releases all the arrays of the conversion cache."""
+
+    _SimpleITK._ClearConversionCache()
+
+# Low overhead copies for small images, e.g. patches. These are the
+# native functions themselves, without any processing in python.
+GetArrayFromImageFast = _SimpleITK._GetArrayFromImageFast
+GetImageFromArrayFast = _SimpleITK._GetImageFromArrayFast
+
+def _iter_tile_regions( size, tileSize, overlap ):
+    """Yields the (index, size) of each tile, extended by the overlap and
+    clipped to the image."""
+
+    import itertools
+    starts = [ range(0, s, t) for s, t in zip(size, tileSize) ]
+    # the first axis varies fastest, as in the image buffer
+    for start in itertools.product( *reversed(starts) ):
+      start = start[::-1]
+      index = [ max(0, b - o) for b, o in zip(start, overlap) ]
+      end = [ min(s, b + t + o) for b, t, o, s in zip(start, tileSize, overlap, size) ]
+      yield index, [ e - i for e, i in zip(end, index) ]
+
+def IterArrayTilesFromImage( image, tileSize, overlap = 0, prefetch = True ):
+    """Iterate over an image as a sequence of NumPy array tiles.
+
+    Yields (index, array) for each tile of the image, where index is
+    the image index of the first pixel of the array. The tiles are
+    tileSize pixels large, extended by overlap pixels on each side and
+    clipped to the image. Only a few tiles are in memory at once.
+
+    The image may be a SimpleITK Image or the name of an image file, in
+    which case each tile is read separately from the file with the
+    ImageFileReader, so the volume does not need to fit in memory.
+
+    When prefetch is True the next tile is copied by a background
+    thread while the current one is being processed."""
+
+    if not HAVE_NUMPY:
+        raise ImportError('Numpy not available.')
+
+    if isinstance( image, _get_image_types() ):
+      size = image.GetSize()
+      def read( index, tile ):
+        return _SimpleITK._GetArrayFromImageRegion( image, index, tile )
+    else:
+      reader = ImageFileReader()
+      if not hasattr( reader, 'SetExtractSize' ):
+        raise RuntimeError( 'Streaming tiles from a file requires ImageFileReader.SetExtractSize.' )
+      reader.SetFileName( image )
+      reader.ReadImageInformation()
+      size = reader.GetSize()
+      def read( index, tile ):
+        reader.SetExtractIndex( index )
+        reader.SetExtractSize( tile )
+        return GetArrayFromImage( reader.Execute() )
+
+    dim = len( size )
+    tileSize = [ min(t, s) for t, s in zip( _as_sequence( tileSize, dim ), size ) ]
+    overlap = _as_sequence( overlap, dim )
+    regions = _iter_tile_regions( size, tileSize, overlap )
+
+    if not prefetch:
+      for index, tile in regions:
+        yield tuple(index), read( index, tile )
+      return
+
+    import threading
+    try:
+      import queue
+    except ImportError:
+      import Queue as queue
+
+    # one tile is being processed, one waits in the queue and one is read
+    tiles = queue.Queue( maxsize = 1 )
+    done = object()
+    stop = threading.Event()
+
+    def producer():
+      try:
+        for index, tile in regions:
+          if stop.is_set():
+            return
+          tiles.put( ( tuple(index), read( index, tile ) ) )
+        tiles.put( done )
+      except Exception as e:
+        tiles.put( e )
+
+    thread = threading.Thread( target = producer )
+    thread.daemon = True
+    thread.start()
+    try:
+      while True:
+        item = tiles.get()
+        if item is done:
+          break
+        if isinstance( item, Exception ):
+          raise item
+        yield item
+    finally:
+      stop.set()
+      # release the producer if it is blocked on a full queue
+      while thread.is_alive():
+        try:
+          tiles.get_nowait()
+        except queue.Empty:
+          pass
+        thread.join( 0.01 )
+
+def GetImageFromArrayTiles( tiles, size, isVector = False, overlap = 0, tileSize = None ):
+    """Assemble a SimpleITK Image from NumPy array tiles.
+
+    The tiles are an iterable of (index, array), for example the output
+    of IterArrayTilesFromImage after processing, in any order. Each
+    array is copied into its region of the image as it arrives, so no
+    other full size buffer is created.
+
+    With an overlap, the tileSize of IterArrayTilesFromImage is
+    required, and only the core of each tile, the tileSize pixels from
+    the start of the tile without the overlap, is copied. The overlap
+    must be smaller than the tileSize on the axes with several tiles."""
+
+    if not HAVE_NUMPY:
+        raise ImportError('Numpy not available.')
+
+    dim = len( size )
+    overlap = _as_sequence( overlap, dim )
+    if tileSize is None:
+      if any( overlap ):
+        raise ValueError( 'The tileSize is required to remove the overlap of the tiles.' )
+    else:
+      tileSize = [ min(t, s) for t, s in zip( _as_sequence( tileSize, dim ), size ) ]
+      if any( o >= t and t < s for o, t, s in zip( overlap, tileSize, size ) ):
+        raise ValueError( 'The overlap must be smaller than the tile size.' )
+
+    img = None
+    for index, arr in tiles:
+      if img is None:
+        if isVector:
+          img = Image( list(size), _get_sitk_vector_pixelid( arr ), arr.shape[-1] )
+        else:
+          img = Image( list(size), _get_sitk_pixelid( arr ) )
+
+      # the shape of the tile in image order
+      tile = arr.shape[dim-1::-1] if not isVector else arr.shape[-2::-1]
+      core = tile if tileSize is None else tileSize
+      # the index of a tile is only clipped to 0 at the first tile
+      start = [ i + o if i > 0 else 0 for i, o in zip(index, overlap) ]
+      end = [ min(b + c, i + t) for b, c, i, t in zip(start, core, index, tile) ]
+      crop = tuple( slice(b - i, e - i) for b, e, i in zip(start, end, index) )[::-1]
+
+      _SimpleITK._PasteArrayIntoImage( img, arr[crop], start )
+
+    if img is None:
+      raise ValueError( 'No tiles to assemble.' )
+    return img
+
+def _as_sequence( value, dim ):
+    try:
+      return [ int(v) for v in value ]
+    except TypeError:
+      return [ int(value) ] * dim
+
+
+# Incremental synchronization of an array copy with its image
+
+def _get_index_bounds( item, shape ):
+    """Returns the [start, stop) of each axis of an array written by an
+    index, an empty list if nothing is written, or None if the bounds
+    are not known."""
+
+    if not isinstance( item, tuple ):
+      item = ( item, )
+    indices = []
+    for i in item:
+      if i is None:
+        return None
+      if isinstance( i, list ):
+        i = numpy.asarray( i )
+      indices.append( i )
+
+    def _ndim( i ):
+      if i is Ellipsis:
+        return 0
+      if isinstance( i, numpy.ndarray ) and i.dtype == bool:
+        return i.ndim
+      return 1
+
+    ellipses = [ k for k, i in enumerate( indices ) if i is Ellipsis ]
+    remaining = len( shape ) - sum( _ndim( i ) for i in indices )
+    if len( ellipses ) > 1 or remaining < 0:
+      return None
+    if ellipses:
+      k = ellipses[0]
+      indices[k:k+1] = [ slice( None ) ] * remaining
+    else:
+      indices += [ slice( None ) ] * remaining
+
+    bounds = []
+    for i in indices:
+      axis = len( bounds )
+      if isinstance( i, slice ):
+        r = range( *i.indices( shape[axis] ) )
+        if len( r ) == 0:
+          return []
+        bounds.append( ( min( r[0], r[-1] ), max( r[0], r[-1] ) + 1 ) )
+      elif isinstance( i, numpy.ndarray ) and i.dtype == bool:
+        nonzero = numpy.nonzero( i )
+        if len( nonzero[0] ) == 0:
+          return []
+        bounds += [ ( int( n.min() ), int( n.max() ) + 1 ) for n in nonzero ]
+      else:
+        a = numpy.asarray( i )
+        if a.dtype.kind not in 'iu':
+          return None
+        if a.size == 0:
+          return []
+        a = numpy.where( a < 0, a + shape[axis], a )
+        bounds.append( ( int( a.min() ), int( a.max() ) + 1 ) )
+    return bounds
+
+class _ArrayBlockTracker( object ):
+    """The blocks of a C contiguous array of an image, in array order,
+    which are written through the array or its views."""
+
+    def __init__( self, arr, dim, blockShape ):
+      self.address = arr.__array_interface__['data'][0]
+      self.shape = arr.shape
+      self.strides = arr.strides
+      self.itemsize = arr.itemsize
+      self.blockShape = tuple( blockShape )
+      self.dirty = numpy.zeros( [ ( s + b - 1 ) // b for s, b in zip( arr.shape[:dim], self.blockShape ) ], dtype = bool )
+
+    def _get_base_bounds( self, view, bounds ):
+      """Returns the bounds in the array of the bounds in a view, by
+      matching the strides of the view to the axes of the array."""
+
+      offset = view.__array_interface__['data'][0] - self.address
+      if offset < 0 or offset % self.itemsize:
+        return None
+      try:
+        start = numpy.unravel_index( offset // self.itemsize, self.shape )
+      except ValueError:
+        return None
+      lower = [ int( s ) for s in start ]
+      upper = list( lower )
+      for ( lo, hi ), n, stride in zip( bounds, view.shape, view.strides ):
+        if n == 1 or stride == 0:
+          continue
+        axes = [ j for j, s in enumerate( self.strides ) if abs( stride ) >= s and stride % s == 0 ]
+        if not axes:
+          return None
+        j = axes[0]
+        step = stride // self.strides[j]
+        lower[j] += min( lo * step, ( hi - 1 ) * step )
+        upper[j] += max( lo * step, ( hi - 1 ) * step )
+      # a view which wraps around an axis of the array
+      if any( l < 0 or u >= n for l, u, n in zip( lower, upper, self.shape ) ):
+        return None
+      return [ ( l, u + 1 ) for l, u in zip( lower, upper ) ]
+
+    def Mark( self, view, item = Ellipsis ):
+      bounds = _get_index_bounds( item, view.shape )
+      if bounds is None:
+        bounds = [ ( 0, n ) for n in view.shape ]
+      elif not bounds:
+        return
+      bounds = self._get_base_bounds( view, bounds )
+      if bounds is None:
+        self.dirty[...] = True
+        return
+      self.dirty[ tuple( slice( lo // b, ( hi - 1 ) // b + 1 )
+                         for ( lo, hi ), b in zip( bounds, self.blockShape ) ) ] = True
+
+class _blocktrackedndarray( numpy.ndarray ):
+    """An array whose writes, and the writes of its views, mark the
+    blocks of an _ArrayBlockTracker."""
+
+    _tracker = None
+
+    def __array_finalize__( self, obj ):
+      self._tracker = getattr( obj, '_tracker', None )
+
+    def __setitem__( self, item, value ):
+      if self._tracker is not None:
+        self._tracker.Mark( self, item )
+      super( _blocktrackedndarray, self ).__setitem__( item, value )
+
+    def _mark_all( self ):
+      if self._tracker is not None:
+        self._tracker.Mark( self )
+
+    def fill( self, value ):
+      self._mark_all()
+      super( _blocktrackedndarray, self ).fill( value )
+
+    def put( self, *args, **kwargs ):
+      self._mark_all()
+      super( _blocktrackedndarray, self ).put( *args, **kwargs )
+
+    def sort( self, *args, **kwargs ):
+      self._mark_all()
+      super( _blocktrackedndarray, self ).sort( *args, **kwargs )
+
+    def __array_ufunc__( self, ufunc, method, *inputs, **kwargs ):
+      out = kwargs.get( 'out', () )
+      for o in out:
+        if isinstance( o, _blocktrackedndarray ):
+          o._mark_all()
+      if method == 'at' and isinstance( inputs[0], _blocktrackedndarray ) and inputs[0]._tracker is not None:
+        inputs[0]._tracker.Mark( inputs[0], inputs[1] )
+
+      def _plain( a ):
+        return a.view( numpy.ndarray ) if isinstance( a, _blocktrackedndarray ) else a
+
+      inputs = tuple( _plain( i ) for i in inputs )
+      if out:
+        kwargs['out'] = tuple( _plain( o ) for o in out )
+      results = getattr( ufunc, method )( *inputs, **kwargs )
+      if out:
+        return out[0] if len( out ) == 1 else out
+      return results
+
+    def __array_function__( self, func, types, args, kwargs ):
+      # the functions which write into their first argument
+      if func in ( numpy.copyto, numpy.put, numpy.putmask, numpy.place, numpy.fill_diagonal ) \
+         and args and isinstance( args[0], _blocktrackedndarray ):
+        args[0]._mark_all()
+      return super( _blocktrackedndarray, self ).__array_function__( func, types, args, kwargs )
+
+class SyncedImageArray( object ):
+    """A NumPy array copy of an image, which tracks the blocks written
+    through the array, so that Sync copies only the modified blocks
+    back into the image, in place. The cost of a Sync is proportional
+    to the size of the edits instead of the size of the image.
+
+    Writes through indexing, in place operators, ufuncs with the array
+    as an output and the views of the array are tracked. Writes through
+    other objects which share the memory, e.g. memoryview, are not, use
+    MarkAllDirty after them. Use GetSyncedArrayFromImage to create
+    one."""
+
+    def __init__( self, image, blockSize = 32 ):
+      dim = image.GetDimension()
+      self._image = image
+      self._blockSize = [ max( 1, min( b, s ) ) for b, s in zip( _as_sequence( blockSize, dim ), image.GetSize() ) ]
+      self._array = GetArrayFromImage( image ).view( _blocktrackedndarray )
+      self._tracker = _ArrayBlockTracker( self._array, dim, self._blockSize[::-1] )
+      self._array._tracker = self._tracker
+
+    def __repr__( self ):
+      return "SyncedImageArray( shape = {0}, dtype = {1}, dirty blocks = {2} )".format(
+        self._array.shape, self._array.dtype, self.GetNumberOfDirtyBlocks() )
+
+    def GetArray( self ):
+      return self._array
+
+    def GetImage( self ):
+      return self._image
+
+    def GetBlockSize( self ):
+      return tuple( self._blockSize )
+
+    def GetNumberOfDirtyBlocks( self ):
+      return int( numpy.count_nonzero( self._tracker.dirty ) )
+
+    def MarkAllDirty( self ):
+      self._tracker.dirty[...] = True
+
+    def Sync( self ):
+      """Copies the modified blocks of the array into the image, and
+      returns their number."""
+
+      blocks = numpy.flatnonzero( self._tracker.dirty )
+      if len( blocks ):
+        _SimpleITK._PasteArrayBlocksIntoImage( self._image, self._array.view( numpy.ndarray ), blocks, self._blockSize )
+        self._tracker.dirty[...] = False
+      return len( blocks )
+
+def GetSyncedArrayFromImage( image, blockSize = 32 ):
+    """Returns a SyncedImageArray of the image, a NumPy array copy whose
+    modified blocks of blockSize pixels are copied back into the image
+    by Sync."""
+
+    if not HAVE_NUMPY:
+        raise ImportError('Numpy not available.')
+
+    return SyncedImageArray( image, blockSize )
+
+
+# NumPy ufunc and function protocol support of Image
+
+def _get_array_view_from_image( image, writeable = True ):
+    """Returns a temporary array view of the pixel buffer of an image.
+
+    Unlike GetArrayFromImage( image, arrayview = True ) the view is not
+    registered with the image, it must not be used after the image.
+
+    A writable view makes the buffer of the image unique, i.e. copies
+    a buffer shared with other images. A read only view does not, it
+    keeps a shallow copy of the image alive instead."""
+
+    if not writeable:
+      return _SimpleITK._GetByteArrayFromImage( image, 2 )
+    shape = image.GetSize()
+    if image.GetNumberOfComponentsPerPixel() > 1:
+      shape = ( image.GetNumberOfComponentsPerPixel(), ) + shape
+    imageMemoryView = _SimpleITK._GetByteArrayFromImage( image, 1 )
+    return numpy.asarray( imageMemoryView ).view( dtype = _get_numpy_dtype( image ) ).reshape( shape[::-1] )
+
+def _new_image_like( reference, dtype ):
+    """Returns a new image with the size, components and geometry of the
+    reference and the pixel type of dtype, or None if there is no such
+    pixel type."""
+
+    if dtype == numpy.bool_:
+      dtype = numpy.uint8
+    components = reference.GetNumberOfComponentsPerPixel()
+    pixelID = _lookup_sitk_pixelid( numpy.empty( 0, dtype ), _get_pixelid_maps()[2 if components > 1 else 1] )
+    if pixelID is None or pixelID in ( sitkComplexFloat32, sitkComplexFloat64 ):
+      return None
+    if components > 1:
+      image = Image( reference.GetSize(), pixelID, components )
+    else:
+      image = Image( reference.GetSize(), pixelID )
+    image.CopyInformation( reference )
+    return image
+
+def _replace_images( values, views, writeable = False ):
+    """Replaces the images in a sequence, or in the sequences of a
+    sequence, with temporary array views. The views are added to the
+    views dictionary, an image which already has a view keeps it, so
+    the outputs are replaced first."""
+
+    def replace( value ):
+      if isinstance( value, _get_image_types() ):
+        if id( value ) not in views:
+          views[id(value)] = ( value, _get_array_view_from_image( value, writeable ) )
+        return views[id(value)][1]
+      if type(value) in ( list, tuple ):
+        return type(value)( replace( v ) for v in value )
+      return value
+
+    return [ replace( v ) for v in values ]
+
+def _image_array_ufunc( ufunc, method, inputs, kwargs ):
+    """Implements __array_ufunc__ of Image.
+
+    The ufunc operates directly on the pixel buffers of the images. A
+    result with the shape of the image is computed into a new image
+    with the geometry of the first image. Image outputs are written in
+    place. Other results, e.g. of reductions, are returned as is."""
+
+    views = {}
+    out = kwargs.get( 'out', () )
+    if out:
+      # the images of out are written, the inputs are only read
+      kwargs['out'] = tuple( _replace_images( out, views, writeable = True ) )
+    arrays = _replace_images( inputs, views )
+
+    if out:
+      result = getattr( ufunc, method )( *arrays, **kwargs )
+      results = result if ufunc.nout > 1 else ( result, )
+      results = tuple( o if isinstance( o, _get_image_types() ) else r for o, r in zip( out, results ) )
+      return results if ufunc.nout > 1 else results[0]
+
+    reference = None
+    for i in inputs:
+      if isinstance( i, _get_image_types() ):
+        reference = i
+        break
+
+    if method != '__call__' or reference is None:
+      return getattr( ufunc, method )( *arrays, **kwargs )
+
+    if numpy.broadcast( *arrays ).shape != views[id(reference)][1].shape:
+      return ufunc( *arrays, **kwargs )
+
+    # the output pixel types, from the computation of one pixel
+    probe = [ a.reshape( -1 )[:1] if isinstance( a, numpy.ndarray ) and a.size else a for a in arrays ]
+    probeKwargs = dict( kwargs )
+    probeKwargs.pop( 'where', None )
+    with numpy.errstate( all = 'ignore' ):
+      probe = ufunc( *probe, **probeKwargs )
+    probe = probe if ufunc.nout > 1 else ( probe, )
+
+    outputs = tuple( _new_image_like( reference, p.dtype ) for p in probe )
+    if any( o is None for o in outputs ):
+      return ufunc( *arrays, **kwargs )
+
+    kwargs['out'] = tuple( _get_array_view_from_image( o ) for o in outputs )
+    ufunc( *arrays, **kwargs )
+    return outputs if ufunc.nout > 1 else outputs[0]
+
+def _numpy_clip_ufunc():
+    for core in ( '_core', 'core' ):
+      umath = getattr( getattr( numpy, core, None ), 'umath', None )
+      if isinstance( getattr( umath, 'clip', None ), numpy.ufunc ):
+        return umath.clip
+    return None
+
+_image_array_inplace_functions = set( getattr( numpy, f ) for f in
+                                      ( 'copyto', 'put', 'place', 'putmask', 'fill_diagonal', 'put_along_axis' )
+                                      if hasattr( numpy, f ) )
+
+def _image_array_function( func, types, args, kwargs ):
+    """Implements __array_function__ of Image.
+
+    numpy.clip is computed with its ufunc. Other functions operate on
+    array views of the images, a result with the shape of the first
+    image is copied into a new image with its geometry."""
+
+    if not all( issubclass( t, ( numpy.ndarray, ) + _get_image_types() ) for t in types ):
+      return NotImplemented
+
+    if func is numpy.clip and len(args) == 3 and _numpy_clip_ufunc() is not None:
+      a, a_min, a_max = args
+      if a_min is None:
+        return _image_array_ufunc( numpy.minimum, '__call__', ( a, a_max ), kwargs )
+      if a_max is None:
+        return _image_array_ufunc( numpy.maximum, '__call__', ( a, a_min ), kwargs )
+      return _image_array_ufunc( _numpy_clip_ufunc(), '__call__', args, kwargs )
+
+    views = {}
+    if 'out' in kwargs:
+      _replace_images( ( kwargs['out'], ), views, writeable = True )
+    # these functions write into their first argument
+    if func in _image_array_inplace_functions and args:
+      _replace_images( args[:1], views, writeable = True )
+    arrays = _replace_images( args, views )
+    kwarrays = dict( zip( kwargs.keys(), _replace_images( kwargs.values(), views ) ) )
+    result = func( *arrays, **kwarrays )
+
+    out = kwargs.get( 'out', None )
+    if isinstance( out, _get_image_types() ):
+      return out
+
+    reference = None
+    for a in args:
+      if isinstance( a, _get_image_types() ):
+        reference = a
+        break
+
+    if ( reference is not None and isinstance( result, numpy.ndarray )
+         and result.shape == views[id(reference)][1].shape
+         and not any( numpy.may_share_memory( result, v[1] ) for v in views.values() ) ):
+      image = _new_image_like( reference, result.dtype )
+      if image is not None:
+        _get_array_view_from_image( image )[...] = result
+        return image
+    return result
+
+
+# Pickle support of Image
+
+def _image_reduce( image, protocol ):
+    """Returns the pickle reduction of an image.
+
+    The geometry is pickled in band. With protocol 5 the pixels are a
+    PickleBuffer of a read only view which keeps them alive, so they
+    can be transferred out of band without a copy."""
+
+    metadata = ( image.GetSize(), image.GetPixelIDValue(), image.GetNumberOfComponentsPerPixel(),
+                 image.GetSpacing(), image.GetOrigin(), image.GetDirection() )
+    if protocol >= 5:
+      import pickle
+      buffer = pickle.PickleBuffer( _SimpleITK._GetByteArrayFromImage( image, 2 ) )
+    else:
+      buffer = _SimpleITK._GetByteArrayFromImage( image, 0 )
+    return ( _image_from_pickle, ( metadata, buffer ) )
+
+def _image_from_pickle( metadata, buffer ):
+    """Creates the unpickled image, which uses a writable buffer without
+    a copy and copies a read only one."""
+
+    size, pixelID, components, spacing, origin, direction = metadata
+    image = _SimpleITK._SetImageFromArray( buffer, 2, size, pixelID, components )
+    image.SetSpacing( spacing )
+    image.SetOrigin( origin )
+    image.SetDirection( direction )
+    return image
+
+
+# Run length encoded label images
+
+class RunLengthLabelImage( object ):
+    """A label image compressed with run length encoding along the rows
+    of the fastest axis.
+
+    Each row is stored as the runs of equal, non zero labels. The runs
+    of the rows are indexed, so single slices are decoded without the
+    others, and the coordinates of the labeled pixels are computed
+    without a dense array. Use GetRunLengthLabelImageFromImage and
+    GetRunLengthLabelImageFromArray to create one."""
+
+    def __init__( self, size, rowOffsets, starts, lengths, labels,
+                  spacing = None, origin = None, direction = None ):
+      dim = len( size )
+      self._size = tuple( int(s) for s in size )
+      self._rowOffsets = rowOffsets
+      self._starts = starts
+      self._lengths = lengths
+      self._labels = labels
+      self._spacing = tuple( spacing ) if spacing is not None else ( 1.0, ) * dim
+      self._origin = tuple( origin ) if origin is not None else ( 0.0, ) * dim
+      self._direction = tuple( direction ) if direction is not None else \
+        tuple( float( i == j ) for i in range( dim ) for j in range( dim ) )
+
+    def __repr__( self ):
+      return "RunLengthLabelImage( size = {0}, dtype = {1}, runs = {2} )".format(
+        self._size, self._labels.dtype, self.GetNumberOfRuns() )
+
+    def GetSize( self ):
+      return self._size
+
+    def GetDimension( self ):
+      return len( self._size )
+
+    def GetSpacing( self ):
+      return self._spacing
+
+    def GetOrigin( self ):
+      return self._origin
+
+    def GetDirection( self ):
+      return self._direction
+
+    def GetNumberOfRuns( self ):
+      return len( self._labels )
+
+    def GetMemorySize( self ):
+      """The number of bytes of the encoding."""
+      return sum( a.nbytes for a in ( self._rowOffsets, self._starts, self._lengths, self._labels ) )
+
+    def GetNumberOfSlices( self ):
+      return self._size[-1]
+
+    def _DecodeRows( self, rowBegin, rowEnd, output ):
+      if rowEnd > rowBegin:
+        _SimpleITK._DecodeRunLength( self._rowOffsets, self._starts, self._lengths, self._labels,
+                                     output, rowBegin, rowEnd )
+      return output
+
+    def GetArray( self ):
+      """Returns the dense array of the labels, indexed as the arrays of
+      GetArrayFromImage."""
+      return self._DecodeRows( 0, len( self._rowOffsets ) - 1,
+                               numpy.empty( self._size[::-1], self._labels.dtype ) )
+
+    def GetSliceArray( self, index ):
+      """Returns the dense array of a single slice of the slowest axis."""
+      index = int( index )
+      if index < 0:
+        index += self._size[-1]
+      if not 0 <= index < self._size[-1]:
+        raise IndexError( "slice index out of range" )
+      rowsPerSlice = ( len( self._rowOffsets ) - 1 ) // self._size[-1]
+      return self._DecodeRows( index * rowsPerSlice, ( index + 1 ) * rowsPerSlice,
+                               numpy.empty( self._size[-2::-1], self._labels.dtype ) )
+
+    def GetImage( self ):
+      """Returns a new image of the labels, with a scalar pixel type."""
+      dtype = numpy.uint8 if self._labels.dtype == numpy.bool_ else self._labels.dtype
+      image = Image( self._size, _get_sitk_pixelid( numpy.empty( 0, dtype ) ) )
+      image.SetSpacing( self._spacing )
+      image.SetOrigin( self._origin )
+      image.SetDirection( self._direction )
+      self._DecodeRows( 0, len( self._rowOffsets ) - 1,
+                        _get_array_view_from_image( image ).view( self._labels.dtype ) )
+      return image
+
+    def GetCOO( self ):
+      """Returns the coordinates of the labeled pixels, an ( N, dimension )
+      array indexed as the arrays of GetArrayFromImage, and their labels."""
+      lengths = self._lengths.astype( numpy.intp )
+      rowOfRun = numpy.repeat( numpy.arange( len( self._rowOffsets ) - 1 ), numpy.diff( self._rowOffsets ) )
+      runOfPixel = numpy.repeat( numpy.arange( len( lengths ) ), lengths )
+      firstPixel = numpy.cumsum( lengths ) - lengths
+      x = self._starts[runOfPixel] + ( numpy.arange( len( runOfPixel ) ) - firstPixel[runOfPixel] )
+      indices = numpy.unravel_index( rowOfRun[runOfPixel], self._size[:0:-1] ) + ( x, )
+      return numpy.stack( indices, axis = 1 ), self._labels[runOfPixel]
+
+def GetRunLengthLabelImageFromArray( arr ):
+    """Run length encodes an integer label array, indexed as the arrays
+    of GetArrayFromImage."""
+
+    if not HAVE_NUMPY:
+        raise ImportError('Numpy not available.')
+
+    arr = numpy.asarray( arr )
+    rowOffsets, starts, lengths, labels = _SimpleITK._EncodeRunLength( arr, arr.shape[-1] )
+    return RunLengthLabelImage( arr.shape[::-1], rowOffsets, starts, lengths, labels )
+
+def GetRunLengthLabelImageFromImage( image ):
+    """Run length encodes a scalar integer image or a label map image."""
+
+    if not HAVE_NUMPY:
+        raise ImportError('Numpy not available.')
+
+    if image.GetPixelIDValue() in ( sitkLabelUInt8, sitkLabelUInt16, sitkLabelUInt32, sitkLabelUInt64 ):
+      image = LabelMapToLabel( image )
+    if image.GetNumberOfComponentsPerPixel() != 1:
+      raise TypeError( "Only scalar images can be run length encoded." )
+    size = image.GetSize()
+    rowOffsets, starts, lengths, labels = _SimpleITK._EncodeRunLength( _get_array_view_from_image( image, writeable = False ), size[0] )
+    return RunLengthLabelImage( size, rowOffsets, starts, lengths, labels,
+                                image.GetSpacing(), image.GetOrigin(), image.GetDirection() )
+
 %}
 
 
@@ -34835,6 +34835,23 @@ See:
 %feature("docstring")  itk::simple::Atan2 "
 ";
 
+%feature("docstring")  itk::simple::AttachSharedMemoryImage "
+
+Returns an image of the pixels of an existing shared memory segment,
+created with CreateSharedMemoryImage in any process.
+
+The pixels are not copied. An exception is thrown if there is no such
+segment, or if it has already been removed.
+
+Warning:
+The pixels are only shared while the image is not shared with another
+SimpleITK image in the same process, e.g. a copy with the Image
+constructor, or the input held by a filter. The next write to either
+image, e.g. SetPixel or a writable array view, then copies the pixels
+out of the segment, and the write is not seen by the other processes.
+
+";
+
 %feature("docstring")  itk::simple::Bilateral "
 
 Blurs an image while preserving edges.
@@ -35536,6 +35553,25 @@ See:
 %feature("docstring")  itk::simple::CreateKernel "
 ";
 
+%feature("docstring")  itk::simple::CreateSharedMemoryImage "
+
+Creates an image whose pixel buffer is a new named shared memory
+segment, initialized with zeros, or with a copy of the pixels and the
+geometry of an image.
+
+Other processes get an image of the same pixels, without copying, with
+AttachSharedMemoryImage. The segment is removed when the last image or
+view of it, in any process, is deleted.
+
+Warning:
+The pixels are only shared while the image is not shared with another
+SimpleITK image in the same process, e.g. a copy with the Image
+constructor, or the input held by a filter. The next write to either
+image, e.g. SetPixel or a writable array view, then copies the pixels
+out of the segment, and the write is not seen by the other processes.
+
+";
+
 %feature("docstring")  itk::simple::Crop "
 
 Decrease the image size by cropping the image by an itk::Size at both the upper and lower bounds of the largest possible region.
@@ -215,6 +215,8 @@ namespace std
 
 //#if SWIGPYTHON
 %include "sitkPyCommand.h"
+%include "sitkSharedMemoryImage.h"
+%include "sitkRawFileImage.h"
 //#endif
 
 //#if SWIGR
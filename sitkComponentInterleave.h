@@ -0,0 +1,238 @@
+/*=========================================================================
+*
+*  Copyright Insight Software Consortium
+*
+*  Licensed under the Apache License, Version 2.0 (the "License");
+*  you may not use this file except in compliance with the License.
+*  You may obtain a copy of the License at
+*
+*         http://www.apache.org/licenses/LICENSE-2.0.txt
+*
+*  Unless required by applicable law or agreed to in writing, software
+*  distributed under the License is distributed on an "AS IS" BASIS,
+*  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+*  See the License for the specific language governing permissions and
+*  limitations under the License.
+*
+*=========================================================================*/
+#ifndef __sitkComponentInterleave_h
+#define __sitkComponentInterleave_h
+
+#include <stdint.h>
+
+#include <algorithm>
+
+#include "sitkParallelFor.h"
+#include "sitkConversionStatistics.h"
+
+namespace itk
+{
+namespace simple
+{
+
+/** \class ComponentInterleave
+ *  \brief Converts the pixel components of a vector image between the
+ *  interleaved layout of the image buffer and a planar layout, with
+ *  the components of each pixel in a separate plane.
+ *
+ * The kernels for 2, 3 and 4 components have the number of components
+ * as a template argument, so that the compiler vectorizes the strided
+ * loads and stores with shuffles. Other numbers of components are
+ * copied a plane at a time. The pixels are processed in blocks, which
+ * are distributed over the ITK threads. With a statistics reducer the
+ * statistics of the source components are computed as each block is
+ * copied.
+ */
+template< typename TElement >
+class ComponentInterleave
+{
+public:
+  typedef TElement ElementType;
+
+  /** The number of pixels of a block. */
+  enum { BlockSize = 4096 };
+
+  /** Copies the interleaved components of the pixels into
+   * numberOfComponents planes of numberOfPixels elements. */
+  static void Deinterleave( const ElementType * source,
+                            ElementType * destination,
+                            size_t numberOfPixels,
+                            unsigned int numberOfComponents,
+                            ConversionStatisticsReducer * statistics = NULL )
+    {
+    Function< false > function( source, destination, numberOfPixels, numberOfComponents, statistics );
+    ParallelFor( ( numberOfPixels + BlockSize - 1 ) / BlockSize, GetGrainSize( numberOfComponents ), function );
+    }
+
+  /** Copies numberOfComponents planes of numberOfPixels elements into
+   * the interleaved components of the pixels. */
+  static void Interleave( const ElementType * source,
+                          ElementType * destination,
+                          size_t numberOfPixels,
+                          unsigned int numberOfComponents,
+                          ConversionStatisticsReducer * statistics = NULL )
+    {
+    Function< true > function( source, destination, numberOfPixels, numberOfComponents, statistics );
+    ParallelFor( ( numberOfPixels + BlockSize - 1 ) / BlockSize, GetGrainSize( numberOfComponents ), function );
+    }
+
+private:
+
+  // at least 64K elements per thread
+  static size_t GetGrainSize( unsigned int numberOfComponents )
+    {
+    return std::max( size_t(1), size_t(65536) / ( size_t( BlockSize ) * std::max( numberOfComponents, 1u ) ) );
+    }
+
+  template< unsigned int VComponents >
+  static void DeinterleaveBlock( const ElementType * source, ElementType * destination,
+                                 size_t begin, size_t end, size_t numberOfPixels )
+    {
+    for( size_t i = begin; i < end; ++i )
+      {
+      for( unsigned int c = 0; c < VComponents; ++c )
+        {
+        destination[c * numberOfPixels + i] = source[i * VComponents + c];
+        }
+      }
+    }
+
+  template< unsigned int VComponents >
+  static void InterleaveBlock( const ElementType * source, ElementType * destination,
+                               size_t begin, size_t end, size_t numberOfPixels )
+    {
+    for( size_t i = begin; i < end; ++i )
+      {
+      for( unsigned int c = 0; c < VComponents; ++c )
+        {
+        destination[i * VComponents + c] = source[c * numberOfPixels + i];
+        }
+      }
+    }
+
+  template< bool VInterleave >
+  struct Function
+  {
+    Function( const ElementType * source, ElementType * destination,
+              size_t numberOfPixels, unsigned int numberOfComponents,
+              ConversionStatisticsReducer * statistics )
+      : m_Source( source ), m_Destination( destination ),
+        m_NumberOfPixels( numberOfPixels ), m_NumberOfComponents( numberOfComponents ),
+        m_Statistics( statistics ) {}
+
+    void operator()( size_t beginBlock, size_t endBlock ) const
+      {
+      const size_t begin = beginBlock * BlockSize;
+      const size_t end = std::min( endBlock * BlockSize, m_NumberOfPixels );
+      switch( m_NumberOfComponents )
+        {
+        case 2:
+          this->template CopyBlock< 2 >( begin, end );
+          break;
+        case 3:
+          this->template CopyBlock< 3 >( begin, end );
+          break;
+        case 4:
+          this->template CopyBlock< 4 >( begin, end );
+          break;
+        default:
+          this->CopyPlanes( begin, end );
+        }
+
+      // the source components of the block, which are still in the cache
+      ConversionStatisticsAccumulator accumulator( m_Statistics );
+      if( VInterleave )
+        {
+        for( size_t c = 0; c < m_NumberOfComponents; ++c )
+          {
+          accumulator.Add( m_Source, c * m_NumberOfPixels + begin, end - begin );
+          }
+        }
+      else
+        {
+        accumulator.Add( m_Source, begin * m_NumberOfComponents, ( end - begin ) * m_NumberOfComponents );
+        }
+      }
+
+    template< unsigned int VComponents >
+    void CopyBlock( size_t begin, size_t end ) const
+      {
+      if( VInterleave )
+        {
+        InterleaveBlock< VComponents >( m_Source, m_Destination, begin, end, m_NumberOfPixels );
+        }
+      else
+        {
+        DeinterleaveBlock< VComponents >( m_Source, m_Destination, begin, end, m_NumberOfPixels );
+        }
+      }
+
+    // a plane at a time, the interleaved block is reused from the cache
+    void CopyPlanes( size_t begin, size_t end ) const
+      {
+      const size_t n = m_NumberOfComponents;
+      for( size_t c = 0; c < n; ++c )
+        {
+        for( size_t i = begin; i < end; ++i )
+          {
+          if( VInterleave )
+            {
+            m_Destination[i * n + c] = m_Source[c * m_NumberOfPixels + i];
+            }
+          else
+            {
+            m_Destination[c * m_NumberOfPixels + i] = m_Source[i * n + c];
+            }
+          }
+        }
+      }
+
+    const ElementType *           m_Source;
+    ElementType *                 m_Destination;
+    size_t                        m_NumberOfPixels;
+    unsigned int                  m_NumberOfComponents;
+    ConversionStatisticsReducer * m_Statistics;
+  };
+};
+
+
+/** Copies the interleaved components of a buffer of elements of
+ * elementSize bytes into planes, or the planes into interleaved
+ * components, see ComponentInterleave. The statistics of the source
+ * are computed in the same pass if a reducer is given. Returns false
+ * if the element size is not supported. */
+inline bool ConvertComponentLayout( const void * source,
+                                    void * destination,
+                                    size_t elementSize,
+                                    size_t numberOfPixels,
+                                    unsigned int numberOfComponents,
+                                    bool interleave,
+                                    ConversionStatisticsReducer * statistics = NULL )
+{
+  switch( elementSize )
+    {
+    case 1:
+      ( interleave ? ComponentInterleave< uint8_t >::Interleave : ComponentInterleave< uint8_t >::Deinterleave )
+        ( static_cast< const uint8_t * >( source ), static_cast< uint8_t * >( destination ), numberOfPixels, numberOfComponents, statistics );
+      return true;
+    case 2:
+      ( interleave ? ComponentInterleave< uint16_t >::Interleave : ComponentInterleave< uint16_t >::Deinterleave )
+        ( static_cast< const uint16_t * >( source ), static_cast< uint16_t * >( destination ), numberOfPixels, numberOfComponents, statistics );
+      return true;
+    case 4:
+      ( interleave ? ComponentInterleave< uint32_t >::Interleave : ComponentInterleave< uint32_t >::Deinterleave )
+        ( static_cast< const uint32_t * >( source ), static_cast< uint32_t * >( destination ), numberOfPixels, numberOfComponents, statistics );
+      return true;
+    case 8:
+      ( interleave ? ComponentInterleave< uint64_t >::Interleave : ComponentInterleave< uint64_t >::Deinterleave )
+        ( static_cast< const uint64_t * >( source ), static_cast< uint64_t * >( destination ), numberOfPixels, numberOfComponents, statistics );
+      return true;
+    default:
+      return false;
+    }
+}
+
+} // namespace simple
+} // namespace itk
+
+#endif // __sitkComponentInterleave_h
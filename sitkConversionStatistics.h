@@ -0,0 +1,351 @@
+/*=========================================================================
+*
+*  Copyright Insight Software Consortium
+*
+*  Licensed under the Apache License, Version 2.0 (the "License");
+*  you may not use this file except in compliance with the License.
+*  You may obtain a copy of the License at
+*
+*         http://www.apache.org/licenses/LICENSE-2.0.txt
+*
+*  Unless required by applicable law or agreed to in writing, software
+*  distributed under the License is distributed on an "AS IS" BASIS,
+*  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+*  See the License for the specific language governing permissions and
+*  limitations under the License.
+*
+*=========================================================================*/
+#ifndef __sitkConversionStatistics_h
+#define __sitkConversionStatistics_h
+
+#include <string.h>
+#include <math.h>
+
+#include <algorithm>
+#include <limits>
+#include <vector>
+
+#include "sitkPixelIDDispatchTable.h"
+#include "sitkParallelFor.h"
+#include "itkSimpleFastMutexLock.h"
+#include "itkMutexLockHolder.h"
+
+namespace itk
+{
+namespace simple
+{
+
+/** \class ConversionStatistics
+ *  \brief The statistics of the pixel components of a buffer, and
+ *  optionally their histogram.
+ *
+ * Not a number components are not counted. The histogram has
+ * equal width bins over [HistogramMinimum, HistogramMaximum], the
+ * maximum is in the last bin and values out of the range are not
+ * counted, as with numpy.histogram. An empty range [v, v] is widened
+ * to [v - 0.5, v + 0.5], so v is in the middle bin.
+ */
+struct ConversionStatistics
+{
+  ConversionStatistics( void )
+    : Count( 0 ),
+      Minimum( std::numeric_limits< double >::infinity() ),
+      Maximum( -std::numeric_limits< double >::infinity() ),
+      Mean( 0.0 ),
+      SumOfSquaredDeviations( 0.0 ),
+      HistogramMinimum( 0.0 ),
+      HistogramMaximum( 0.0 ) {}
+
+  double GetSum( void ) const
+    {
+    return Mean * Count;
+    }
+
+  /** The unbiased variance, as the one of StatisticsImageFilter. */
+  double GetVariance( void ) const
+    {
+    return Count > 1 ? SumOfSquaredDeviations / ( Count - 1 ) : 0.0;
+    }
+
+  /** Adds the statistics of another part of the buffer, with the
+   * same histogram bins or without a histogram. */
+  void Merge( const ConversionStatistics & other )
+    {
+    if( other.Count == 0 )
+      {
+      return;
+      }
+    const double count = static_cast< double >( Count + other.Count );
+    const double delta = other.Mean - Mean;
+    Mean += delta * other.Count / count;
+    SumOfSquaredDeviations += other.SumOfSquaredDeviations + delta * delta * Count * other.Count / count;
+    Count += other.Count;
+    Minimum = std::min( Minimum, other.Minimum );
+    Maximum = std::max( Maximum, other.Maximum );
+    for( size_t b = 0; b < other.Histogram.size(); ++b )
+      {
+      Histogram[b] += other.Histogram[b];
+      }
+    }
+
+  size_t                 Count;
+  double                 Minimum;
+  double                 Maximum;
+  double                 Mean;
+  double                 SumOfSquaredDeviations;
+
+  std::vector< size_t >  Histogram;
+  double                 HistogramMinimum;
+  double                 HistogramMaximum;
+};
+
+
+/** \class ConversionStatisticsReducer
+ *  \brief The statistics of a copy shared by its threads, which
+ *  compute the statistics of blocks of components with a
+ *  ConversionStatisticsAccumulator each.
+ */
+class ConversionStatisticsReducer
+{
+public:
+  /** The histogram of the statistics defines the number of bins and
+   * the range, if it is requested. */
+  ConversionStatisticsReducer( const PixelIDDispatchEntry & entry,
+                               ConversionStatistics & statistics )
+    : m_Entry( entry ), m_Statistics( statistics ) {}
+
+  const PixelIDDispatchEntry & GetEntry( void ) const
+    {
+    return m_Entry;
+    }
+
+  size_t GetNumberOfBins( void ) const
+    {
+    return m_Statistics.Histogram.size();
+    }
+
+  /** Adds the statistics of a thread. */
+  void Merge( const ConversionStatistics & statistics )
+    {
+    MutexLockHolder< SimpleFastMutexLock > lock( m_Mutex );
+    m_Statistics.Merge( statistics );
+    }
+
+  /** Returns the statistics of a block, whose histogram is added to
+   * the histogram of the thread. */
+  ConversionStatistics ComputeBlock( double * values, size_t n, std::vector< size_t > & histogram ) const
+    {
+    ConversionStatistics result;
+
+    // not a number values are moved to the end of the block
+    if( !m_Entry.ComponentIsInteger )
+      {
+      n = std::remove_if( values, values + n, IsNaN ) - values;
+      }
+    if( n == 0 )
+      {
+      return result;
+      }
+
+    double minimum = values[0];
+    double maximum = values[0];
+    double sum = 0.0;
+    for( size_t i = 0; i < n; ++i )
+      {
+      minimum = std::min( minimum, values[i] );
+      maximum = std::max( maximum, values[i] );
+      sum += values[i];
+      }
+    const double mean = sum / n;
+    double sumOfSquaredDeviations = 0.0;
+    for( size_t i = 0; i < n; ++i )
+      {
+      sumOfSquaredDeviations += ( values[i] - mean ) * ( values[i] - mean );
+      }
+
+    result.Count = n;
+    result.Minimum = minimum;
+    result.Maximum = maximum;
+    result.Mean = mean;
+    result.SumOfSquaredDeviations = sumOfSquaredDeviations;
+
+    const size_t bins = histogram.size();
+    if( bins > 0 )
+      {
+      double lower = m_Statistics.HistogramMinimum;
+      double upper = m_Statistics.HistogramMaximum;
+      if( lower == upper )
+        {
+        lower -= 0.5;
+        upper += 0.5;
+        }
+      const double scale = bins / ( upper - lower );
+      for( size_t i = 0; i < n; ++i )
+        {
+        if( values[i] >= lower && values[i] <= upper )
+          {
+          const size_t b = static_cast< size_t >( ( values[i] - lower ) * scale );
+          ++histogram[ std::min( b, bins - 1 ) ];
+          }
+        }
+      }
+    return result;
+    }
+
+private:
+  static bool IsNaN( double value )
+    {
+    return value != value;
+    }
+
+  const PixelIDDispatchEntry & m_Entry;
+  ConversionStatistics &       m_Statistics;
+  SimpleFastMutexLock          m_Mutex;
+};
+
+
+/** \class ConversionStatisticsAccumulator
+ *  \brief Accumulates the statistics of the components a thread of a
+ *  copy reads, e.g. the rows of the tiles of a transpose.
+ *
+ * The components are converted to double into a block, whose
+ * statistics are computed when it is full, so runs of any length are
+ * added while they are in the cache. The statistics are merged into
+ * the reducer when the accumulator is destroyed. Without a reducer
+ * nothing is computed.
+ */
+class ConversionStatisticsAccumulator
+{
+public:
+  /** The number of components of a block. */
+  enum { BlockSize = 4096 };
+
+  explicit ConversionStatisticsAccumulator( ConversionStatisticsReducer * reducer )
+    : m_Reducer( reducer ), m_NumberOfValues( 0 )
+    {
+    if( m_Reducer )
+      {
+      m_Values.resize( BlockSize );
+      m_Statistics.Histogram.resize( m_Reducer->GetNumberOfBins(), 0 );
+      }
+    }
+
+  ~ConversionStatisticsAccumulator( void )
+    {
+    if( m_Reducer )
+      {
+      this->ComputeBlock();
+      m_Reducer->Merge( m_Statistics );
+      }
+    }
+
+  /** Adds n components, starting at component offset of a buffer. */
+  void Add( const void * buffer, size_t offset, size_t n )
+    {
+    if( !m_Reducer )
+      {
+      return;
+      }
+    while( n > 0 )
+      {
+      const size_t m = std::min( n, size_t( BlockSize ) - m_NumberOfValues );
+      m_Reducer->GetEntry().LoadComponents( buffer, offset, m, &m_Values[m_NumberOfValues] );
+      m_NumberOfValues += m;
+      offset += m;
+      n -= m;
+      if( m_NumberOfValues == BlockSize )
+        {
+        this->ComputeBlock();
+        }
+      }
+    }
+
+private:
+  ConversionStatisticsAccumulator( const ConversionStatisticsAccumulator & );
+  void operator=( const ConversionStatisticsAccumulator & );
+
+  void ComputeBlock( void )
+    {
+    if( m_NumberOfValues > 0 )
+      {
+      m_Statistics.Merge( m_Reducer->ComputeBlock( &m_Values[0], m_NumberOfValues, m_Statistics.Histogram ) );
+      m_NumberOfValues = 0;
+      }
+    }
+
+  ConversionStatisticsReducer * m_Reducer;
+  std::vector< double >         m_Values;
+  size_t                        m_NumberOfValues;
+  ConversionStatistics          m_Statistics;
+};
+
+
+/** The implementation of CopyWithStatistics. */
+class ConversionStatisticsFunction
+{
+public:
+  /** The number of components of a block. */
+  enum { BlockSize = ConversionStatisticsAccumulator::BlockSize };
+
+  ConversionStatisticsFunction( ConversionStatisticsReducer & reducer,
+                                const void * source,
+                                void * destination,
+                                size_t numberOfComponents )
+    : m_Reducer( reducer ), m_Source( source ), m_Destination( destination ),
+      m_NumberOfComponents( numberOfComponents ) {}
+
+  void operator()( size_t beginBlock, size_t endBlock ) const
+    {
+    const size_t componentSize = m_Reducer.GetEntry().ComponentSize;
+    ConversionStatisticsAccumulator accumulator( &m_Reducer );
+
+    for( size_t block = beginBlock; block < endBlock; ++block )
+      {
+      const size_t offset = block * BlockSize;
+      const size_t n = std::min( size_t( BlockSize ), m_NumberOfComponents - offset );
+      if( m_Destination )
+        {
+        memcpy( static_cast< char * >( m_Destination ) + offset * componentSize,
+                static_cast< const char * >( m_Source ) + offset * componentSize,
+                n * componentSize );
+        }
+      accumulator.Add( m_Source, offset, n );
+      }
+    }
+
+private:
+  ConversionStatisticsReducer & m_Reducer;
+  const void *                  m_Source;
+  void *                        m_Destination;
+  size_t                        m_NumberOfComponents;
+};
+
+
+/** \brief Copies a buffer of pixel components and computes their
+ * statistics in the same pass.
+ *
+ * The buffer is processed in blocks, each block is copied and its
+ * statistics computed while it is in the cache. Blocks are
+ * distributed over the ITK threads and the statistics of the threads
+ * are merged at the end. The destination may be NULL to only compute
+ * the statistics, e.g. of a view. The histogram of the statistics
+ * defines the number of bins and the range, if it is requested.
+ */
+inline void CopyWithStatistics( const PixelIDDispatchEntry & entry,
+                                const void * source,
+                                void * destination,
+                                size_t numberOfComponents,
+                                ConversionStatistics & statistics )
+{
+  ConversionStatisticsReducer reducer( entry, statistics );
+  ConversionStatisticsFunction function( reducer, source, destination, numberOfComponents );
+  const size_t numberOfBlocks = ( numberOfComponents + ConversionStatisticsFunction::BlockSize - 1 )
+    / ConversionStatisticsFunction::BlockSize;
+  // at least 256K components per thread
+  ParallelFor( numberOfBlocks, 64, function );
+}
+
+} // namespace simple
+} // namespace itk
+
+#endif // __sitkConversionStatistics_h
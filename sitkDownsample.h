@@ -0,0 +1,211 @@
+/*=========================================================================
+*
+*  Copyright Insight Software Consortium
+*
+*  Licensed under the Apache License, Version 2.0 (the "License");
+*  you may not use this file except in compliance with the License.
+*  You may obtain a copy of the License at
+*
+*         http://www.apache.org/licenses/LICENSE-2.0.txt
+*
+*  Unless required by applicable law or agreed to in writing, software
+*  distributed under the License is distributed on an "AS IS" BASIS,
+*  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+*  See the License for the specific language governing permissions and
+*  limitations under the License.
+*
+*=========================================================================*/
+#ifndef __sitkDownsample_h
+#define __sitkDownsample_h
+
+#include <math.h>
+#include <string.h>
+
+#include <algorithm>
+#include <vector>
+
+#include "sitkParallelFor.h"
+#include "sitkPixelIDDispatchTable.h"
+
+namespace itk
+{
+namespace simple
+{
+
+/** \class DownsampleImage
+ *  \brief Shrinks an image buffer by integer factors into a new buffer
+ *  of the same pixel type, without a full resolution copy.
+ *
+ * Pixel x of the output is the block of pixels [x * f, (x + 1) * f)
+ * of the input along each axis, the blocks at the end of an axis are
+ * clipped to the input. With nearest, the output pixel is the first
+ * pixel of the block, as with the slice [::f] of an array, and only
+ * those pixels are read. Otherwise it is the mean of the block, for
+ * each component, rounded to the nearest integer for integer types.
+ *
+ * The mean accumulates the rows of a block as doubles with the
+ * LoadComponents kernel of the pixel type, then sums the runs of each
+ * accumulated row. The output rows are distributed over the ITK
+ * threads.
+ */
+class DownsampleImage
+{
+public:
+  DownsampleImage( const PixelIDDispatchEntry & entry,
+                   const std::vector< unsigned int > & size,
+                   unsigned int numberOfComponents,
+                   const std::vector< unsigned int > & shrinkFactors,
+                   bool nearest )
+    : m_Entry( &entry ), m_Size( size ), m_ShrinkFactors( shrinkFactors ),
+      m_NumberOfComponents( numberOfComponents ), m_Nearest( nearest ),
+      m_Source( NULL ), m_Destination( NULL )
+    {
+    for( size_t d = 0; d < size.size(); ++d )
+      {
+      m_OutputSize.push_back( ( size[d] + shrinkFactors[d] - 1 ) / shrinkFactors[d] );
+      }
+    }
+
+  /** The size of the output, each axis of the input divided by its
+   * factor and rounded up. */
+  const std::vector< unsigned int > & GetOutputSize( void ) const
+    {
+    return m_OutputSize;
+    }
+
+  void Downsample( const void * source, void * destination )
+    {
+    m_Source      = static_cast< const char * >( source );
+    m_Destination = static_cast< char * >( destination );
+
+    size_t numberOfRows = 1;
+    size_t blockRows = 1;
+    for( size_t d = 1; d < m_Size.size(); ++d )
+      {
+      numberOfRows *= m_OutputSize[d];
+      blockRows    *= m_Nearest ? 1 : m_ShrinkFactors[d];
+      }
+    // the bytes read for an output row, at least 256K bytes per thread
+    const size_t rowBytes = m_Nearest ? m_OutputSize[0] : m_Size[0] * blockRows;
+    const size_t readBytes = std::max( rowBytes * m_NumberOfComponents * m_Entry->ComponentSize, size_t(1) );
+    ParallelFor( m_Size.empty() ? 0 : numberOfRows, std::max( size_t(1), size_t(262144) / readBytes ), *this );
+    }
+
+  void operator()( size_t rowBegin, size_t rowEnd ) const
+    {
+    const size_t dimension = m_Size.size();
+    const size_t components = m_NumberOfComponents;
+    const size_t pixelSize = components * m_Entry->ComponentSize;
+    const size_t inputRowLength = m_Size[0] * components;
+    const size_t outputRowLength = m_OutputSize[0] * components;
+
+    std::vector< size_t > index( dimension );
+    std::vector< size_t > blockSize( dimension );
+    std::vector< double > values;
+    std::vector< double > sums;
+    std::vector< double > output;
+    if( !m_Nearest )
+      {
+      values.resize( inputRowLength );
+      sums.resize( inputRowLength );
+      output.resize( outputRowLength );
+      }
+
+    for( size_t row = rowBegin; row < rowEnd; ++row )
+      {
+      // the first input row of the block of the output row
+      size_t r = row;
+      size_t numberOfBlockRows = 1;
+      for( size_t d = 1; d < dimension; ++d )
+        {
+        index[d]     = ( r % m_OutputSize[d] ) * m_ShrinkFactors[d];
+        blockSize[d] = std::min( size_t( m_ShrinkFactors[d] ), m_Size[d] - index[d] );
+        r           /= m_OutputSize[d];
+        numberOfBlockRows *= blockSize[d];
+        }
+      char * destination = m_Destination + row * outputRowLength * m_Entry->ComponentSize;
+
+      if( m_Nearest )
+        {
+        const char * source = m_Source + this->GetRowOffset( index, blockSize, 0 ) * pixelSize;
+        if( m_ShrinkFactors[0] == 1 )
+          {
+          memcpy( destination, source, m_Size[0] * pixelSize );
+          continue;
+          }
+        for( size_t x = 0; x < m_OutputSize[0]; ++x )
+          {
+          memcpy( destination + x * pixelSize, source + x * m_ShrinkFactors[0] * pixelSize, pixelSize );
+          }
+        continue;
+        }
+
+      std::fill( sums.begin(), sums.end(), 0.0 );
+      for( size_t blockRow = 0; blockRow < numberOfBlockRows; ++blockRow )
+        {
+        m_Entry->LoadComponents( m_Source, this->GetRowOffset( index, blockSize, blockRow ) * components,
+                                 inputRowLength, &values[0] );
+        for( size_t i = 0; i < inputRowLength; ++i )
+          {
+          sums[i] += values[i];
+          }
+        }
+
+      for( size_t x = 0; x < m_OutputSize[0]; ++x )
+        {
+        const size_t begin = x * m_ShrinkFactors[0];
+        const size_t end = std::min( begin + m_ShrinkFactors[0], size_t( m_Size[0] ) );
+        const double scale = 1.0 / double( ( end - begin ) * numberOfBlockRows );
+        for( size_t c = 0; c < components; ++c )
+          {
+          double sum = 0.0;
+          for( size_t i = begin; i < end; ++i )
+            {
+            sum += sums[i * components + c];
+            }
+          output[x * components + c] = sum * scale;
+          }
+        }
+      if( m_Entry->ComponentIsInteger )
+        {
+        for( size_t i = 0; i < outputRowLength; ++i )
+          {
+          output[i] = floor( output[i] + 0.5 );
+          }
+        }
+      m_Entry->StoreComponents( &output[0], outputRowLength, destination, 0 );
+      }
+    }
+
+private:
+
+  /** The pixel offset of row blockRow of a block in the input. */
+  size_t GetRowOffset( const std::vector< size_t > & index,
+                       const std::vector< size_t > & blockSize,
+                       size_t blockRow ) const
+    {
+    size_t offset = 0;
+    size_t stride = m_Size[0];
+    for( size_t d = 1; d < m_Size.size(); ++d )
+      {
+      offset   += ( blockRow % blockSize[d] + index[d] ) * stride;
+      blockRow /= blockSize[d];
+      stride   *= m_Size[d];
+      }
+    return offset;
+    }
+
+  const PixelIDDispatchEntry * m_Entry;
+  std::vector< unsigned int >  m_Size;
+  std::vector< unsigned int >  m_ShrinkFactors;
+  std::vector< unsigned int >  m_OutputSize;
+  size_t                       m_NumberOfComponents;
+  bool                         m_Nearest;
+  const char *                 m_Source;
+  char *                       m_Destination;
+};
+
+} // namespace simple
+} // namespace itk
+
+#endif // __sitkDownsample_h
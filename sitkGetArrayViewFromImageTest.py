@@ -120,6 +120,670 @@ class TestNumpySimpleITKMemoryviewInterface(unittest.TestCase):
         self.assertEqual(h, sitk.Hash(img2))
 
 
+    def test_fast_conversion(self):
+        """Test the low overhead conversion functions for small images."""
+
+        img = sitk.GaussianSource( sitk.sitkFloat32,  [32,48], sigma=[10]*2, mean = [16,24] )
+        h = sitk.Hash( img )
+
+        nda = sitk.GetArrayFromImageFast( img )
+        self.assertEqual( nda.dtype, np.float32 )
+        self.assertEqual( nda.shape, (48,32) )
+        self.assertTrue( np.array_equal( nda, sitk.GetArrayFromImage( img ) ) )
+
+        img2 = sitk.GetImageFromArrayFast( nda )
+        self.assertEqual( h, sitk.Hash( img2 ) )
+
+        # vector images and non-contiguous input
+        img = sitk.PhysicalPointSource(sitk.sitkVectorFloat64, [3,4,5])
+        nda = sitk.GetArrayFromImageFast( img )
+        self.assertEqual( nda.shape, (5,4,3,3) )
+        img2 = sitk.GetImageFromArrayFast( nda )
+        self.assertEqual( sitk.Hash( img ), sitk.Hash( img2 ) )
+
+        nda = np.arange( 64, dtype = np.int16 ).reshape( 8, 8 )[:, ::2]
+        img = sitk.GetImageFromArrayFast( nda )
+        self.assertEqual( img.GetSize(), (4, 8) )
+        self.assertEqual( img.GetPixel(1, 1), nda[1, 1] )
+
+        self.assertRaises( TypeError, sitk.GetImageFromArrayFast, [[1, 2], [3, 4]] )
+
+    def test_array_copy_alignment(self):
+        """Test that the copied NumPy array is created natively and aligned."""
+
+        img = sitk.PhysicalPointSource(sitk.sitkVectorFloat32, [7,5,3])
+        nda = sitk.GetArrayFromImage( img )
+
+        self.assertEqual( type(nda), np.ndarray )
+        self.assertEqual( nda.shape, (3,5,7,3) )
+        self.assertTrue( nda.flags.c_contiguous )
+        self.assertTrue( nda.flags.writeable )
+        self.assertEqual( nda.ctypes.data % 64, 0 )
+        self.assertEqual( nda[2,4,6].tolist(), [6,4,2] )
+
+    def test_array_tiles(self):
+        """Test the tiled conversion of an image to arrays and back."""
+
+        img = sitk.GaussianSource( sitk.sitkFloat32,  [37,29,11], sigma=[10]*3, mean = [18,14,5] )
+        h = sitk.Hash( img )
+
+        for prefetch in ( True, False ):
+          tiles = list( sitk.IterArrayTilesFromImage( img, [16,16,4], overlap = 2, prefetch = prefetch ) )
+          self.assertEqual( len(tiles), 3*2*3 )
+
+          index, nda = tiles[0]
+          self.assertEqual( index, (0,0,0) )
+          self.assertEqual( nda.shape, (6,18,18) )
+          index, nda = tiles[1]
+          self.assertEqual( index, (14,0,0) )
+          self.assertEqual( nda.shape, (6,18,20) )
+          self.assertTrue( np.array_equal( nda, sitk.GetArrayFromImage( img )[0:6,0:18,14:34] ) )
+
+          img2 = sitk.GetImageFromArrayTiles( tiles, img.GetSize(), overlap = 2, tileSize = [16,16,4] )
+          self.assertEqual( h, sitk.Hash( img2 ) )
+
+        # each pixel is taken from the core of its tile, in any order
+        img = sitk.Image( [33,5], sitk.sitkUInt8 )
+        tiles = [ ( index, np.full( nda.shape, k, np.uint8 ) )
+                  for k, ( index, nda ) in enumerate( sitk.IterArrayTilesFromImage( img, [16,5], overlap = 2 ) ) ]
+        img2 = sitk.GetImageFromArrayTiles( tiles[::-1], img.GetSize(), overlap = 2, tileSize = [16,5] )
+        self.assertTrue( np.array_equal( sitk.GetArrayFromImage( img2 )[0], [0]*16 + [1]*16 + [2] ) )
+        self.assertRaises( ValueError, sitk.GetImageFromArrayTiles, tiles, img.GetSize(), overlap = 2 )
+        self.assertRaises( ValueError, sitk.GetImageFromArrayTiles, tiles, img.GetSize(), overlap = 4, tileSize = [4,5] )
+
+        # vector images
+        img = sitk.PhysicalPointSource(sitk.sitkVectorFloat64, [9,7])
+        tiles = sitk.IterArrayTilesFromImage( img, 4 )
+        img2 = sitk.GetImageFromArrayTiles( tiles, img.GetSize(), isVector = True )
+        self.assertEqual( sitk.Hash( img ), sitk.Hash( img2 ) )
+
+        self.assertRaises( IndexError, sitk._SimpleITK._GetArrayFromImageRegion, img, [8,0], [2,2] )
+
+    def test_lazy_image_operators(self):
+        """Test that lazy image operators compute the result of the filters."""
+
+        a = sitk.GaussianSource( sitk.sitkFloat32,  [31,17,5], sigma=[10]*3, mean = [15,8,2] )
+        b = sitk.PhysicalPointSource( sitk.sitkVectorFloat32, [31,17,5] )
+        b = sitk.VectorIndexSelectionCast( b, 0 )
+        c = sitk.Cast( a, sitk.sitkUInt8 )
+
+        expressions = [ lambda: ( a*0.3 + b*0.7 - 2 ) > 20,
+                        lambda: -a / ( b + 1 ),
+                        lambda: ( c * 3 ) // 2 + ( 255 - c ),
+                        lambda: ( c & 7 ) | ~c,
+                        lambda: abs( a - 100 ) ** 2 <= b ]
+        eager = [ sitk.Hash( e() ) for e in expressions ]
+
+        sitk.LazyImageOperatorsOn()
+        try:
+          self.assertTrue( sitk.GetLazyImageOperators() )
+          for e, h in zip( expressions, eager ):
+            img = e()
+            self.assertFalse( isinstance( img, sitk.Image ) )
+            self.assertIn( img, set( [ img ] ) )
+            self.assertEqual( h, sitk.Hash( img ) )
+            self.assertTrue( isinstance( img.Evaluate(), sitk.Image ) )
+
+          # evaluated on the first pixel access, after a is modified
+          img = a + 1
+          value = a[3,4,1] + 1
+          a[3,4,1] = 0
+          self.assertAlmostEqual( img[3,4,1], value, places = 4 )
+          self.assertEqual( img.GetSize(), a.GetSize() )
+
+          nda = sitk.GetArrayFromImage( ( c > 50 ) * 2 )
+          self.assertEqual( nda.dtype, np.uint8 )
+          self.assertEqual( nda.max(), 2 )
+        finally:
+          sitk.LazyImageOperatorsOff()
+
+    def test_inplace_image_operators(self):
+        """Test that in-place operators write into the pixel buffer."""
+
+        img = sitk.GaussianSource( sitk.sitkFloat32,  [40,30], sigma=[10]*2, mean = [20,15] )
+        expected = sitk.Hash( ( ( img * 0.5 ) + 3 ) ** 2 )
+
+        nda = sitk.GetArrayFromImage( img, arrayview = True )
+        original = img
+        img *= 0.5
+        img += 3
+        img **= 2
+        self.assertTrue( img is original )
+        self.assertEqual( expected, sitk.Hash( img ) )
+        self.assertAlmostEqual( float( nda[15,20] ), img[20,15], places = 4 )
+
+        # a copy which shares the buffer is not modified
+        img2 = sitk.Image( img )
+        img -= img2
+        self.assertEqual( img[20,15], 0 )
+        self.assertNotEqual( img2[20,15], 0 )
+
+        mask = sitk.Cast( img2 > 50, sitk.sitkUInt8 )
+        mask |= 4
+        mask ^= 1
+        self.assertEqual( mask.GetPixelIDValue(), sitk.sitkUInt8 )
+        self.assertEqual( mask[20,15], 4 )
+
+        # the result of a different pixel type is a new image
+        img = sitk.Image( [4,4], sitk.sitkInt16 ) + 3
+        original = img
+        img /= 2
+        self.assertFalse( img is original )
+        self.assertEqual( img.GetPixelIDValue(), sitk.sitkFloat64 )
+        self.assertEqual( img[1,1], 1.5 )
+
+    def test_numpy_ufunc(self):
+        """Test NumPy ufuncs and functions applied to images."""
+
+        img = sitk.GaussianSource( sitk.sitkFloat32,  [40,30], sigma=[10]*2, mean = [20,15] )
+        img.SetOrigin( [2.5, 3.5] )
+        img.SetSpacing( [0.5, 0.25] )
+        nda = sitk.GetArrayFromImage( img )
+
+        out = np.add( img, 5 )
+        self.assertTrue( isinstance( out, sitk.Image ) )
+        self.assertEqual( out.GetOrigin(), img.GetOrigin() )
+        self.assertEqual( out.GetSpacing(), img.GetSpacing() )
+        self.assertTrue( np.array_equal( sitk.GetArrayFromImage( out ), nda + 5 ) )
+
+        # in place, through the pixel buffer
+        view = sitk.GetArrayFromImage( img, arrayview = True )
+        self.assertTrue( np.add( img, 5, out = img ) is img )
+        self.assertTrue( np.array_equal( view, nda + 5 ) )
+
+        out = np.clip( img, 10, 100 )
+        self.assertTrue( isinstance( out, sitk.Image ) )
+        self.assertTrue( np.array_equal( sitk.GetArrayFromImage( out ), np.clip( nda + 5, 10, 100 ) ) )
+
+        out = np.greater( img, 100 )
+        self.assertEqual( out.GetPixelIDValue(), sitk.sitkUInt8 )
+        self.assertEqual( sitk.GetArrayFromImage( out ).sum(), ( nda + 5 > 100 ).sum() )
+
+        # reductions and other shapes are arrays
+        self.assertAlmostEqual( np.sum( img ), ( nda + 5 ).sum(), places = 0 )
+        self.assertEqual( np.max( img ), ( nda + 5 ).max() )
+        self.assertEqual( np.add.reduce( img, axis = 0 ).shape, (40,) )
+        self.assertTrue( type( np.add( img, np.ones( (2,30,40) ) ) ) is np.ndarray )
+
+        out = nda * img
+        self.assertTrue( isinstance( out, sitk.Image ) )
+        self.assertTrue( np.array_equal( np.asarray( out ), nda * ( nda + 5 ) ) )
+
+        # the inputs are read only, images sharing the buffer are not changed
+        copy = sitk.Image( img )
+        np.subtract( img, 1, out = img )
+        self.assertTrue( np.array_equal( sitk.GetArrayFromImage( copy ), nda + 5 ) )
+        self.assertTrue( np.array_equal( sitk.GetArrayFromImage( img ), nda + 4 ) )
+        np.copyto( img, 2 )
+        self.assertEqual( np.max( img ), 2 )
+
+    @unittest.skipIf( sys.platform.startswith( "win" ), "no POSIX shared memory" )
+    def test_shared_memory_image(self):
+        """Test sharing the pixels of an image by the name of a shared memory segment."""
+
+        import os
+        name = "sitk_test_{0}".format( os.getpid() )
+
+        img = sitk.Image( 40, 30, sitk.sitkFloat32 )
+        img.SetSpacing( [0.5, 2.0] )
+        img[3,4] = 7.0
+
+        shared = sitk.CreateSharedMemoryImage( name, img )
+        self.assertEqual( sitk.Hash( shared ), sitk.Hash( img ) )
+        self.assertEqual( shared.GetSpacing(), img.GetSpacing() )
+        self.assertRaises( RuntimeError, sitk.CreateSharedMemoryImage, name, img )
+
+        attached = sitk.AttachSharedMemoryImage( name )
+        self.assertEqual( sitk.Hash( attached ), sitk.Hash( img ) )
+        self.assertEqual( attached.GetSpacing(), img.GetSpacing() )
+
+        # writes through either image, or a view, are seen by the other
+        sitk.GetArrayFromImage( attached, arrayview = True )[1,2] = 5.0
+        self.assertEqual( shared[2,1], 5.0 )
+        shared[3,4] = 9.0
+        self.assertEqual( attached[3,4], 9.0 )
+
+        # a write to an image which is shared with another SimpleITK
+        # image copies the pixels out of the segment
+        copy = sitk.Image( shared )
+        shared[3,4] = 11.0
+        self.assertEqual( shared[3,4], 11.0 )
+        self.assertEqual( attached[3,4], 9.0 )
+        self.assertEqual( copy[3,4], 9.0 )
+        shared = copy
+        del copy
+
+        # views keep their values when the segment is removed with the last image
+        nda = sitk.GetArrayFromImage( attached, arrayview = True )
+        del shared
+        self.assertEqual( sitk.AttachSharedMemoryImage( name )[3,4], 9.0 )
+        del attached
+        self.assertRaises( RuntimeError, sitk.AttachSharedMemoryImage, name )
+        self.assertEqual( nda[4,3], 9.0 )
+
+        blank = sitk.CreateSharedMemoryImage( name, [5, 6, 7], sitk.sitkVectorUInt8 )
+        self.assertEqual( blank.GetSize(), (5, 6, 7) )
+        self.assertEqual( blank.GetNumberOfComponentsPerPixel(), 3 )
+        self.assertEqual( sitk.GetArrayFromImage( blank ).sum(), 0 )
+
+    def test_pickle(self):
+        """Test pickling images, with out-of-band pixel buffers."""
+
+        import pickle
+
+        img = sitk.Image( [12, 10, 4], sitk.sitkVectorFloat32, 2 )
+        img.SetSpacing( [0.5, 2.0, 1.5] )
+        img.SetOrigin( [1.0, 2.0, 3.0] )
+        img[3,4,1] = [1.0, 2.0]
+
+        for protocol in range( 2, pickle.HIGHEST_PROTOCOL + 1 ):
+          copy = pickle.loads( pickle.dumps( img, protocol ) )
+          self.assertEqual( sitk.Hash( copy ), sitk.Hash( img ) )
+          self.assertEqual( copy.GetSpacing(), img.GetSpacing() )
+          self.assertEqual( copy.GetOrigin(), img.GetOrigin() )
+          self.assertEqual( copy.GetNumberOfComponentsPerPixel(), 2 )
+
+        if pickle.HIGHEST_PROTOCOL < 5:
+          return
+
+        buffers = []
+        data = pickle.dumps( img, 5, buffer_callback = buffers.append )
+        self.assertEqual( len( buffers ), 1 )
+        self.assertTrue( len( data ) < 1024 )
+
+        # the pickled pixels are not changed by a later modification of the image
+        img[3,4,1] = [5.0, 6.0]
+        self.assertEqual( pickle.loads( data, buffers = buffers )[3,4,1], (1.0, 2.0) )
+
+        # a writable buffer is used by the unpickled image without a copy
+        received = bytearray( buffers[0].raw() )
+        del buffers
+        copy = pickle.loads( data, buffers = [ received ] )
+        copy[3,4,1] = [7.0, 8.0]
+        nda = np.frombuffer( received, dtype = np.float32 ).reshape( 4, 10, 12, 2 )
+        self.assertEqual( tuple( nda[1,4,3] ), (7.0, 8.0) )
+        del copy
+
+    def test_run_length_label_image(self):
+        """Test run length encoded label images."""
+
+        nda = np.zeros( (6,40,50), dtype = np.uint16 )
+        nda[1:4,10:30,5:45] = 3
+        nda[2,15:20,20:25] = 8
+        nda[5,39,49] = 1
+
+        img = sitk.GetImageFromArray( nda )
+        img.SetSpacing( [0.5, 1.0, 2.0] )
+
+        rle = sitk.GetRunLengthLabelImageFromImage( img )
+        self.assertEqual( rle.GetSize(), img.GetSize() )
+        self.assertEqual( rle.GetSpacing(), img.GetSpacing() )
+        self.assertTrue( rle.GetMemorySize() < nda.nbytes / 10 )
+
+        self.assertTrue( np.array_equal( rle.GetArray(), nda ) )
+        self.assertEqual( sitk.Hash( rle.GetImage() ), sitk.Hash( img ) )
+        self.assertEqual( rle.GetImage().GetSpacing(), img.GetSpacing() )
+        for k in range( nda.shape[0] ):
+          self.assertTrue( np.array_equal( rle.GetSliceArray( k ), nda[k] ) )
+        self.assertRaises( IndexError, rle.GetSliceArray, 6 )
+
+        indices, labels = rle.GetCOO()
+        nonzero = np.nonzero( nda )
+        self.assertTrue( np.array_equal( indices, np.stack( nonzero, axis = 1 ) ) )
+        self.assertTrue( np.array_equal( labels, nda[nonzero] ) )
+
+        # label maps are encoded as their label images
+        labelMap = sitk.Cast( img, sitk.sitkLabelUInt16 )
+        self.assertTrue( np.array_equal( sitk.GetRunLengthLabelImageFromImage( labelMap ).GetArray(), nda ) )
+
+        rle = sitk.GetRunLengthLabelImageFromArray( nda > 2 )
+        self.assertTrue( np.array_equal( rle.GetArray(), nda > 2 ) )
+        self.assertEqual( rle.GetImage().GetPixelID(), sitk.sitkUInt8 )
+
+        # the labels of a non native byte order
+        swapped = ( nda.astype( np.uint32 ) * 70000 ).astype( np.dtype( np.uint32 ).newbyteorder( 'S' ) )
+        self.assertTrue( np.array_equal( sitk.GetRunLengthLabelImageFromArray( swapped ).GetArray(), swapped ) )
+
+        self.assertRaises( TypeError, sitk.GetRunLengthLabelImageFromArray, nda.astype( np.float32 ) )
+
+    def test_conversion_statistics(self):
+        """Test statistics computed during the conversion."""
+
+        nda = np.random.uniform( -10.0, 90.0, (8,30,40) ).astype( np.float32 )
+        nda[3,4,5] = np.nan
+        valid = nda[~np.isnan( nda )].astype( np.float64 )
+
+        def check( stats ):
+          self.assertEqual( stats["Count"], valid.size )
+          self.assertEqual( stats["Minimum"], valid.min() )
+          self.assertEqual( stats["Maximum"], valid.max() )
+          self.assertAlmostEqual( stats["Mean"], valid.mean(), places = 6 )
+          self.assertAlmostEqual( stats["Sigma"], valid.std( ddof = 1 ), places = 6 )
+          self.assertAlmostEqual( stats["Sum"] / valid.sum(), 1.0, places = 9 )
+
+        img, stats = sitk.GetImageFromArray( nda, statistics = True )
+        check( stats )
+        self.assertTrue( np.array_equal( sitk.GetArrayFromImage( img ), nda, equal_nan = True ) )
+
+        arr, stats = sitk.GetArrayFromImage( img, statistics = True, histogramBins = 10, histogramRange = (0, 50) )
+        check( stats )
+        self.assertTrue( np.array_equal( arr, nda, equal_nan = True ) )
+        self.assertTrue( np.array_equal( stats["Histogram"], np.histogram( valid, 10, (0, 50) )[0] ) )
+        # an empty range is widened around the value, as by numpy
+        arr, stats = sitk.GetArrayFromImage( img, statistics = True, histogramBins = 5, histogramRange = (3, 3) )
+        self.assertTrue( np.array_equal( stats["Histogram"], np.histogram( valid, 5, (3, 3) )[0] ) )
+
+        view, stats = sitk.GetArrayFromImage( img, arrayview = True, statistics = True )
+        check( stats )
+        del view
+
+        self.assertRaises( ValueError, sitk.GetArrayFromImage, img, statistics = True, histogramBins = 10 )
+
+        img = sitk.Image( [10, 10], sitk.sitkVectorUInt8, 3 )
+        img[2,3] = [1, 2, 3]
+        stats = sitk.GetArrayFromImage( img, statistics = True )[1]
+        self.assertEqual( stats["Count"], 300 )
+        self.assertEqual( stats["Maximum"], 3 )
+        self.assertEqual( stats["Sum"], 6 )
+
+    def test_axis_order(self):
+        """Test conversions with the axes in other orders."""
+
+        nda = np.random.randint( 0, 1000, (7,50,60) ).astype( np.int16 )
+        img = sitk.GetImageFromArray( nda )
+
+        arr = sitk.GetArrayFromImage( img, axisOrder = 'xyz' )
+        self.assertTrue( np.array_equal( arr, nda.transpose() ) )
+        self.assertTrue( arr.flags.c_contiguous )
+        self.assertTrue( np.array_equal( sitk.GetArrayFromImage( img, axisOrder = (1,0,2) ),
+                                         nda.transpose( (1,2,0) ) ) )
+        self.assertTrue( np.array_equal( sitk.GetArrayFromImage( img, axisOrder = 'zyx' ), nda ) )
+
+        self.assertEqual( sitk.Hash( sitk.GetImageFromArray( arr, axisOrder = 'xyz' ) ), sitk.Hash( img ) )
+        # the values of a non native byte order, not its bytes
+        swapped = arr.astype( arr.dtype.newbyteorder( 'S' ) )
+        self.assertEqual( sitk.Hash( sitk.GetImageFromArray( swapped, axisOrder = 'xyz' ) ), sitk.Hash( img ) )
+
+        arr, stats = sitk.GetArrayFromImage( img, axisOrder = 'yzx', statistics = True )
+        self.assertTrue( np.array_equal( arr, nda.transpose( (1,0,2) ) ) )
+        self.assertEqual( stats["Maximum"], nda.max() )
+
+        # the components of a vector image
+        vnda = np.random.uniform( size = (40,30,3) ).astype( np.float32 )
+        vimg = sitk.GetImageFromArray( vnda, isVector = True )
+        planar = sitk.GetArrayFromImage( vimg, axisOrder = 'cyx' )
+        self.assertTrue( np.array_equal( planar, vnda.transpose( (2,0,1) ) ) )
+        vimg2 = sitk.GetImageFromArray( planar, axisOrder = 'cyx' )
+        self.assertEqual( vimg2.GetNumberOfComponentsPerPixel(), 3 )
+        self.assertEqual( sitk.Hash( vimg2 ), sitk.Hash( vimg ) )
+
+        self.assertRaises( ValueError, sitk.GetArrayFromImage, img, axisOrder = 'xyy' )
+        self.assertRaises( ValueError, sitk.GetArrayFromImage, img, axisOrder = 'xy' )
+        self.assertRaises( ValueError, sitk.GetArrayFromImage, img, axisOrder = (0,1,3) )
+        self.assertRaises( ValueError, sitk.GetArrayFromImage, img, arrayview = True, axisOrder = 'xyz' )
+
+    def test_planar(self):
+        """Test planar conversions of vector images."""
+
+        for components in ( 2, 3, 4, 5 ):
+          nda = np.random.randint( 0, 255, (6,20,30,components) ).astype( np.uint8 )
+          img = sitk.GetImageFromArray( nda, isVector = True )
+
+          planar = sitk.GetArrayFromImage( img, planar = True )
+          self.assertEqual( planar.shape, (components,6,20,30) )
+          self.assertTrue( np.array_equal( planar, np.moveaxis( nda, -1, 0 ) ) )
+
+          img2 = sitk.GetImageFromArray( planar, planar = True )
+          self.assertEqual( img2.GetNumberOfComponentsPerPixel(), components )
+          self.assertEqual( sitk.Hash( img2 ), sitk.Hash( img ) )
+
+        # scalar images have no components axis
+        img = sitk.Image( [10, 20], sitk.sitkFloat32 )
+        self.assertEqual( sitk.GetArrayFromImage( img, planar = True ).shape, (20,10) )
+
+        self.assertRaises( ValueError, sitk.GetImageFromArray, planar, planar = True, axisOrder = 'czyx' )
+
+    def test_conversion_cache(self):
+        """Test the conversion cache of unchanged images."""
+
+        sitk.ClearConversionCache()
+        start = sitk.GetConversionCacheStatistics()
+
+        img = sitk.Image( [40, 30, 20], sitk.sitkInt16 )
+        img[1,2,3] = 7
+
+        arr = sitk.GetArrayFromImage( img, cached = True )
+        self.assertFalse( arr.flags.writeable )
+        self.assertEqual( arr[3,2,1], 7 )
+        self.assertTrue( sitk.GetArrayFromImage( img, cached = True ) is arr )
+
+        stats = sitk.GetConversionCacheStatistics()
+        self.assertEqual( stats["Hits"] - start["Hits"], 1 )
+        self.assertEqual( stats["Misses"] - start["Misses"], 1 )
+        self.assertEqual( stats["NumberOfEntries"], 1 )
+        self.assertEqual( stats["Size"], arr.nbytes )
+
+        # a modified image is copied again
+        img[1,2,3] = 8
+        arr2 = sitk.GetArrayFromImage( img, cached = True )
+        self.assertFalse( arr2 is arr )
+        self.assertEqual( arr2[3,2,1], 8 )
+        self.assertEqual( arr[3,2,1], 7 )
+
+        # least recently used arrays beyond the budget are evicted
+        sitk.SetConversionCacheBudget( arr.nbytes )
+        img3 = sitk.Image( [40, 30, 20], sitk.sitkInt16 )
+        sitk.GetArrayFromImage( img3, cached = True )
+        stats = sitk.GetConversionCacheStatistics()
+        self.assertEqual( stats["NumberOfEntries"], 1 )
+        self.assertTrue( stats["Evictions"] > start["Evictions"] )
+        self.assertFalse( sitk.GetArrayFromImage( img, cached = True ) is arr2 )
+
+        self.assertRaises( ValueError, sitk.GetArrayFromImage, img, arrayview = True, cached = True )
+
+        # a write through an array view is a miss
+        arr = sitk.GetArrayFromImage( img, cached = True )
+        view = sitk.GetArrayFromImage( img, arrayview = True )
+        view[3,2,1] = 9
+        del view
+        self.assertEqual( sitk.GetArrayFromImage( img, cached = True )[3,2,1], 9 )
+
+        # an image which does not own its pixels is not cached
+        sitk.ClearConversionCache()
+        nda = np.zeros( (20,30,40), dtype = np.int16 )
+        imported = sitk.GetImageFromArray( nda, imageview = True )
+        arr = sitk.GetArrayFromImage( imported, cached = True )
+        self.assertEqual( sitk.GetConversionCacheStatistics()["NumberOfEntries"], 0 )
+        nda[3,2,1] = 5
+        self.assertEqual( sitk.GetArrayFromImage( imported, cached = True )[3,2,1], 5 )
+
+        sitk.SetConversionCacheBudget( start["Budget"] )
+        sitk.ClearConversionCache()
+        self.assertEqual( sitk.GetConversionCacheStatistics()["NumberOfEntries"], 0 )
+
+    def test_synced_array(self):
+        """Test the incremental sync of an array copy into its image."""
+
+        img = sitk.Image( [64, 48, 40], sitk.sitkUInt8 )
+        synced = sitk.GetSyncedArrayFromImage( img, blockSize = 16 )
+        arr = synced.GetArray()
+        self.assertEqual( synced.GetNumberOfDirtyBlocks(), 0 )
+
+        # a brush stroke inside of a single block
+        arr[20, 3:6, 33:40] = 5
+        self.assertEqual( synced.GetNumberOfDirtyBlocks(), 1 )
+        self.assertEqual( synced.Sync(), 1 )
+        self.assertTrue( synced.GetImage() is img )
+        self.assertTrue( np.array_equal( sitk.GetArrayFromImage( img ), arr ) )
+        self.assertEqual( synced.GetNumberOfDirtyBlocks(), 0 )
+
+        # views, masks and in place operators
+        arr[30:35][:, 40, ::-1][1, 2] = 7
+        arr[arr == 5] = 6
+        np.add( arr[0:2], 1, out = arr[0:2] )
+        self.assertTrue( synced.GetNumberOfDirtyBlocks() < 4 * 3 * 3 )
+        synced.Sync()
+        self.assertTrue( np.array_equal( sitk.GetArrayFromImage( img ), arr ) )
+
+        arr += 1
+        self.assertEqual( synced.GetNumberOfDirtyBlocks(), 4 * 3 * 3 )
+        synced.Sync()
+        self.assertTrue( np.array_equal( sitk.GetArrayFromImage( img ), arr ) )
+
+        # vector images
+        img = sitk.Image( [30, 20], sitk.sitkVectorFloat32, 3 )
+        synced = sitk.GetSyncedArrayFromImage( img, blockSize = 8 )
+        synced.GetArray()[19, 29] = [1, 2, 3]
+        self.assertEqual( synced.Sync(), 1 )
+        self.assertEqual( img[29, 19], (1, 2, 3) )
+
+    def test_raw_file(self):
+        """Test reading images from raw files."""
+        import os
+        import tempfile
+
+        nda = np.random.randint( -1000, 1000, (20,30,40) ).astype( np.int16 )
+        fd, path = tempfile.mkstemp( suffix = ".raw" )
+        try:
+          with os.fdopen( fd, "wb" ) as f:
+            f.write( b"HEADER" )
+            f.write( nda.astype( "<i2" ).tobytes() )
+            f.write( nda.astype( ">i2" ).tobytes() )
+
+          size = [40, 30, 20]
+          img = sitk.ImageFromRawFile( path, size, sitk.sitkInt16, offset = 6,
+                                       byteOrder = sitk.RawFileLittleEndian )
+          self.assertEqual( img.GetSize(), tuple( size ) )
+          self.assertTrue( np.array_equal( sitk.GetArrayFromImage( img ), nda ) )
+
+          img = sitk.ImageFromRawFile( path, size, sitk.sitkInt16, offset = 6 + nda.nbytes,
+                                       byteOrder = sitk.RawFileBigEndian )
+          self.assertTrue( np.array_equal( sitk.GetArrayFromImage( img ), nda ) )
+
+          # the components are converted as they are read
+          img = sitk.ImageFromRawFile( path, size, sitk.sitkFloat32, offset = 6 + nda.nbytes,
+                                       byteOrder = sitk.RawFileBigEndian, filePixelID = sitk.sitkInt16 )
+          self.assertEqual( img.GetPixelID(), sitk.sitkFloat32 )
+          self.assertTrue( np.array_equal( sitk.GetArrayFromImage( img ), nda.astype( np.float32 ) ) )
+
+          # vector images have interleaved components
+          img = sitk.ImageFromRawFile( path, [40, 30, 10], sitk.sitkVectorInt16, 2, offset = 6,
+                                       byteOrder = sitk.RawFileLittleEndian )
+          self.assertTrue( np.array_equal( sitk.GetArrayFromImage( img ), nda.reshape( (10,30,40,2) ) ) )
+
+          img = sitk.ImageFromRawFile( path, size, sitk.sitkInt16, offset = 6, memoryMapped = True )
+          self.assertTrue( np.array_equal( sitk.GetArrayFromImage( img ), nda ) )
+          img[0,0,0] = 7
+          img = None
+
+          self.assertRaises( RuntimeError, sitk.ImageFromRawFile, path, [40, 30, 60], sitk.sitkInt16 )
+          self.assertRaises( RuntimeError, sitk.ImageFromRawFile, path, size, sitk.sitkInt16,
+                             offset = 6, filePixelID = sitk.sitkUInt16, memoryMapped = True )
+          img = sitk.ImageFromRawFile( path, size, sitk.sitkInt16, offset = 6 )
+          self.assertTrue( np.array_equal( sitk.GetArrayFromImage( img ), nda ) )
+        finally:
+          os.remove( path )
+
+    def test_region_conversion(self):
+        """Test the copy of regions between arrays and images."""
+
+        nda = np.random.randint( 0, 255, (20,30,40) ).astype( np.uint8 )
+        img = sitk.GetImageFromArray( nda )
+        copy = sitk.Image( img )
+
+        arr = sitk.GetArrayFromImage( img, index = [5, 10, 2], size = [30, 15, 10] )
+        self.assertEqual( arr.shape, (10, 15, 30) )
+        self.assertTrue( np.array_equal( arr, nda[2:12, 10:25, 5:35] ) )
+
+        sitk.PasteArrayIntoImage( img, np.full( (3, 4, 5), 7, np.uint8 ), [1, 2, 3] )
+        nda[3:6, 2:6, 1:6] = 7
+        self.assertTrue( np.array_equal( sitk.GetArrayFromImage( img ), nda ) )
+        self.assertFalse( np.array_equal( sitk.GetArrayFromImage( copy ), nda ) )
+
+        # a strided array is pasted as its values
+        sitk.PasteArrayIntoImage( img, nda[::-1, ::2, :], [0, 0, 0] )
+        nda[:, :15, :] = nda[::-1, ::2, :].copy()
+        self.assertTrue( np.array_equal( sitk.GetArrayFromImage( img ), nda ) )
+
+        img = sitk.Image( [6, 5], sitk.sitkVectorFloat32, 2 )
+        sitk.PasteArrayIntoImage( img, np.ones( (2, 3, 2), np.float32 ), [3, 1] )
+        self.assertEqual( img[4, 2], (1, 1) )
+        arr = sitk.GetArrayFromImage( img, index = [3, 1], size = [3, 2] )
+        self.assertTrue( np.array_equal( arr, np.ones( (2, 3, 2) ) ) )
+
+        self.assertRaises( ValueError, sitk.GetArrayFromImage, img, index = [0, 0] )
+        self.assertRaises( ValueError, sitk.GetArrayFromImage, img, index = [0, 0], size = [1, 1], arrayview = True )
+        self.assertRaises( IndexError, sitk.GetArrayFromImage, img, index = [4, 0], size = [3, 1] )
+        self.assertRaises( IndexError, sitk.PasteArrayIntoImage, img, np.ones( (2, 4, 2), np.float32 ), [3, 1] )
+        self.assertRaises( ValueError, sitk.PasteArrayIntoImage, img, np.ones( (2, 3, 3), np.float32 ), [3, 1] )
+        self.assertRaises( TypeError, sitk.PasteArrayIntoImage, img, np.ones( (2, 3, 2) ), [3, 1] )
+
+    def test_downsampled_array(self):
+        """Test the export of downsampled arrays and pyramids."""
+
+        nda = np.random.randint( 0, 1000, (21,30,41) ).astype( np.uint16 )
+        img = sitk.GetImageFromArray( nda )
+
+        arr = sitk.GetDownsampledArrayFromImage( img, 4 )
+        self.assertTrue( np.array_equal( arr, nda[::4, ::4, ::4] ) )
+        arr = sitk.GetDownsampledArrayFromImage( img, [1, 2, 3] )
+        self.assertTrue( np.array_equal( arr, nda[::3, ::2, :] ) )
+
+        arr = sitk.GetDownsampledArrayFromImage( img, 2, reduction = 'mean' )
+        self.assertEqual( arr.shape, (11, 15, 21) )
+        self.assertEqual( arr.dtype, np.uint16 )
+        self.assertEqual( arr[3, 4, 5], np.floor( nda[6:8, 8:10, 10:12].mean() + 0.5 ) )
+        self.assertEqual( arr[10, 14, 20], np.floor( nda[20, 28:30, 40].mean() + 0.5 ) )
+
+        levels = sitk.GetArrayPyramidFromImage( img, 3, reduction = 'nearest' )
+        self.assertEqual( len( levels ), 3 )
+        self.assertTrue( np.array_equal( levels[2], nda[::8, ::8, ::8] ) )
+        levels = sitk.GetArrayPyramidFromImage( img, 2 )
+        self.assertEqual( levels[1].shape, (6, 8, 11) )
+
+        img = sitk.Image( [10, 6], sitk.sitkVectorFloat32, 2 )
+        img[3, 1] = (4, 8)
+        arr = sitk.GetDownsampledArrayFromImage( img, [2, 2], reduction = 'mean' )
+        self.assertEqual( arr.shape, (3, 5, 2) )
+        self.assertTrue( np.array_equal( arr[0, 1], [1, 2] ) )
+
+        # the mean of large unsigned 64 bit labels does not saturate at 2^63-1
+        large = np.full( (4, 6), 2**63 + 4096, dtype = np.uint64 )
+        arr = sitk.GetDownsampledArrayFromImage( sitk.GetImageFromArray( large ), 2, reduction = 'mean' )
+        self.assertEqual( arr.dtype, np.uint64 )
+        self.assertTrue( np.array_equal( arr, large[::2, ::2] ) )
+
+        self.assertRaises( ValueError, sitk.GetDownsampledArrayFromImage, img, 0 )
+        self.assertRaises( ValueError, sitk.GetDownsampledArrayFromImage, img, 2, reduction = 'max' )
+
+    def test_concurrent_conversions(self):
+        """Test conversions of a shared image by several threads."""
+        import threading
+
+        nda = np.random.randint( 0, 255, (20,30,40) ).astype( np.uint8 )
+        img = sitk.GetImageFromArray( nda )
+        errors = []
+
+        def worker():
+          try:
+            for i in range( 20 ):
+              view = sitk.GetArrayFromImage( img, arrayview = True )
+              self.assertTrue( np.array_equal( view, nda ) )
+              self.assertTrue( np.array_equal( sitk.GetArrayFromImage( img, cached = True ), nda ) )
+              self.assertTrue( np.array_equal( sitk.GetArrayFromImage( img, index = [i, 0, 0], size = [1, 30, 20] ),
+                                               nda[:, :, i:i+1] ) )
+          except Exception as e:
+            errors.append( e )
+
+        threads = [ threading.Thread( target = worker ) for i in range( 8 ) ]
+        for t in threads:
+          t.start()
+        for t in threads:
+          t.join()
+        self.assertEqual( errors, [] )
+        self.assertEqual( len( img._ExportedNumPyArrayViewsList ), 8 * 20 )
+        sitk.ClearConversionCache()
+
     def test_legacy(self):
       """Test SimpleITK Image to numpy memoryview."""
 
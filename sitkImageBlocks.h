@@ -0,0 +1,246 @@
+/*=========================================================================
+*
+*  Copyright Insight Software Consortium
+*
+*  Licensed under the Apache License, Version 2.0 (the "License");
+*  you may not use this file except in compliance with the License.
+*  You may obtain a copy of the License at
+*
+*         http://www.apache.org/licenses/LICENSE-2.0.txt
+*
+*  Unless required by applicable law or agreed to in writing, software
+*  distributed under the License is distributed on an "AS IS" BASIS,
+*  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+*  See the License for the specific language governing permissions and
+*  limitations under the License.
+*
+*=========================================================================*/
+#ifndef __sitkImageBlocks_h
+#define __sitkImageBlocks_h
+
+#include <string.h>
+
+#include <algorithm>
+#include <vector>
+
+#include "sitkParallelFor.h"
+
+namespace itk
+{
+namespace simple
+{
+
+/** \class CopyImageBlocks
+ *  \brief Copies blocks of a regular grid over an image between two
+ *  buffers of the image, e.g. the modified blocks of an array copy
+ *  back into the image.
+ *
+ * The blocks are given by their index in the grid, with x the fastest.
+ * The blocks at the end of an axis are clipped to the image. Each row
+ * of a block is a single memcpy, and the blocks are distributed over
+ * the ITK threads.
+ */
+class CopyImageBlocks
+{
+public:
+  CopyImageBlocks( const std::vector< unsigned int > & imageSize,
+                   const std::vector< unsigned int > & blockSize,
+                   size_t pixelSize )
+    : m_ImageSize( imageSize ), m_BlockSize( blockSize ), m_PixelSize( pixelSize ),
+      m_Blocks( NULL ), m_Source( NULL ), m_Destination( NULL )
+    {
+    for( size_t d = 0; d < imageSize.size(); ++d )
+      {
+      m_GridSize.push_back( ( imageSize[d] + blockSize[d] - 1 ) / blockSize[d] );
+      }
+    }
+
+  /** The number of blocks of the grid. */
+  size_t GetNumberOfBlocks( void ) const
+    {
+    size_t n = 1;
+    for( size_t d = 0; d < m_GridSize.size(); ++d )
+      {
+      n *= m_GridSize[d];
+      }
+    return n;
+    }
+
+  void Copy( const char * source, char * destination,
+             const size_t * blocks, size_t numberOfBlocks )
+    {
+    m_Source      = source;
+    m_Destination = destination;
+    m_Blocks      = blocks;
+
+    size_t blockBytes = m_PixelSize;
+    for( size_t d = 0; d < m_BlockSize.size(); ++d )
+      {
+      blockBytes *= m_BlockSize[d];
+      }
+    // at least 256K bytes per thread
+    const size_t grainSize = std::max( size_t(1), size_t(262144) / std::max( blockBytes, size_t(1) ) );
+    ParallelFor( numberOfBlocks, grainSize, *this );
+    }
+
+  void operator()( size_t begin, size_t end ) const
+    {
+    const size_t dimension = m_ImageSize.size();
+    std::vector< size_t > index( dimension );
+    std::vector< size_t > size( dimension );
+
+    for( size_t b = begin; b < end; ++b )
+      {
+      size_t block = m_Blocks[b];
+      size_t numberOfRows = 1;
+      for( size_t d = 0; d < dimension; ++d )
+        {
+        index[d] = ( block % m_GridSize[d] ) * m_BlockSize[d];
+        size[d]  = std::min( size_t( m_BlockSize[d] ), m_ImageSize[d] - index[d] );
+        block   /= m_GridSize[d];
+        if( d > 0 )
+          {
+          numberOfRows *= size[d];
+          }
+        }
+
+      const size_t rowBytes = size[0] * m_PixelSize;
+      for( size_t row = 0; row < numberOfRows; ++row )
+        {
+        // the offset of the first pixel of the row in the image
+        size_t r      = row;
+        size_t offset = index[0];
+        size_t stride = m_ImageSize[0];
+        for( size_t d = 1; d < dimension; ++d )
+          {
+          offset += ( r % size[d] + index[d] ) * stride;
+          r      /= size[d];
+          stride *= m_ImageSize[d];
+          }
+        memcpy( m_Destination + offset * m_PixelSize, m_Source + offset * m_PixelSize, rowBytes );
+        }
+      }
+    }
+
+private:
+  std::vector< unsigned int > m_ImageSize;
+  std::vector< unsigned int > m_BlockSize;
+  std::vector< size_t >       m_GridSize;
+  size_t                      m_PixelSize;
+  const size_t *              m_Blocks;
+  const char *                m_Source;
+  char *                      m_Destination;
+};
+
+
+/** Returns the number of rows of a region, where a row is the run of
+ * pixels along the fastest axis. */
+inline size_t GetNumberOfRegionRows( const std::vector< unsigned int > & regionSize )
+{
+  size_t rows = 1;
+  for( size_t d = 1; d < regionSize.size(); ++d )
+    {
+    rows *= regionSize[d];
+    }
+  return rows;
+}
+
+/** Copies the rows [rowBegin, rowEnd) of a region between the buffer of
+ * an image and a contiguous buffer of the region. Each row is a single
+ * memcpy, pixelSize includes all the components of a pixel. If
+ * pasteIntoImage is true the region buffer is written into the image,
+ * otherwise the region is extracted from the image.
+ */
+inline void CopyImageRegionRows( char * imageBuffer,
+                                 const std::vector< unsigned int > & imageSize,
+                                 const std::vector< unsigned int > & regionIndex,
+                                 const std::vector< unsigned int > & regionSize,
+                                 size_t pixelSize,
+                                 char * regionBuffer,
+                                 bool pasteIntoImage,
+                                 size_t rowBegin,
+                                 size_t rowEnd )
+{
+  const size_t rowBytes = regionSize[0] * pixelSize;
+  for( size_t row = rowBegin; row < rowEnd; ++row )
+    {
+    // offset of the first pixel of the row in the image
+    size_t r      = row;
+    size_t offset = regionIndex[0];
+    size_t stride = imageSize[0];
+    for( size_t d = 1; d < regionSize.size(); ++d )
+      {
+      offset += ( r % regionSize[d] + regionIndex[d] ) * stride;
+      r      /= regionSize[d];
+      stride *= imageSize[d];
+      }
+
+    char * image  = imageBuffer + offset * pixelSize;
+    char * region = regionBuffer + row * rowBytes;
+    if( pasteIntoImage )
+      {
+      memcpy( image, region, rowBytes );
+      }
+    else
+      {
+      memcpy( region, image, rowBytes );
+      }
+    }
+}
+
+/** The rows of CopyImageRegion, for ParallelFor. */
+class CopyImageRegionFunction
+{
+public:
+  CopyImageRegionFunction( char * imageBuffer,
+                           const std::vector< unsigned int > & imageSize,
+                           const std::vector< unsigned int > & regionIndex,
+                           const std::vector< unsigned int > & regionSize,
+                           size_t pixelSize,
+                           char * regionBuffer,
+                           bool pasteIntoImage )
+    : m_ImageBuffer( imageBuffer ), m_ImageSize( imageSize ), m_RegionIndex( regionIndex ),
+      m_RegionSize( regionSize ), m_PixelSize( pixelSize ), m_RegionBuffer( regionBuffer ),
+      m_PasteIntoImage( pasteIntoImage ) {}
+
+  void operator()( size_t rowBegin, size_t rowEnd ) const
+    {
+    CopyImageRegionRows( m_ImageBuffer, m_ImageSize, m_RegionIndex, m_RegionSize, m_PixelSize,
+                         m_RegionBuffer, m_PasteIntoImage, rowBegin, rowEnd );
+    }
+
+private:
+  char *                              m_ImageBuffer;
+  const std::vector< unsigned int > & m_ImageSize;
+  const std::vector< unsigned int > & m_RegionIndex;
+  const std::vector< unsigned int > & m_RegionSize;
+  size_t                              m_PixelSize;
+  char *                              m_RegionBuffer;
+  bool                                m_PasteIntoImage;
+};
+
+/** \brief Copies a region between the buffer of an image and a
+ * contiguous buffer of the region, see CopyImageRegionRows.
+ *
+ * Each row of the region is a single memcpy, the rows are distributed
+ * over the ITK threads when the region is large enough.
+ */
+inline void CopyImageRegion( char * imageBuffer,
+                             const std::vector< unsigned int > & imageSize,
+                             const std::vector< unsigned int > & regionIndex,
+                             const std::vector< unsigned int > & regionSize,
+                             size_t pixelSize,
+                             char * regionBuffer,
+                             bool pasteIntoImage )
+{
+  CopyImageRegionFunction function( imageBuffer, imageSize, regionIndex, regionSize,
+                                    pixelSize, regionBuffer, pasteIntoImage );
+  const size_t rowBytes = std::max( size_t( regionSize.empty() ? 0 : regionSize[0] ) * pixelSize, size_t(1) );
+  // at least 256K bytes per thread
+  ParallelFor( GetNumberOfRegionRows( regionSize ), std::max( size_t(1), size_t(262144) / rowBytes ), function );
+}
+
+} // namespace simple
+} // namespace itk
+
+#endif // __sitkImageBlocks_h
@@ -0,0 +1,330 @@
+/*=========================================================================
+*
+*  Copyright Insight Software Consortium
+*
+*  Licensed under the Apache License, Version 2.0 (the "License");
+*  you may not use this file except in compliance with the License.
+*  You may obtain a copy of the License at
+*
+*         http://www.apache.org/licenses/LICENSE-2.0.txt
+*
+*  Unless required by applicable law or agreed to in writing, software
+*  distributed under the License is distributed on an "AS IS" BASIS,
+*  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+*  See the License for the specific language governing permissions and
+*  limitations under the License.
+*
+*=========================================================================*/
+#ifndef __sitkImageExpression_h
+#define __sitkImageExpression_h
+
+#include <string.h>
+#include <math.h>
+
+#include <algorithm>
+#include <vector>
+
+#include "sitkPixelIDDispatchTable.h"
+#include "sitkParallelFor.h"
+
+namespace itk
+{
+namespace simple
+{
+
+/** \class ImageExpression
+ *  \brief A fused, element wise evaluation of an expression of images
+ *  and constants.
+ *
+ * The expression is a postfix program of instructions, each of which
+ * pushes an input or a constant, or replaces the top operands of the
+ * stack with the result of an operation. The program is executed on
+ * blocks of BlockSize pixel components, so the whole expression is
+ * computed in one pass over the inputs, without any image sized
+ * temporaries. Blocks are distributed over the ITK threads.
+ *
+ * The values are computed as doubles and rounded to the pixel type of
+ * each instruction, so the result is the same as the one of the chain
+ * of SimpleITK filters the operations are named after.
+ */
+class ImageExpression
+{
+public:
+  enum OpcodeType
+  {
+    OpImage,
+    OpConstant,
+    OpAdd,
+    OpSubtract,
+    OpMultiply,
+    OpDivide,
+    OpDivideFloor,
+    OpDivideReal,
+    OpPow,
+    OpLess,
+    OpLessEqual,
+    OpEqual,
+    OpNotEqual,
+    OpGreater,
+    OpGreaterEqual,
+    OpAnd,
+    OpOr,
+    OpXor,
+    OpUnaryMinus,
+    OpAbs,
+    OpBitwiseNot,
+    NumberOfOpcodes
+  };
+
+  struct Instruction
+  {
+    OpcodeType                   Opcode;
+
+    /** The kernels of the pixel type of the result, or of the input. */
+    const PixelIDDispatchEntry * Entry;
+
+    /** The index of the input of an OpImage instruction. */
+    unsigned int                 Input;
+
+    /** The value of an OpConstant instruction. */
+    double                       Constant;
+  };
+
+  /** The number of components processed by each instruction at once. */
+  enum { BlockSize = 256 };
+
+  ImageExpression( void ) : m_Depth( 0 ), m_MaximumDepth( 0 ) {}
+
+  /** Returns the opcode with the name of the SimpleITK filter it
+   * implements, e.g. "Add", or "Image" and "Constant". */
+  static bool GetOpcode( const char * name, OpcodeType & opcode )
+    {
+    static const char * const names[NumberOfOpcodes] =
+      {
+      "Image", "Constant", "Add", "Subtract", "Multiply", "Divide",
+      "DivideFloor", "DivideReal", "Pow", "Less", "LessEqual", "Equal",
+      "NotEqual", "Greater", "GreaterEqual", "And", "Or", "Xor",
+      "UnaryMinus", "Abs", "BitwiseNot"
+      };
+    for( int i = 0; i < NumberOfOpcodes; ++i )
+      {
+      if( strcmp( name, names[i] ) == 0 )
+        {
+        opcode = static_cast< OpcodeType >( i );
+        return true;
+        }
+      }
+    return false;
+    }
+
+  static unsigned int GetNumberOfOperands( OpcodeType opcode )
+    {
+    if( opcode == OpImage || opcode == OpConstant )
+      {
+      return 0;
+      }
+    if( opcode == OpUnaryMinus || opcode == OpAbs || opcode == OpBitwiseNot )
+      {
+      return 1;
+      }
+    return 2;
+    }
+
+  /** Appends an instruction to the program. Returns false if there are
+   * not enough operands on the stack. */
+  bool AddInstruction( const Instruction & instruction )
+    {
+    const unsigned int operands = GetNumberOfOperands( instruction.Opcode );
+    if( m_Depth < operands || !instruction.Entry )
+      {
+      return false;
+      }
+    m_Depth = m_Depth - operands + 1;
+    m_MaximumDepth = std::max( m_MaximumDepth, m_Depth );
+
+    m_Program.push_back( instruction );
+    if( instruction.Opcode == OpConstant )
+      {
+      // constants have the pixel type of the other operand
+      instruction.Entry->RoundComponents( &m_Program.back().Constant, 1 );
+      }
+    return true;
+    }
+
+  /** Sets the buffer of an input of the OpImage instructions. */
+  void SetInput( unsigned int input, const void * buffer )
+    {
+    if( input >= m_Inputs.size() )
+      {
+      m_Inputs.resize( input + 1, NULL );
+      }
+    m_Inputs[input] = buffer;
+    }
+
+  /** A program is complete when it leaves exactly the result on the stack. */
+  bool IsComplete( void ) const
+    {
+    return m_Depth == 1 && m_Program.back().Opcode != OpConstant;
+    }
+
+  /** The kernels of the pixel type of the result. */
+  const PixelIDDispatchEntry * GetResultEntry( void ) const
+    {
+    return m_Program.back().Entry;
+    }
+
+  /** Computes numberOfComponents components of the result into the
+   * output buffer, which may be one of the inputs. */
+  void Evaluate( void * output, size_t numberOfComponents ) const
+    {
+    BlockFunction function( *this, output, numberOfComponents );
+    const size_t numberOfBlocks = ( numberOfComponents + BlockSize - 1 ) / BlockSize;
+    // at least 64K components per thread
+    ParallelFor( numberOfBlocks, 256, function );
+    }
+
+private:
+
+  struct BlockFunction
+  {
+    BlockFunction( const ImageExpression & expression, void * output, size_t numberOfComponents )
+      : m_Expression( expression ), m_Output( output ), m_NumberOfComponents( numberOfComponents ) {}
+
+    void operator()( size_t beginBlock, size_t endBlock ) const
+      {
+      std::vector< double > stack( m_Expression.m_MaximumDepth * BlockSize );
+      for( size_t block = beginBlock; block < endBlock; ++block )
+        {
+        const size_t offset = block * BlockSize;
+        const size_t n = std::min( size_t( BlockSize ), m_NumberOfComponents - offset );
+        m_Expression.EvaluateBlock( offset, n, &stack[0], m_Output );
+        }
+      }
+
+    const ImageExpression & m_Expression;
+    void *                  m_Output;
+    size_t                  m_NumberOfComponents;
+  };
+
+  void EvaluateBlock( size_t offset, size_t n, double * stack, void * output ) const
+    {
+    // the number of blocks on the stack, AddInstruction ensures that
+    // an operator has its operands on the stack
+    size_t depth = 0;
+    for( size_t p = 0; p < m_Program.size(); ++p )
+      {
+      const Instruction & instruction = m_Program[p];
+      const PixelIDDispatchEntry & entry = *instruction.Entry;
+
+      if( instruction.Opcode == OpImage )
+        {
+        entry.LoadComponents( m_Inputs[instruction.Input], offset, n, stack + depth * BlockSize );
+        ++depth;
+        continue;
+        }
+      if( instruction.Opcode == OpConstant )
+        {
+        std::fill( stack + depth * BlockSize, stack + depth * BlockSize + n, instruction.Constant );
+        ++depth;
+        continue;
+        }
+
+      // b is the top of the stack, a the operand below it
+      const unsigned int operands = GetNumberOfOperands( instruction.Opcode );
+      double * b = stack + ( depth - 1 ) * BlockSize;
+      double * a = operands == 2 ? b - BlockSize : b;
+      size_t   i;
+
+      switch( instruction.Opcode )
+        {
+        case OpUnaryMinus:
+          for( i = 0; i < n; ++i ) b[i] = -b[i];
+          break;
+        case OpAbs:
+          for( i = 0; i < n; ++i ) b[i] = fabs( b[i] );
+          break;
+        case OpBitwiseNot:
+          for( i = 0; i < n; ++i ) b[i] = static_cast< double >( ~static_cast< long long >( b[i] ) );
+          break;
+        case OpAdd:
+          for( i = 0; i < n; ++i ) a[i] = a[i] + b[i];
+          break;
+        case OpSubtract:
+          for( i = 0; i < n; ++i ) a[i] = a[i] - b[i];
+          break;
+        case OpMultiply:
+          for( i = 0; i < n; ++i ) a[i] = a[i] * b[i];
+          break;
+        case OpDivide:
+          // as itk::Functor::Div, division by zero is the maximum
+          for( i = 0; i < n; ++i ) a[i] = b[i] != 0.0 ? a[i] / b[i] : entry.ComponentMaximum;
+          break;
+        case OpDivideFloor:
+          for( i = 0; i < n; ++i )
+            {
+            const double q = a[i] / b[i];
+            if( entry.ComponentIsInteger && b[i] == 0.0 && q == q )
+              {
+              a[i] = q > 0.0 ? entry.ComponentMaximum : entry.ComponentMinimum;
+              }
+            else
+              {
+              a[i] = floor( q );
+              }
+            }
+          break;
+        case OpDivideReal:
+          for( i = 0; i < n; ++i ) a[i] = a[i] / b[i];
+          break;
+        case OpPow:
+          for( i = 0; i < n; ++i ) a[i] = pow( a[i], b[i] );
+          break;
+        case OpLess:
+          for( i = 0; i < n; ++i ) a[i] = a[i] < b[i] ? 1.0 : 0.0;
+          break;
+        case OpLessEqual:
+          for( i = 0; i < n; ++i ) a[i] = a[i] <= b[i] ? 1.0 : 0.0;
+          break;
+        case OpEqual:
+          for( i = 0; i < n; ++i ) a[i] = a[i] == b[i] ? 1.0 : 0.0;
+          break;
+        case OpNotEqual:
+          for( i = 0; i < n; ++i ) a[i] = a[i] != b[i] ? 1.0 : 0.0;
+          break;
+        case OpGreater:
+          for( i = 0; i < n; ++i ) a[i] = a[i] > b[i] ? 1.0 : 0.0;
+          break;
+        case OpGreaterEqual:
+          for( i = 0; i < n; ++i ) a[i] = a[i] >= b[i] ? 1.0 : 0.0;
+          break;
+        case OpAnd:
+          for( i = 0; i < n; ++i ) a[i] = static_cast< double >( static_cast< long long >( a[i] ) & static_cast< long long >( b[i] ) );
+          break;
+        case OpOr:
+          for( i = 0; i < n; ++i ) a[i] = static_cast< double >( static_cast< long long >( a[i] ) | static_cast< long long >( b[i] ) );
+          break;
+        case OpXor:
+          for( i = 0; i < n; ++i ) a[i] = static_cast< double >( static_cast< long long >( a[i] ) ^ static_cast< long long >( b[i] ) );
+          break;
+        default:
+          break;
+        }
+
+      // the result replaces the operands
+      depth -= operands - 1;
+      entry.RoundComponents( a, n );
+      }
+
+    GetResultEntry()->StoreComponents( stack + ( depth - 1 ) * BlockSize, n, output, offset );
+    }
+
+  std::vector< Instruction >  m_Program;
+  std::vector< const void * > m_Inputs;
+  unsigned int                m_Depth;
+  unsigned int                m_MaximumDepth;
+};
+
+} // namespace simple
+} // namespace itk
+
+#endif // __sitkImageExpression_h
@@ -16,56 +16,461 @@
 *
 *=========================================================================*/
 #include <string.h>
+#include <math.h>
 
+#include <algorithm>
 #include <numeric>
 #include <functional>
+#include <limits>
 
 #include "sitkImage.h"
-#include "sitkConditional.h"
 #include "sitkExceptionObject.h"
-#include "itkImage.h"
-#include "itkVectorImage.h"
+#include "sitkPixelIDDispatchTable.h"
+#include "sitkConversionStatistics.h"
+#include "sitkPermuteAxes.h"
+#include "sitkImageBlocks.h"
+#include "sitkDownsample.h"
+#include "itkCommand.h"
 
 namespace sitk = itk::simple;
 
-template<typename TPixel, unsigned int VImageDimension = 2>
-const void
-sitkSetReferenceCountOfScalarImage(sitk::Image * sitkImage,
-                                   bool bIncreaseRefCnt = true)
+/** Looks up the conversion kernels of a pixel type and dimension. If
+ * the combination is not supported a python exception is set and
+ * NULL is returned.
+ */
+static const sitk::PixelIDDispatchEntry *
+sitk_GetPixelIDDispatchEntry( int pixelID, unsigned int dimension )
 {
-  typedef itk::Image<TPixel, VImageDimension>  ImageType;
-  typename ImageType::Pointer itkImage = (ImageType*)(sitkImage->GetITKBase());
-  if(bIncreaseRefCnt)
+  const sitk::PixelIDDispatchEntry *entry = sitk::PixelIDDispatchTable::GetEntry( pixelID, dimension );
+  if( entry )
+    {
+    return entry;
+    }
+
+  if( pixelID == sitk::sitkComplexFloat32 || pixelID == sitk::sitkComplexFloat64 )
     {
-    itkImage->GetPixelContainer()->Register();
+    PyErr_SetString( PyExc_RuntimeError, "Images of Complex Pixel types currently are not supported." );
+    }
+  else if( pixelID != sitk::sitkUnknown
+           && ( dimension < 2 || dimension > SITK_MAX_DIMENSION ) )
+    {
+    PyErr_SetString( PyExc_RuntimeError, "Unknown image dimension." );
     }
   else
     {
-    if(itkImage->GetPixelContainer()->GetReferenceCount() > 1)
+    PyErr_SetString( PyExc_RuntimeError, "Unknown pixel type." );
+    }
+  return NULL;
+}
+
+// NumPy 2 renamed the number of builtin types and hides the descriptor fields
+#ifndef NPY_NTYPES_LEGACY
+#define NPY_NTYPES_LEGACY NPY_NTYPES
+#endif
+#ifndef PyDataType_ELSIZE
+#define PyDataType_ELSIZE( descr ) ( ( descr )->elsize )
+#endif
+
+/** The NumPy type number of a pixel component type. */
+template< typename TComponent > struct sitk_NumPyType;
+template<> struct sitk_NumPyType< int8_t >   { enum { Value = NPY_INT8 }; };
+template<> struct sitk_NumPyType< uint8_t >  { enum { Value = NPY_UINT8 }; };
+template<> struct sitk_NumPyType< int16_t >  { enum { Value = NPY_INT16 }; };
+template<> struct sitk_NumPyType< uint16_t > { enum { Value = NPY_UINT16 }; };
+template<> struct sitk_NumPyType< int32_t >  { enum { Value = NPY_INT32 }; };
+template<> struct sitk_NumPyType< uint32_t > { enum { Value = NPY_UINT32 }; };
+template<> struct sitk_NumPyType< int64_t >  { enum { Value = NPY_INT64 }; };
+template<> struct sitk_NumPyType< uint64_t > { enum { Value = NPY_UINT64 }; };
+template<> struct sitk_NumPyType< float >    { enum { Value = NPY_FLOAT32 }; };
+template<> struct sitk_NumPyType< double >   { enum { Value = NPY_FLOAT64 }; };
+
+/** \class sitk_NumPyTypeMap
+ * Maps between PixelIDValues and NumPy type numbers. The map is built
+ * once from the pixel types of the dispatch table, so the conversion
+ * functions do not have to rebuild a dictionary on each call.
+ */
+class sitk_NumPyTypeMap
+{
+public:
+  static const sitk_NumPyTypeMap & GetInstance( void )
+    {
+    // NumPy must be imported before the descriptors are compared
+    static const sitk_NumPyTypeMap map;
+    return map;
+    }
+
+  /** The NumPy type number of a pixel type, or -1. */
+  int GetNumPyType( int pixelID ) const
+    {
+    if( pixelID < 0 || pixelID >= NumberOfPixelIDs )
+      {
+      return -1;
+      }
+    return m_NumPyType[pixelID];
+    }
+
+  /** The scalar or vector PixelIDValue of a NumPy type number, or sitkUnknown. */
+  int GetPixelID( int numpyType, bool isVector ) const
+    {
+    if( numpyType < 0 || numpyType >= NPY_USERDEF )
+      {
+      return sitk::sitkUnknown;
+      }
+    return isVector ? m_VectorPixelID[numpyType] : m_ScalarPixelID[numpyType];
+    }
+
+private:
+  enum { NumberOfPixelIDs = sitk::PixelIDDispatchTable::NumberOfPixelIDs };
+
+  struct Register
+  {
+    explicit Register( sitk_NumPyTypeMap & map ) : m_Map( map ) {}
+
+    template< typename TPixelIDType >
+    void operator()( void ) const
       {
-      itkImage->GetPixelContainer()->UnRegister();
+      typedef typename sitk::PixelIDToImageType< TPixelIDType, 2 >::ImageType ImageType;
+      const int pixelID = sitk::PixelIDToPixelIDValue< TPixelIDType >::Result;
+      const int numpyType = sitk_NumPyType< typename ImageType::InternalPixelType >::Value;
+      const bool isVector = sitk::IsVector< TPixelIDType >::Value;
+
+      m_Map.m_NumPyType[pixelID] = numpyType;
+
+      // equivalent type numbers, e.g. NPY_LONGLONG for NPY_INT64
+      for( int t = 0; t < NPY_NTYPES_LEGACY; ++t )
+        {
+        if( PyArray_EquivTypenums( t, numpyType ) )
+          {
+          ( isVector ? m_Map.m_VectorPixelID : m_Map.m_ScalarPixelID )[t] = pixelID;
+          }
+        }
       }
+
+    sitk_NumPyTypeMap & m_Map;
+  };
+
+  sitk_NumPyTypeMap( void )
+    {
+    std::fill( m_NumPyType, m_NumPyType + NumberOfPixelIDs, -1 );
+    std::fill( m_ScalarPixelID, m_ScalarPixelID + NPY_USERDEF, int( sitk::sitkUnknown ) );
+    std::fill( m_VectorPixelID, m_VectorPixelID + NPY_USERDEF, int( sitk::sitkUnknown ) );
+
+    const Register visitor( *this );
+    sitk::typelist::Visit< sitk::PixelIDDispatchTable::PixelIDTypeList > visitEachType;
+    visitEachType( visitor );
     }
+
+  int m_NumPyType[NumberOfPixelIDs];
+  int m_ScalarPixelID[NPY_USERDEF];
+  int m_VectorPixelID[NPY_USERDEF];
+};
+
+/** Creates an uninitialized NumPy array of the given type and shape. */
+static PyArrayObject *
+sitk_NewNumPyArray( int numpyType, int nd, npy_intp *dims )
+{
+  return reinterpret_cast< PyArrayObject * >(
+    PyArray_NewFromDescr( &PyArray_Type, PyArray_DescrFromType( numpyType ), nd, dims, NULL, NULL, 0, NULL ) );
 }
 
-template<typename TPixel, unsigned int VImageDimension = 2>
-const void*
-sitkSetReferenceCountOfVectorImage(sitk::Image * sitkImage,
-                                   bool bIncreaseRefCnt = true)
+// Alignment of the arrays created by GetArrayFromImage, suitable for
+// aligned loads of the widest (AVX-512) vector registers.
+static const size_t sitk_ArrayAlignment = 64;
+static const char * const sitk_AlignedBufferName = "SimpleITK.AlignedBuffer";
+
+static void *
+sitk_AlignedMalloc( size_t nbytes )
 {
-  typedef itk::VectorImage<TPixel, VImageDimension>  ImageType;
-  typename ImageType::Pointer itkImage = (ImageType*)(sitkImage->GetITKBase());
-   if(bIncreaseRefCnt)
+  void *buffer = NULL;
+  nbytes = std::max( nbytes, size_t(1) );
+#ifdef _WIN32
+  buffer = _aligned_malloc( nbytes, sitk_ArrayAlignment );
+#else
+  if( posix_memalign( &buffer, sitk_ArrayAlignment, nbytes ) != 0 )
     {
-    itkImage->GetPixelContainer()->Register();
+    buffer = NULL;
     }
-  else
+#endif
+  return buffer;
+}
+
+static void
+sitk_AlignedFree( void *buffer )
+{
+#ifdef _WIN32
+  _aligned_free( buffer );
+#else
+  free( buffer );
+#endif
+}
+
+static void
+sitk_FreeAlignedBuffer( PyObject *capsule )
+{
+  sitk_AlignedFree( PyCapsule_GetPointer( capsule, sitk_AlignedBufferName ) );
+}
+
+/** Creates an uninitialized NumPy array of the given type and shape
+ * whose data is aligned to sitk_ArrayAlignment bytes. The array owns
+ * the memory through a capsule as its base object.
+ */
+static PyArrayObject *
+sitk_NewAlignedNumPyArray( int numpyType, int nd, npy_intp *dims )
+{
+  PyArray_Descr *descr  = PyArray_DescrFromType( numpyType );
+  size_t         nbytes = PyDataType_ELSIZE( descr );
+  void *         buffer;
+  PyObject *     capsule;
+  PyArrayObject *array;
+
+  for( int d = 0; d < nd; ++d )
+    {
+    nbytes *= dims[d];
+    }
+
+  buffer = sitk_AlignedMalloc( nbytes );
+  if( !buffer )
+    {
+    Py_DECREF( descr );
+    PyErr_NoMemory();
+    return NULL;
+    }
+
+  capsule = PyCapsule_New( buffer, sitk_AlignedBufferName, sitk_FreeAlignedBuffer );
+  if( !capsule )
+    {
+    Py_DECREF( descr );
+    sitk_AlignedFree( buffer );
+    return NULL;
+    }
+
+  array = reinterpret_cast< PyArrayObject * >(
+    PyArray_NewFromDescr( &PyArray_Type, descr, nd, dims, NULL, buffer, NPY_ARRAY_CARRAY, NULL ) );
+  if( !array )
+    {
+    Py_DECREF( capsule );
+    return NULL;
+    }
+  // steals the reference of the capsule
+  if( PyArray_SetBaseObject( array, capsule ) < 0 )
+    {
+    Py_DECREF( array );
+    return NULL;
+    }
+  return array;
+}
+
+static const char * const sitk_ImageCapsuleName = "SimpleITK.Image";
+
+static void
+sitk_DeleteCapsuleImage( PyObject *capsule )
+{
+  delete static_cast< sitk::Image * >( PyCapsule_GetPointer( capsule, sitk_ImageCapsuleName ) );
+}
+
+/** Creates a read only NumPy array of the pixel buffer of an image.
+ * The array keeps a shallow copy of the image as its base object, so
+ * the buffer is valid for the life time of the array, and a later
+ * modification of the image copies it instead of changing the array.
+ */
+static PyArrayObject *
+sitk_NewImageOwningNumPyArray( const sitk::Image &image,
+                               const sitk::PixelIDDispatchEntry *entry,
+                               int numpyType, int nd, npy_intp *dims )
+{
+  sitk::Image *  holder = new sitk::Image( image );
+  PyObject *     capsule;
+  PyArrayObject *array;
+
+  capsule = PyCapsule_New( holder, sitk_ImageCapsuleName, sitk_DeleteCapsuleImage );
+  if( !capsule )
+    {
+    delete holder;
+    return NULL;
+    }
+
+  array = reinterpret_cast< PyArrayObject * >(
+    PyArray_NewFromDescr( &PyArray_Type, PyArray_DescrFromType( numpyType ), nd, dims, NULL,
+                          const_cast< void * >( entry->GetConstBuffer( *holder ) ),
+                          NPY_ARRAY_C_CONTIGUOUS | NPY_ARRAY_ALIGNED, NULL ) );
+  if( !array )
+    {
+    Py_DECREF( capsule );
+    return NULL;
+    }
+  // steals the reference of the capsule
+  if( PyArray_SetBaseObject( array, capsule ) < 0 )
+    {
+    Py_DECREF( array );
+    return NULL;
+    }
+  return array;
+}
+
+namespace
+{
+
+/** \class PyBufferReleaseCommand
+ * \brief Releases a python buffer, with the GIL, when the pixel
+ * container which imported it is deleted.
+ */
+class PyBufferReleaseCommand
+  : public itk::Command
+{
+public:
+  typedef PyBufferReleaseCommand      Self;
+  typedef itk::Command                Superclass;
+  typedef itk::SmartPointer< Self >   Pointer;
+
+  itkNewMacro( Self );
+
+  /** Takes over the buffer, which is cleared. */
+  void SetBuffer( Py_buffer *buffer )
+    {
+    m_Buffer = *buffer;
+    memset( buffer, 0, sizeof( Py_buffer ) );
+    }
+
+  virtual void Execute( itk::Object *, const itk::EventObject & )
+    {
+    this->Release();
+    }
+
+  virtual void Execute( const itk::Object *, const itk::EventObject & )
+    {
+    this->Release();
+    }
+
+protected:
+  PyBufferReleaseCommand( void )
+    {
+    memset( &m_Buffer, 0, sizeof( Py_buffer ) );
+    }
+
+  ~PyBufferReleaseCommand( void )
+    {
+    this->Release();
+    }
+
+private:
+  PyBufferReleaseCommand( const Self & );
+  void operator=( const Self & );
+
+  void Release( void )
+    {
+    if( m_Buffer.obj && Py_IsInitialized() )
+      {
+      PyGILState_STATE state = PyGILState_Ensure();
+      PyBuffer_Release( &m_Buffer );
+      PyGILState_Release( state );
+      }
+    }
+
+  Py_buffer m_Buffer;
+};
+
+} // end anonymous namespace
+
+/** Returns true if the statistics are requested by the optional
+ * statistics argument of a conversion. */
+static bool
+sitk_IsStatisticsRequested( PyObject *pyStatistics )
+{
+  return pyStatistics && pyStatistics != Py_None;
+}
+
+/** Parses the optional statistics argument of a conversion, None or
+ * a ( bins, minimum, maximum ) tuple of the histogram, with 0 bins
+ * for no histogram. On failure a python exception is set.
+ */
+static bool
+sitk_ParseStatisticsRequest( PyObject *pyStatistics, sitk::ConversionStatistics &statistics )
+{
+  Py_ssize_t bins = 0;
+
+  if( !sitk_IsStatisticsRequested( pyStatistics ) )
+    {
+    return true;
+    }
+  if( !PyArg_ParseTuple( pyStatistics, "ndd", &bins, &statistics.HistogramMinimum, &statistics.HistogramMaximum ) )
+    {
+    return false;
+    }
+  if( bins < 0 || ( bins > 0 && !( statistics.HistogramMinimum <= statistics.HistogramMaximum ) ) )
+    {
+    PyErr_SetString( PyExc_ValueError, "Invalid histogram bins or range." );
+    return false;
+    }
+  statistics.Histogram.resize( static_cast< size_t >( bins ), 0 );
+  return true;
+}
+
+/** Computes the statistics of a buffer which is not copied, e.g. a
+ * view, if they are requested. */
+static void
+sitk_ComputeViewStatistics( const sitk::PixelIDDispatchEntry &entry, const void *buffer, size_t numberOfComponents,
+                            PyObject *pyStatistics, sitk::ConversionStatistics &statistics )
+{
+  if( sitk_IsStatisticsRequested( pyStatistics ) )
+    {
+    Py_BEGIN_ALLOW_THREADS
+    sitk::CopyWithStatistics( entry, buffer, NULL, numberOfComponents, statistics );
+    Py_END_ALLOW_THREADS
+    }
+}
+
+/** Returns the result of a conversion, or if the statistics are
+ * requested, a tuple of the result and a dictionary of the statistics
+ * named as the measurements of StatisticsImageFilter. The reference
+ * to the result is stolen.
+ */
+static PyObject *
+sitk_ReturnWithStatistics( PyObject *result, PyObject *pyStatistics, const sitk::ConversionStatistics &statistics )
+{
+  PyObject *      dict;
+  PyArrayObject * histogram;
+  npy_intp        bins;
+  const double    nan = std::numeric_limits< double >::quiet_NaN();
+  const bool      empty = statistics.Count == 0;
+
+  if( !result || !sitk_IsStatisticsRequested( pyStatistics ) )
     {
-    if(itkImage->GetPixelContainer()->GetReferenceCount() > 1)
+    return result;
+    }
+
+  dict = Py_BuildValue( "{s:d,s:d,s:d,s:d,s:d,s:d,s:n}",
+                        "Minimum", empty ? nan : statistics.Minimum,
+                        "Maximum", empty ? nan : statistics.Maximum,
+                        "Mean", empty ? nan : statistics.Mean,
+                        "Variance", statistics.GetVariance(),
+                        "Sigma", sqrt( statistics.GetVariance() ),
+                        "Sum", statistics.GetSum(),
+                        "Count", static_cast< Py_ssize_t >( statistics.Count ) );
+  if( dict && !statistics.Histogram.empty() )
+    {
+    bins = static_cast< npy_intp >( statistics.Histogram.size() );
+    histogram = sitk_NewNumPyArray( NPY_INT64, 1, &bins );
+    if( !histogram )
+      {
+      Py_CLEAR( dict );
+      }
+    else
       {
-      itkImage->GetPixelContainer()->UnRegister();
+      std::copy( statistics.Histogram.begin(), statistics.Histogram.end(),
+                 static_cast< npy_int64 * >( PyArray_DATA( histogram ) ) );
+      if( PyDict_SetItemString( dict, "Histogram", reinterpret_cast< PyObject * >( histogram ) ) < 0 )
+        {
+        Py_CLEAR( dict );
+        }
+      Py_DECREF( histogram );
       }
     }
+  if( !dict )
+    {
+    Py_DECREF( result );
+    return NULL;
+    }
+  return Py_BuildValue( "NN", result, dict );
 }
 
 // Python is written in C
@@ -74,22 +479,29 @@ extern "C"
 {
 #endif
 
-/** An internal function that performs a deep copy of the image buffer
- * into a python byte array. The byte array can later be converted
- * into a numpy array with the from buffer method.
+/** An internal function that exports the image buffer to python. With
+ * the copy operation it performs a deep copy of the image buffer into
+ * a new, aligned NumPy array of the final shape and type. With the
+ * array view operation it returns a memoryview of the image buffer.
+ * The third operation returns a read only NumPy array of the image
+ * buffer which keeps the pixels alive, e.g. for pickling.
  */
 static PyObject *
 sitk_GetByteArrayFromImage( PyObject *SWIGUNUSEDPARM(self), PyObject *args )
 {
   // Holds the bulk data
-  PyObject *                  byteArray     = NULL;
+  PyArrayObject *             array         = NULL;
 
   const void *                sitkBufferPtr;
   Py_ssize_t                  len;
   std::vector< unsigned int > size;
   size_t                      pixelSize     = 1;
+  npy_intp                    dims[SITK_MAX_DIMENSION + 1];
+  int                         nd            = 0;
 
   unsigned int                dimension;
+  unsigned int                numberOfComponents;
+  const sitk::PixelIDDispatchEntry * entry;
 
   /* Cast over to a sitk Image. */
   PyObject *                  pyImage;
@@ -102,11 +514,18 @@ sitk_GetByteArrayFromImage( PyObject *SWIGUNUSEDPARM(self), PyObject *args )
   Py_buffer                   pyBuffer;
   memset(&pyBuffer, 0, sizeof(Py_buffer));
 
+  PyObject *                  pyStatistics  = NULL;
+  sitk::ConversionStatistics  statistics;
 
-  if( !PyArg_ParseTuple( args, "Oi", &pyImage, &arrayViewFlag ) )
+
+  if( !PyArg_ParseTuple( args, "Oi|O", &pyImage, &arrayViewFlag, &pyStatistics ) )
     {
     SWIG_fail; // SWIG_fail is a macro that says goto: fail (return NULL)
     }
+  if( !sitk_ParseStatisticsRequest( pyStatistics, statistics ) )
+    {
+    SWIG_fail;
+    }
   res = SWIG_ConvertPtr( pyImage, &voidImage, SWIGTYPE_p_itk__simple__Image, 0 );
   if( !SWIG_IsOK( res ) )
     {
@@ -116,99 +535,58 @@ sitk_GetByteArrayFromImage( PyObject *SWIGUNUSEDPARM(self), PyObject *args )
   dimension = sitkImage->GetDimension();
   size      = sitkImage->GetSize();
 
-  switch( sitkImage->GetPixelIDValue() )
+  entry = sitk_GetPixelIDDispatchEntry( sitkImage->GetPixelIDValue(), dimension );
+  if( !entry )
     {
-  case sitk::sitkUnknown:
-    PyErr_SetString( PyExc_RuntimeError, "Unknown pixel type." );
-    SWIG_fail;
-    break;
-  case sitk::ConditionalValue< sitk::sitkVectorUInt8 != sitk::sitkUnknown, sitk::sitkVectorUInt8, -14 >::Value:
-  case sitk::ConditionalValue< sitk::sitkUInt8 != sitk::sitkUnknown, sitk::sitkUInt8, -2 >::Value:
-    sitkBufferPtr = (const void *)sitkImage->GetBufferAsUInt8();
-    pixelSize  = sizeof( uint8_t );
-    break;
-  case sitk::ConditionalValue< sitk::sitkVectorInt8 != sitk::sitkUnknown, sitk::sitkVectorInt8, -15 >::Value:
-  case sitk::ConditionalValue< sitk::sitkInt8 != sitk::sitkUnknown, sitk::sitkInt8, -3 >::Value:
-    sitkBufferPtr = (const void *)sitkImage->GetBufferAsInt8();
-    pixelSize  = sizeof( int8_t );
-    break;
-  case sitk::ConditionalValue< sitk::sitkVectorUInt16 != sitk::sitkUnknown, sitk::sitkVectorUInt16, -16 >::Value:
-  case sitk::ConditionalValue< sitk::sitkUInt16 != sitk::sitkUnknown, sitk::sitkUInt16, -4 >::Value:
-    sitkBufferPtr = (const void *)sitkImage->GetBufferAsUInt16();
-    pixelSize  = sizeof( uint16_t );
-    break;
-  case sitk::ConditionalValue< sitk::sitkVectorInt16 != sitk::sitkUnknown, sitk::sitkVectorInt16, -17 >::Value:
-  case sitk::ConditionalValue< sitk::sitkInt16 != sitk::sitkUnknown, sitk::sitkInt16, -5 >::Value:
-    sitkBufferPtr = (const void *)sitkImage->GetBufferAsInt16();
-    pixelSize  = sizeof( int16_t );
-    break;
-  case sitk::ConditionalValue< sitk::sitkVectorUInt32 != sitk::sitkUnknown, sitk::sitkVectorUInt32, -18 >::Value:
-  case sitk::ConditionalValue< sitk::sitkUInt32 != sitk::sitkUnknown, sitk::sitkUInt32, -6 >::Value:
-    sitkBufferPtr = (const void *)sitkImage->GetBufferAsUInt32();
-    pixelSize  = sizeof( uint32_t );
-    break;
-  case sitk::ConditionalValue< sitk::sitkVectorInt32 != sitk::sitkUnknown, sitk::sitkVectorInt32, -19 >::Value:
-  case sitk::ConditionalValue< sitk::sitkInt32 != sitk::sitkUnknown, sitk::sitkInt32, -7 >::Value:
-    sitkBufferPtr = (const void *)sitkImage->GetBufferAsInt32();
-    pixelSize  = sizeof( int32_t );
-    break;
-  case sitk::ConditionalValue< sitk::sitkVectorUInt64 != sitk::sitkUnknown, sitk::sitkVectorUInt64, -20 >::Value:
-  case sitk::ConditionalValue< sitk::sitkUInt64 != sitk::sitkUnknown, sitk::sitkUInt64, -8 >::Value:
-    sitkBufferPtr = (const void *)sitkImage->GetBufferAsUInt64();
-    pixelSize  = sizeof( uint64_t );
-    break;
-  case sitk::ConditionalValue< sitk::sitkVectorInt64 != sitk::sitkUnknown, sitk::sitkVectorInt64, -21 >::Value:
-  case sitk::ConditionalValue< sitk::sitkInt64 != sitk::sitkUnknown, sitk::sitkInt64, -9 >::Value:
-     sitkBufferPtr = (const void *)sitkImage->GetBufferAsInt64();
-     pixelSize  = sizeof( int64_t );
-     break;
-  case sitk::ConditionalValue< sitk::sitkVectorFloat32 != sitk::sitkUnknown, sitk::sitkVectorFloat32, -22 >::Value:
-  case sitk::ConditionalValue< sitk::sitkFloat32 != sitk::sitkUnknown, sitk::sitkFloat32, -10 >::Value:
-    sitkBufferPtr = (const void *)sitkImage->GetBufferAsFloat();
-    pixelSize  = sizeof( float );
-    break;
-  case sitk::ConditionalValue< sitk::sitkVectorFloat64 != sitk::sitkUnknown, sitk::sitkVectorFloat64, -23 >::Value:
-  case sitk::ConditionalValue< sitk::sitkFloat64 != sitk::sitkUnknown, sitk::sitkFloat64, -11 >::Value:
-    sitkBufferPtr = (const void *)sitkImage->GetBufferAsDouble(); // \todo rename to Float64 for consistency
-    pixelSize  = sizeof( double );
-    break;
-  case sitk::ConditionalValue< sitk::sitkComplexFloat32 != sitk::sitkUnknown, sitk::sitkComplexFloat32, -12 >::Value:
-  case sitk::ConditionalValue< sitk::sitkComplexFloat64 != sitk::sitkUnknown, sitk::sitkComplexFloat64, -13 >::Value:
-    PyErr_SetString( PyExc_RuntimeError, "Images of Complex Pixel types currently are not supported." );
-    SWIG_fail;
-    break;
-  default:
-    PyErr_SetString( PyExc_RuntimeError, "Unknown pixel type." );
     SWIG_fail;
     }
+  // only the writable view needs a unique buffer, the copy and the
+  // read only array do not make a shared image unique
+  if( arrayViewFlag == 1 )
+    {
+    sitkBufferPtr = entry->GetBuffer( *sitkImage );
+    }
+  else
+    {
+    sitkBufferPtr = entry->GetConstBuffer( *sitkImage );
+    }
+  pixelSize     = entry->ComponentSize;
 
-  // if the image is a vector just treat is as another dimension
-  if ( sitkImage->GetNumberOfComponentsPerPixel() > 1 )
+  // the array is indexed in the reverse order of the image, if the
+  // image is a vector just treat is as another dimension
+  for( size_t d = size.size(); d > 0; --d )
     {
-    size.push_back( sitkImage->GetNumberOfComponentsPerPixel() );
+    dims[nd++] = size[d-1];
+    }
+  numberOfComponents = sitkImage->GetNumberOfComponentsPerPixel();
+  if ( numberOfComponents > 1 )
+    {
+    dims[nd++] = numberOfComponents;
     }
 
-  len = std::accumulate( size.begin(), size.end(), size_t(1), std::multiplies<size_t>() );
+  len = std::accumulate( dims, dims + nd, size_t(1), std::multiplies<size_t>() );
   len *= pixelSize;
 
   if(arrayViewFlag == 0)
     {
-    // When the string is null, the bytearray is uninitialized but allocated
-    byteArray = PyByteArray_FromStringAndSize( NULL, len );
-    if( !byteArray )
+    array = sitk_NewAlignedNumPyArray( sitk_NumPyTypeMap::GetInstance().GetNumPyType( sitkImage->GetPixelIDValue() ), nd, dims );
+    if( !array )
       {
-      PyErr_SetString( PyExc_RuntimeError, "Error initializing bytearray." );
       SWIG_fail;
       }
-
-    char *arrayView;
-    if( (arrayView = PyByteArray_AsString( byteArray ) ) == NULL  )
+    if( sitk_IsStatisticsRequested( pyStatistics ) )
       {
-      SWIG_fail;
+      // the statistics are computed in the copy loop
+      Py_BEGIN_ALLOW_THREADS
+      sitk::CopyWithStatistics( *entry, sitkBufferPtr, PyArray_DATA( array ), len / pixelSize, statistics );
+      Py_END_ALLOW_THREADS
+      }
+    else
+      {
+      memcpy( PyArray_DATA( array ), sitkBufferPtr, len );
       }
-    memcpy( arrayView, sitkBufferPtr, len );
 
-    return byteArray;
+    return sitk_ReturnWithStatistics( reinterpret_cast< PyObject * >( array ), pyStatistics, statistics );
     }
   else if (arrayViewFlag == 1)
     {
@@ -216,7 +594,20 @@ sitk_GetByteArrayFromImage( PyObject *SWIGUNUSEDPARM(self), PyObject *args )
     memoryView = PyMemoryView_FromBuffer(&pyBuffer);
 
     PyBuffer_Release(&pyBuffer);
-    return memoryView;
+    sitk_ComputeViewStatistics( *entry, sitkBufferPtr, len / pixelSize, pyStatistics, statistics );
+    return sitk_ReturnWithStatistics( memoryView, pyStatistics, statistics );
+    }
+  else if (arrayViewFlag == 2)
+    {
+    array = sitk_NewImageOwningNumPyArray( *sitkImage, entry,
+                                           sitk_NumPyTypeMap::GetInstance().GetNumPyType( sitkImage->GetPixelIDValue() ),
+                                           nd, dims );
+    if( !array )
+      {
+      SWIG_fail;
+      }
+    sitk_ComputeViewStatistics( *entry, sitkBufferPtr, len / pixelSize, pyStatistics, statistics );
+    return sitk_ReturnWithStatistics( reinterpret_cast< PyObject * >( array ), pyStatistics, statistics );
     }
   else
     {
@@ -225,13 +616,15 @@ sitk_GetByteArrayFromImage( PyObject *SWIGUNUSEDPARM(self), PyObject *args )
     }
 
 fail:
-  Py_XDECREF( byteArray );
+  Py_XDECREF( array );
   return NULL;
 }
 
-/** An internal function that performs a deep copy of the image buffer
- * into a python byte array. The byte array can later be converted
- * into a numpy array with the frombuffer method.
+/** An internal function that creates an image from a buffer. The
+ * buffer is copied, or with the image view operation, used by the
+ * image without a reference, so the caller keeps it alive. With the
+ * third operation a writable buffer is used by the image, which keeps
+ * a reference to it, and a read only buffer is copied.
  */
 static PyObject*
 sitk_SetImageFromArray( PyObject *SWIGUNUSEDPARM(self), PyObject *args )
@@ -248,7 +641,7 @@ sitk_SetImageFromArray( PyObject *SWIGUNUSEDPARM(self), PyObject *args )
   const void *                buffer;
   void *                      sitkBufferPtr = NULL;
   sitk::Image *               sitkImage     = NULL;
-  sitk::ImportImageFilter     importer;
+  const sitk::PixelIDDispatchEntry * entry  = NULL;
 
   int                         arrayViewFlag = 0;
   int                         PixelIDValue  = 0;
@@ -259,11 +652,11 @@ sitk_SetImageFromArray( PyObject *SWIGUNUSEDPARM(self), PyObject *args )
   size_t                      pixelSize     = 1;
   size_t                      len           = 1;
   std::vector< unsigned int > size;
-  std::vector< double>        spacing;
-  std::vector< double>        origin;
-  std::vector< double>        direction;
 
-  if (!PyArg_ParseTuple( args, "s*iOi|i", &pyBuffer, &arrayViewFlag, &obj, &PixelIDValue, &NumOfComponent ))
+  PyObject *                  pyStatistics  = NULL;
+  sitk::ConversionStatistics  statistics;
+
+  if (!PyArg_ParseTuple( args, "s*iOi|iO", &pyBuffer, &arrayViewFlag, &obj, &PixelIDValue, &NumOfComponent, &pyStatistics ))
     {
     PyErr_Clear();
 
@@ -274,7 +667,7 @@ sitk_SetImageFromArray( PyObject *SWIGUNUSEDPARM(self), PyObject *args )
 #endif
 
     bufSizeType _len;
-    if( !PyArg_ParseTuple( args, "s#iOi|i", &buffer, &_len, &arrayViewFlag, &obj, &PixelIDValue, &NumOfComponent ) )
+    if( !PyArg_ParseTuple( args, "s#iOi|iO", &buffer, &_len, &arrayViewFlag, &obj, &PixelIDValue, &NumOfComponent, &pyStatistics ) )
       {
       return NULL;
       }
@@ -286,178 +679,72 @@ sitk_SetImageFromArray( PyObject *SWIGUNUSEDPARM(self), PyObject *args )
     buffer     = pyBuffer.buf;
     }
 
+  if( !sitk_ParseStatisticsRequest( pyStatistics, statistics ) )
+    {
+    goto fail;
+    }
+
   shapeseq   = PySequence_Fast(obj, "expected sequence");
-  dimension  = PySequence_Size(obj);
+  if( !shapeseq )
+    {
+    goto fail;
+    }
+  dimension  = PySequence_Fast_GET_SIZE(shapeseq);
 
   for(unsigned int i=0 ; i< dimension; ++i)
     {
     item = PySequence_Fast_GET_ITEM(shapeseq,i);
     size.push_back((unsigned int)PyInt_AsLong(item));
     }
+  Py_DECREF( shapeseq );
 
-  if (dimension == 2 )
-    {
-    spacing      = std::vector<double>( 2, 1.0 );
-    origin       = std::vector<double>( 2, 0.0 );
-    direction    = std::vector<double>( 4, 0.0 );
-    direction[0] = direction[3] = 1.0;
-    }
-  else if (dimension == 3)
+  entry = sitk_GetPixelIDDispatchEntry( PixelIDValue, dimension );
+  if( !entry )
     {
-    spacing      = std::vector<double>( 3, 1.0 );
-    origin       = std::vector<double>( 3, 0.0 );
-    direction    = std::vector<double>( 9, 0.0 );
-    direction[0] = direction[4] = direction[8] = 1.0;
+    goto fail;
     }
+  pixelSize = entry->ComponentSize;
 
-  if(arrayViewFlag == 0)
-    {
-    sitkImage  = new itk::simple::Image(size, (itk::simple::PixelIDValueEnum)PixelIDValue, NumOfComponent);
-    }
-  else
+  // if the image is a vector just treat is as another dimension
+  len = std::accumulate( size.begin(), size.end(), size_t(1), std::multiplies<size_t>() );
+  len *= pixelSize * NumOfComponent;
+
+  if ( buffer_len != len )
     {
-    importer.SetSize( size );
-    importer.SetSpacing( spacing );
-    importer.SetOrigin( origin );
-    importer.SetDirection( direction );
+    PyErr_SetString( PyExc_RuntimeError, "Size mismatch of image and Buffer." );
+    goto fail;
     }
 
   try
     {
-    switch( PixelIDValue )
+    if( arrayViewFlag == 2 && pyBuffer.obj && !pyBuffer.readonly )
+      {
+      // the pixel container releases the buffer when it is deleted
+      PyBufferReleaseCommand::Pointer releaseCommand = PyBufferReleaseCommand::New();
+      releaseCommand->SetBuffer( &pyBuffer );
+      sitkImage = entry->ImportBuffer( const_cast< void * >( buffer ), size, NumOfComponent, releaseCommand.GetPointer() );
+      sitk_ComputeViewStatistics( *entry, buffer, len / pixelSize, pyStatistics, statistics );
+      }
+    else if(arrayViewFlag == 0 || arrayViewFlag == 2)
+      {
+      sitkImage     = new itk::simple::Image(size, (itk::simple::PixelIDValueEnum)PixelIDValue, NumOfComponent);
+      sitkBufferPtr = entry->GetBuffer( *sitkImage );
+      if( sitk_IsStatisticsRequested( pyStatistics ) )
+        {
+        // the statistics are computed in the copy loop
+        Py_BEGIN_ALLOW_THREADS
+        sitk::CopyWithStatistics( *entry, buffer, sitkBufferPtr, len / pixelSize, statistics );
+        Py_END_ALLOW_THREADS
+        }
+      else
+        {
+        memcpy( sitkBufferPtr, buffer, len );
+        }
+      }
+    else
       {
-      case sitk::sitkUnknown:
-        PyErr_SetString( PyExc_RuntimeError, "Unknown pixel type." );
-        goto fail;
-        break;
-      case sitk::ConditionalValue< sitk::sitkVectorUInt8 != sitk::sitkUnknown, sitk::sitkVectorUInt8, -14 >::Value:
-      case sitk::ConditionalValue< sitk::sitkUInt8 != sitk::sitkUnknown, sitk::sitkUInt8, -2 >::Value:
-        pixelSize         = sizeof( uint8_t );
-        if( arrayViewFlag == 0)
-          {
-          sitkBufferPtr = (void *)sitkImage->GetBufferAsUInt8();
-          }
-        else
-          {
-          importer.SetBufferAsUInt8((uint8_t*)buffer, NumOfComponent);
-          }
-        break;
-      case sitk::ConditionalValue< sitk::sitkVectorInt8 != sitk::sitkUnknown, sitk::sitkVectorInt8, -15 >::Value:
-      case sitk::ConditionalValue< sitk::sitkInt8 != sitk::sitkUnknown, sitk::sitkInt8, -3 >::Value:
-        pixelSize         = sizeof( int8_t );
-        if( arrayViewFlag == 0)
-          {
-          sitkBufferPtr = (void *)sitkImage->GetBufferAsInt8();
-          }
-        else
-          {
-          importer.SetBufferAsInt8((int8_t*)buffer, NumOfComponent);
-          }
-        break;
-      case sitk::ConditionalValue< sitk::sitkVectorUInt16 != sitk::sitkUnknown, sitk::sitkVectorUInt16, -16 >::Value:
-      case sitk::ConditionalValue< sitk::sitkUInt16 != sitk::sitkUnknown, sitk::sitkUInt16, -4 >::Value:
-        pixelSize         = sizeof( uint16_t );
-        if( arrayViewFlag == 0)
-          {
-          sitkBufferPtr = (void *)sitkImage->GetBufferAsUInt16();
-          }
-        else
-          {
-          importer.SetBufferAsUInt16((uint16_t*)buffer, NumOfComponent);
-          }
-        break;
-      case sitk::ConditionalValue< sitk::sitkVectorInt16 != sitk::sitkUnknown, sitk::sitkVectorInt16, -17 >::Value:
-      case sitk::ConditionalValue< sitk::sitkInt16 != sitk::sitkUnknown, sitk::sitkInt16, -5 >::Value:
-        pixelSize         = sizeof( int16_t );
-        if( arrayViewFlag == 0)
-          {
-          sitkBufferPtr = (void *)sitkImage->GetBufferAsInt16();
-          }
-        else
-          {
-          importer.SetBufferAsInt16((int16_t*)buffer, NumOfComponent);
-          }
-        break;
-      case sitk::ConditionalValue< sitk::sitkVectorUInt32 != sitk::sitkUnknown, sitk::sitkVectorUInt32, -18 >::Value:
-      case sitk::ConditionalValue< sitk::sitkUInt32 != sitk::sitkUnknown, sitk::sitkUInt32, -6 >::Value:
-        pixelSize         = sizeof( uint32_t );
-        if( arrayViewFlag == 0)
-          {
-          sitkBufferPtr = (void *)sitkImage->GetBufferAsUInt32();
-          }
-        else
-          {
-          importer.SetBufferAsUInt32((uint32_t*)buffer, NumOfComponent);
-          }
-        break;
-      case sitk::ConditionalValue< sitk::sitkVectorInt32 != sitk::sitkUnknown, sitk::sitkVectorInt32, -19 >::Value:
-      case sitk::ConditionalValue< sitk::sitkInt32 != sitk::sitkUnknown, sitk::sitkInt32, -7 >::Value:
-        pixelSize         = sizeof( int32_t );
-        if( arrayViewFlag == 0)
-          {
-          sitkBufferPtr = (void *)sitkImage->GetBufferAsInt32();
-          }
-        else
-          {
-          importer.SetBufferAsInt32((int32_t*)buffer, NumOfComponent);
-          }
-        break;
-      case sitk::ConditionalValue< sitk::sitkVectorUInt64 != sitk::sitkUnknown, sitk::sitkVectorUInt64, -20 >::Value:
-      case sitk::ConditionalValue< sitk::sitkUInt64 != sitk::sitkUnknown, sitk::sitkUInt64, -8 >::Value:
-        pixelSize         = sizeof( uint64_t );
-        if( arrayViewFlag == 0)
-          {
-          sitkBufferPtr = (void *)sitkImage->GetBufferAsUInt64();
-          }
-        else
-          {
-          importer.SetBufferAsUInt64((uint64_t*)buffer, NumOfComponent);
-          }
-        break;
-      case sitk::ConditionalValue< sitk::sitkVectorInt64 != sitk::sitkUnknown, sitk::sitkVectorInt64, -21 >::Value:
-      case sitk::ConditionalValue< sitk::sitkInt64 != sitk::sitkUnknown, sitk::sitkInt64, -9 >::Value:
-        pixelSize         = sizeof( int64_t );
-        if( arrayViewFlag == 0)
-          {
-          sitkBufferPtr = (void *)sitkImage->GetBufferAsInt64();
-          }
-        else
-          {
-          importer.SetBufferAsInt64((int64_t*)buffer, NumOfComponent);
-          }
-        break;
-      case sitk::ConditionalValue< sitk::sitkVectorFloat32 != sitk::sitkUnknown, sitk::sitkVectorFloat32, -22 >::Value:
-      case sitk::ConditionalValue< sitk::sitkFloat32 != sitk::sitkUnknown, sitk::sitkFloat32, -10 >::Value:
-        pixelSize         = sizeof( float );
-        if( arrayViewFlag == 0)
-          {
-          sitkBufferPtr = (void *)sitkImage->GetBufferAsFloat();
-          }
-        else
-          {
-          importer.SetBufferAsFloat((float*)buffer, NumOfComponent);
-          }
-        break;
-      case sitk::ConditionalValue< sitk::sitkVectorFloat64 != sitk::sitkUnknown, sitk::sitkVectorFloat64, -23 >::Value:
-      case sitk::ConditionalValue< sitk::sitkFloat64 != sitk::sitkUnknown, sitk::sitkFloat64, -11 >::Value:
-        pixelSize         = sizeof( double );
-        if( arrayViewFlag == 0)
-          {
-          sitkBufferPtr = (void *)sitkImage->GetBufferAsDouble(); // \todo rename to Float64 for consistency
-          }
-        else
-          {
-          importer.SetBufferAsDouble((double*)buffer, NumOfComponent);
-          }
-        break;
-      case sitk::ConditionalValue< sitk::sitkComplexFloat32 != sitk::sitkUnknown, sitk::sitkComplexFloat32, -12 >::Value:
-      case sitk::ConditionalValue< sitk::sitkComplexFloat64 != sitk::sitkUnknown, sitk::sitkComplexFloat64, -13 >::Value:
-        PyErr_SetString( PyExc_RuntimeError, "Images of Complex Pixel types currently are not supported." );
-        goto fail;
-        break;
-      default:
-        PyErr_SetString( PyExc_RuntimeError, "Unknown pixel type." );
-        goto fail;
+      sitkImage = entry->ImportBuffer( const_cast< void * >( buffer ), size, NumOfComponent, NULL );
+      sitk_ComputeViewStatistics( *entry, buffer, len / pixelSize, pyStatistics, statistics );
       }
     }
   catch( const std::exception &e )
@@ -468,51 +755,24 @@ sitk_SetImageFromArray( PyObject *SWIGUNUSEDPARM(self), PyObject *args )
     goto fail;
     }
 
-  // if the image is a vector just treat is as another dimension
-  if ( NumOfComponent > 1 )
-    {
-    size.push_back( NumOfComponent );
-    }
-  len = std::accumulate( size.begin(), size.end(), size_t(1), std::multiplies<size_t>() );
-  len *= pixelSize;
-
-  if ( buffer_len != len )
-    {
-    PyErr_SetString( PyExc_RuntimeError, "Size mismatch of image and Buffer." );
-    goto fail;
-    }
-
-  if(arrayViewFlag == 0)
-    {
-    memcpy( (void *)sitkBufferPtr, buffer, len );
-    }
-  else
-    {
-    sitkImage  = new itk::simple::Image(static_cast< const itk::simple::Image& >(importer.Execute()));
-    }
-
-  PyBuffer_Release( &pyBuffer );
-  pyImageObj = SWIG_NewPointerObj(sitkImage, SWIGTYPE_p_itk__simple__Image, SWIG_POINTER_OWN |  0 );
-  return pyImageObj;
+  PyBuffer_Release( &pyBuffer );
+  pyImageObj = SWIG_NewPointerObj(sitkImage, SWIGTYPE_p_itk__simple__Image, SWIG_POINTER_OWN |  0 );
+  return sitk_ReturnWithStatistics( pyImageObj, pyStatistics, statistics );
 
 fail:
+  delete sitkImage;
   PyBuffer_Release( &pyBuffer );
   return NULL;
 }
 
-/** An internal function that performs a deep copy of the image buffer
- * into a python byte array. The byte array can later be converted
- * into a numpy array with the from buffer method.
+/** An internal function which increases or decreases the reference
+ * count of the pixel container of an image. The pixel container is
+ * registered for each exported NumPy array view, so the buffer
+ * outlives the sitk::Image while array views still refer to it.
  */
 static PyObject *
 sitk_SetRefenceCountImage( PyObject *SWIGUNUSEDPARM(self), PyObject *args )
 {
-  const void *                sitkBufferPtr;
-
-  size_t                      pixelSize     = 1;
-
-  unsigned int                dimension;
-
   /* Cast over to a sitk Image. */
   PyObject *                  pyImage;
   void *                      voidImage;
@@ -520,6 +780,7 @@ sitk_SetRefenceCountImage( PyObject *SWIGUNUSEDPARM(self), PyObject *args )
   int                         res           = 0;
   int                         arrayViewFlag = 0;
 
+  const sitk::PixelIDDispatchEntry * entry;
 
   bool                        bIncreaseRefCntOfitkImage = true;
 
@@ -534,8 +795,6 @@ sitk_SetRefenceCountImage( PyObject *SWIGUNUSEDPARM(self), PyObject *args )
     }
   sitkImage = reinterpret_cast< sitk::Image * >( voidImage );
 
-  dimension = sitkImage->GetDimension();
-
   if(arrayViewFlag == 0)
     {
     bIncreaseRefCntOfitkImage = false;
@@ -550,347 +809,964 @@ sitk_SetRefenceCountImage( PyObject *SWIGUNUSEDPARM(self), PyObject *args )
     SWIG_fail;
     }
 
-  switch( sitkImage->GetPixelIDValue() )
+  entry = sitk_GetPixelIDDispatchEntry( sitkImage->GetPixelIDValue(), sitkImage->GetDimension() );
+  if( !entry )
     {
-  case sitk::sitkUnknown:
-    PyErr_SetString( PyExc_RuntimeError, "Unknown pixel type." );
     SWIG_fail;
-    break;
-  case sitk::ConditionalValue< sitk::sitkVectorUInt8 != sitk::sitkUnknown, sitk::sitkVectorUInt8, -14 >::Value:
-    if(dimension == 2)
-      {
-      sitkSetReferenceCountOfVectorImage<uint8_t, 2>(sitkImage, bIncreaseRefCntOfitkImage);
-      }
-    else if (dimension == 3)
-      {
-      sitkSetReferenceCountOfVectorImage<uint8_t, 3>(sitkImage, bIncreaseRefCntOfitkImage);
-      }
-    else
-      {
-      PyErr_SetString( PyExc_RuntimeError, "Unknown image dimension." );
-      goto fail;
-      }
-    pixelSize  = sizeof( uint8_t );
-    break;
-  case sitk::ConditionalValue< sitk::sitkUInt8 != sitk::sitkUnknown, sitk::sitkUInt8, -2 >::Value:
-    if(dimension == 2)
-      {
-      sitkSetReferenceCountOfScalarImage<uint8_t, 2>(sitkImage, bIncreaseRefCntOfitkImage);
-      }
-    else if (dimension == 3)
-      {
-      sitkSetReferenceCountOfScalarImage<uint8_t, 3>(sitkImage, bIncreaseRefCntOfitkImage);
-      }
-    else
+    }
+  entry->SetReferenceCount( *sitkImage, bIncreaseRefCntOfitkImage );
+
+  Py_RETURN_NONE;
+
+fail:
+  return NULL;
+
+}
+
+/** Parses a sequence of non-negative integers of the given length, e.g.
+ * an index or a size. On failure a python exception is set.
+ */
+static bool
+sitk_ParseUnsignedSequence( PyObject *obj, size_t length, std::vector< unsigned int > &values, const char *name )
+{
+  PyObject *seq = PySequence_Fast( obj, "expected sequence" );
+  if( !seq )
+    {
+    return false;
+    }
+  if( static_cast< size_t >( PySequence_Fast_GET_SIZE( seq ) ) != length )
+    {
+    PyErr_Format( PyExc_ValueError, "The %s must have %d elements.", name, static_cast< int >( length ) );
+    Py_DECREF( seq );
+    return false;
+    }
+
+  values.resize( length );
+  for( size_t i = 0; i < length; ++i )
+    {
+    const long value = PyInt_AsLong( PySequence_Fast_GET_ITEM( seq, i ) );
+    if( value == -1 && PyErr_Occurred() )
       {
-      PyErr_SetString( PyExc_RuntimeError, "Unknown image dimension." );
-      goto fail;
+      Py_DECREF( seq );
+      return false;
       }
-    pixelSize  = sizeof( uint8_t );
-    break;
-  case sitk::ConditionalValue< sitk::sitkVectorInt8 != sitk::sitkUnknown, sitk::sitkVectorInt8, -15 >::Value:
-      if(dimension == 2)
+    if( value < 0 )
       {
-       sitkSetReferenceCountOfVectorImage<int8_t, 2>(sitkImage, bIncreaseRefCntOfitkImage);
+      PyErr_Format( PyExc_ValueError, "The %s must not be negative.", name );
+      Py_DECREF( seq );
+      return false;
       }
-    else if (dimension == 3)
+    values[i] = static_cast< unsigned int >( value );
+    }
+  Py_DECREF( seq );
+  return true;
+}
+
+/** Checks that the region is inside of the image. On failure a python
+ * exception is set.
+ */
+static bool
+sitk_CheckRegion( const std::vector< unsigned int > &imageSize,
+                  const std::vector< unsigned int > &regionIndex,
+                  const std::vector< unsigned int > &regionSize )
+{
+  for( size_t d = 0; d < imageSize.size(); ++d )
+    {
+    if( size_t( regionIndex[d] ) + regionSize[d] > imageSize[d] )
       {
-      sitkSetReferenceCountOfVectorImage<int8_t, 3>(sitkImage, bIncreaseRefCntOfitkImage);
+      PyErr_SetString( PyExc_IndexError, "The region is outside of the image." );
+      return false;
       }
-    else
+    }
+  return true;
+}
+
+/** An internal function that performs a deep copy of a region of the
+ * image buffer into a new NumPy array. Only the rows of the region are
+ * read from the image.
+ */
+static PyObject *
+sitk_GetArrayFromImageRegion( PyObject *SWIGUNUSEDPARM(self), PyObject *args )
+{
+  PyObject *                  pyImage;
+  PyObject *                  pyIndex;
+  PyObject *                  pySize;
+  void *                      voidImage;
+  sitk::Image *               sitkImage;
+  int                         res           = 0;
+  const sitk::PixelIDDispatchEntry * entry;
+
+  std::vector< unsigned int > imageSize;
+  std::vector< unsigned int > regionIndex;
+  std::vector< unsigned int > regionSize;
+  npy_intp                    dims[SITK_MAX_DIMENSION + 1];
+  int                         nd            = 0;
+  unsigned int                numberOfComponents;
+  char *                      imageBuffer;
+  PyArrayObject *             array;
+
+  if( !PyArg_ParseTuple( args, "OOO", &pyImage, &pyIndex, &pySize ) )
+    {
+    SWIG_fail;
+    }
+  res = SWIG_ConvertPtr( pyImage, &voidImage, SWIGTYPE_p_itk__simple__Image, 0 );
+  if( !SWIG_IsOK( res ) )
+    {
+    SWIG_exception_fail(SWIG_ArgError(res), "in method 'GetArrayFromImageRegion', argument needs to be of type 'sitk::Image *'");
+    }
+  sitkImage = reinterpret_cast< sitk::Image * >( voidImage );
+
+  entry = sitk_GetPixelIDDispatchEntry( sitkImage->GetPixelIDValue(), sitkImage->GetDimension() );
+  if( !entry )
+    {
+    SWIG_fail;
+    }
+
+  imageSize = sitkImage->GetSize();
+  if( !sitk_ParseUnsignedSequence( pyIndex, imageSize.size(), regionIndex, "index" )
+      || !sitk_ParseUnsignedSequence( pySize, imageSize.size(), regionSize, "size" )
+      || !sitk_CheckRegion( imageSize, regionIndex, regionSize ) )
+    {
+    SWIG_fail;
+    }
+
+  for( size_t d = regionSize.size(); d > 0; --d )
+    {
+    dims[nd++] = regionSize[d-1];
+    }
+  numberOfComponents = sitkImage->GetNumberOfComponentsPerPixel();
+  if( numberOfComponents > 1 )
+    {
+    dims[nd++] = numberOfComponents;
+    }
+
+  array = sitk_NewAlignedNumPyArray( sitk_NumPyTypeMap::GetInstance().GetNumPyType( sitkImage->GetPixelIDValue() ), nd, dims );
+  if( !array )
+    {
+    SWIG_fail;
+    }
+  // the region is only read, the buffer is not made unique
+  imageBuffer = const_cast< char * >( static_cast< const char * >( entry->GetConstBuffer( *sitkImage ) ) );
+
+  Py_BEGIN_ALLOW_THREADS
+  sitk::CopyImageRegion( imageBuffer, imageSize, regionIndex, regionSize,
+                         entry->ComponentSize * numberOfComponents,
+                         static_cast< char * >( PyArray_DATA( array ) ), false );
+  Py_END_ALLOW_THREADS
+
+  return reinterpret_cast< PyObject * >( array );
+
+fail:
+  return NULL;
+}
+
+/** An internal function that copies a NumPy array into a region of an
+ * existing image, in place. The array must have the pixel type of the
+ * image and the shape of the region.
+ */
+static PyObject *
+sitk_PasteArrayIntoImage( PyObject *SWIGUNUSEDPARM(self), PyObject *args )
+{
+  PyObject *                  pyImage;
+  PyObject *                  obj;
+  PyObject *                  pyIndex;
+  void *                      voidImage;
+  sitk::Image *               sitkImage;
+  int                         res           = 0;
+  const sitk::PixelIDDispatchEntry * entry;
+
+  std::vector< unsigned int > imageSize;
+  std::vector< unsigned int > regionIndex;
+  std::vector< unsigned int > regionSize;
+  int                         numpyType;
+  int                         nd;
+  unsigned int                numberOfComponents;
+  char *                      imageBuffer;
+  PyArrayObject *             array         = NULL;
+
+  if( !PyArg_ParseTuple( args, "OOO", &pyImage, &obj, &pyIndex ) )
+    {
+    SWIG_fail;
+    }
+  res = SWIG_ConvertPtr( pyImage, &voidImage, SWIGTYPE_p_itk__simple__Image, 0 );
+  if( !SWIG_IsOK( res ) )
+    {
+    SWIG_exception_fail(SWIG_ArgError(res), "in method 'PasteArrayIntoImage', argument needs to be of type 'sitk::Image *'");
+    }
+  sitkImage = reinterpret_cast< sitk::Image * >( voidImage );
+
+  entry = sitk_GetPixelIDDispatchEntry( sitkImage->GetPixelIDValue(), sitkImage->GetDimension() );
+  if( !entry )
+    {
+    SWIG_fail;
+    }
+
+  numpyType = sitk_NumPyTypeMap::GetInstance().GetNumPyType( sitkImage->GetPixelIDValue() );
+  if( !PyArray_Check( obj )
+      || !PyArray_EquivTypenums( PyArray_TYPE( reinterpret_cast< PyArrayObject * >( obj ) ), numpyType ) )
+    {
+    PyErr_SetString( PyExc_TypeError, "The array must be a numpy.ndarray of the pixel type of the image." );
+    SWIG_fail;
+    }
+  array = reinterpret_cast< PyArrayObject * >(
+    PyArray_FromArray( reinterpret_cast< PyArrayObject * >( obj ), PyArray_DescrFromType( numpyType ), NPY_ARRAY_CARRAY_RO ) );
+  if( !array )
+    {
+    SWIG_fail;
+    }
+
+  // the region size is the reversed shape of the array
+  imageSize          = sitkImage->GetSize();
+  numberOfComponents = sitkImage->GetNumberOfComponentsPerPixel();
+  nd                 = PyArray_NDIM( array );
+  if( nd != static_cast< int >( imageSize.size() + ( numberOfComponents > 1 ? 1 : 0 ) )
+      || ( numberOfComponents > 1 && PyArray_DIM( array, nd-1 ) != static_cast< npy_intp >( numberOfComponents ) ) )
+    {
+    PyErr_SetString( PyExc_ValueError, "The shape of the array does not match the dimension of the image." );
+    SWIG_fail;
+    }
+  for( size_t d = imageSize.size(); d > 0; --d )
+    {
+    regionSize.push_back( static_cast< unsigned int >( PyArray_DIM( array, d-1 ) ) );
+    }
+
+  if( !sitk_ParseUnsignedSequence( pyIndex, imageSize.size(), regionIndex, "index" )
+      || !sitk_CheckRegion( imageSize, regionIndex, regionSize ) )
+    {
+    SWIG_fail;
+    }
+  imageBuffer = static_cast< char * >( entry->GetBuffer( *sitkImage ) );
+
+  Py_BEGIN_ALLOW_THREADS
+  sitk::CopyImageRegion( imageBuffer, imageSize, regionIndex, regionSize,
+                         entry->ComponentSize * numberOfComponents,
+                         static_cast< char * >( PyArray_DATA( array ) ), true );
+  Py_END_ALLOW_THREADS
+
+  Py_DECREF( array );
+  Py_RETURN_NONE;
+
+fail:
+  Py_XDECREF( array );
+  return NULL;
+}
+
+/** An internal function that copies blocks of a regular grid from a
+ * NumPy array copy of an image into the image, in place. The blocks
+ * are given by their index in the grid, with x the fastest.
+ */
+static PyObject *
+sitk_PasteArrayBlocksIntoImage( PyObject *SWIGUNUSEDPARM(self), PyObject *args )
+{
+  PyObject *                  pyImage;
+  PyObject *                  obj;
+  PyObject *                  pyBlocks;
+  PyObject *                  pyBlockSize;
+  void *                      voidImage;
+  sitk::Image *               sitkImage;
+  int                         res           = 0;
+  const sitk::PixelIDDispatchEntry * entry;
+
+  std::vector< unsigned int > imageSize;
+  std::vector< unsigned int > blockSize;
+  size_t                      numberOfBlocks;
+  size_t                      numberOfPixels;
+  unsigned int                numberOfComponents;
+  int                         numpyType;
+  char *                      imageBuffer;
+  PyArrayObject *             array         = NULL;
+  PyArrayObject *             blocks        = NULL;
+
+  if( !PyArg_ParseTuple( args, "OOOO", &pyImage, &obj, &pyBlocks, &pyBlockSize ) )
+    {
+    SWIG_fail;
+    }
+  res = SWIG_ConvertPtr( pyImage, &voidImage, SWIGTYPE_p_itk__simple__Image, 0 );
+  if( !SWIG_IsOK( res ) )
+    {
+    SWIG_exception_fail(SWIG_ArgError(res), "in method 'PasteArrayBlocksIntoImage', argument needs to be of type 'sitk::Image *'");
+    }
+  sitkImage = reinterpret_cast< sitk::Image * >( voidImage );
+
+  entry = sitk_GetPixelIDDispatchEntry( sitkImage->GetPixelIDValue(), sitkImage->GetDimension() );
+  if( !entry )
+    {
+    SWIG_fail;
+    }
+  imageSize          = sitkImage->GetSize();
+  numberOfComponents = sitkImage->GetNumberOfComponentsPerPixel();
+  if( !sitk_ParseUnsignedSequence( pyBlockSize, imageSize.size(), blockSize, "block size" ) )
+    {
+    SWIG_fail;
+    }
+  if( std::find( blockSize.begin(), blockSize.end(), 0u ) != blockSize.end() )
+    {
+    PyErr_SetString( PyExc_ValueError, "The block size must be positive." );
+    SWIG_fail;
+    }
+
+  // the array is a C contiguous copy of the whole image
+  numpyType = sitk_NumPyTypeMap::GetInstance().GetNumPyType( sitkImage->GetPixelIDValue() );
+  if( !PyArray_Check( obj )
+      || !PyArray_EquivTypenums( PyArray_TYPE( reinterpret_cast< PyArrayObject * >( obj ) ), numpyType ) )
+    {
+    PyErr_SetString( PyExc_TypeError, "The array must be a numpy.ndarray of the pixel type of the image." );
+    SWIG_fail;
+    }
+  array = reinterpret_cast< PyArrayObject * >(
+    PyArray_FromArray( reinterpret_cast< PyArrayObject * >( obj ), PyArray_DescrFromType( numpyType ), NPY_ARRAY_CARRAY_RO ) );
+  if( !array )
+    {
+    SWIG_fail;
+    }
+  numberOfPixels = 1;
+  for( size_t d = 0; d < imageSize.size(); ++d )
+    {
+    numberOfPixels *= imageSize[d];
+    }
+  if( static_cast< size_t >( PyArray_SIZE( array ) ) != numberOfPixels * numberOfComponents )
+    {
+    PyErr_SetString( PyExc_ValueError, "The size of the array does not match the image." );
+    SWIG_fail;
+    }
+
+  blocks = reinterpret_cast< PyArrayObject * >(
+    PyArray_FROMANY( pyBlocks, NPY_INTP, 1, 1, NPY_ARRAY_CARRAY_RO ) );
+  if( !blocks )
+    {
+    SWIG_fail;
+    }
+  numberOfBlocks = static_cast< size_t >( PyArray_DIM( blocks, 0 ) );
+
+  {
+  sitk::CopyImageBlocks copy( imageSize, blockSize, entry->ComponentSize * numberOfComponents );
+  const npy_intp *blockData = static_cast< const npy_intp * >( PyArray_DATA( blocks ) );
+  for( size_t b = 0; b < numberOfBlocks; ++b )
+    {
+    if( blockData[b] < 0 || static_cast< size_t >( blockData[b] ) >= copy.GetNumberOfBlocks() )
       {
-      PyErr_SetString( PyExc_RuntimeError, "Unknown image dimension." );
-      goto fail;
+      PyErr_SetString( PyExc_IndexError, "The block is outside of the image." );
+      SWIG_fail;
       }
-    pixelSize  = sizeof( int8_t );
-    break;
-  case sitk::ConditionalValue< sitk::sitkInt8 != sitk::sitkUnknown, sitk::sitkInt8, -3 >::Value:
-    if(dimension == 2)
+    }
+  imageBuffer = static_cast< char * >( entry->GetBuffer( *sitkImage ) );
+
+  Py_BEGIN_ALLOW_THREADS
+  copy.Copy( static_cast< const char * >( PyArray_DATA( array ) ), imageBuffer,
+             reinterpret_cast< const size_t * >( blockData ), numberOfBlocks );
+  Py_END_ALLOW_THREADS
+  }
+
+  Py_DECREF( blocks );
+  Py_DECREF( array );
+  Py_RETURN_NONE;
+
+fail:
+  Py_XDECREF( blocks );
+  Py_XDECREF( array );
+  return NULL;
+}
+
+/** An internal function that returns a list of the levels of a
+ * pyramid of an image as new NumPy arrays. Each level is the previous
+ * one, the first the image, shrunk by the factors, with the first
+ * pixel or the mean of each block. Only the shrunk arrays are
+ * allocated, and all the levels are computed without the GIL.
+ */
+static PyObject *
+sitk_GetDownsampledArraysFromImage( PyObject *SWIGUNUSEDPARM(self), PyObject *args )
+{
+  PyObject *                  pyImage;
+  PyObject *                  pyShrinkFactors;
+  int                         nearest       = 0;
+  int                         numberOfLevels = 1;
+  void *                      voidImage;
+  const sitk::Image *         sitkImage;
+  int                         res           = 0;
+  const sitk::PixelIDDispatchEntry * entry;
+
+  std::vector< unsigned int > imageSize;
+  std::vector< unsigned int > shrinkFactors;
+  std::vector< sitk::DownsampleImage > levels;
+  npy_intp                    dims[SITK_MAX_DIMENSION + 1];
+  int                         nd;
+  unsigned int                numberOfComponents;
+  int                         numpyType;
+  const void *                source;
+  PyObject *                  list          = NULL;
+
+  if( !PyArg_ParseTuple( args, "OOii", &pyImage, &pyShrinkFactors, &nearest, &numberOfLevels ) )
+    {
+    SWIG_fail;
+    }
+  res = SWIG_ConvertPtr( pyImage, &voidImage, SWIGTYPE_p_itk__simple__Image, 0 );
+  if( !SWIG_IsOK( res ) )
+    {
+    SWIG_exception_fail(SWIG_ArgError(res), "in method 'GetDownsampledArraysFromImage', argument needs to be of type 'sitk::Image *'");
+    }
+  sitkImage = reinterpret_cast< sitk::Image * >( voidImage );
+
+  entry = sitk_GetPixelIDDispatchEntry( sitkImage->GetPixelIDValue(), sitkImage->GetDimension() );
+  if( !entry )
+    {
+    SWIG_fail;
+    }
+
+  imageSize = sitkImage->GetSize();
+  if( !sitk_ParseUnsignedSequence( pyShrinkFactors, imageSize.size(), shrinkFactors, "shrink factors" ) )
+    {
+    SWIG_fail;
+    }
+  if( std::find( shrinkFactors.begin(), shrinkFactors.end(), 0u ) != shrinkFactors.end() )
+    {
+    PyErr_SetString( PyExc_ValueError, "The shrink factors must be positive." );
+    SWIG_fail;
+    }
+  if( numberOfLevels < 1 )
+    {
+    PyErr_SetString( PyExc_ValueError, "The number of levels must be positive." );
+    SWIG_fail;
+    }
+
+  numberOfComponents = sitkImage->GetNumberOfComponentsPerPixel();
+  numpyType = sitk_NumPyTypeMap::GetInstance().GetNumPyType( sitkImage->GetPixelIDValue() );
+  list = PyList_New( numberOfLevels );
+  if( !list )
+    {
+    SWIG_fail;
+    }
+
+  // the arrays are allocated before the GIL is released
+  levels.reserve( numberOfLevels );
+  for( int level = 0; level < numberOfLevels; ++level )
+    {
+    levels.push_back( sitk::DownsampleImage( *entry, level == 0 ? imageSize : levels.back().GetOutputSize(),
+                                             numberOfComponents, shrinkFactors, nearest != 0 ) );
+    const std::vector< unsigned int > & size = levels.back().GetOutputSize();
+    nd = 0;
+    for( size_t d = size.size(); d > 0; --d )
       {
-      sitkSetReferenceCountOfScalarImage<int8_t, 2>(sitkImage, bIncreaseRefCntOfitkImage);
+      dims[nd++] = size[d-1];
       }
-    else if (dimension == 3)
+    if( numberOfComponents > 1 )
       {
-      sitkSetReferenceCountOfScalarImage<int8_t, 3>(sitkImage, bIncreaseRefCntOfitkImage);
+      dims[nd++] = numberOfComponents;
       }
-    else
+    PyArrayObject *array = sitk_NewAlignedNumPyArray( numpyType, nd, dims );
+    if( !array )
       {
-      PyErr_SetString( PyExc_RuntimeError, "Unknown image dimension." );
-      goto fail;
+      SWIG_fail;
       }
-    pixelSize  = sizeof( int8_t );
-    break;
-  case sitk::ConditionalValue< sitk::sitkVectorUInt16 != sitk::sitkUnknown, sitk::sitkVectorUInt16, -16 >::Value:
-      if(dimension == 2)
+    PyList_SET_ITEM( list, level, reinterpret_cast< PyObject * >( array ) );
+    }
+  source = entry->GetConstBuffer( *sitkImage );
+
+  Py_BEGIN_ALLOW_THREADS
+  for( int level = 0; level < numberOfLevels; ++level )
+    {
+    void *destination = PyArray_DATA( reinterpret_cast< PyArrayObject * >( PyList_GET_ITEM( list, level ) ) );
+    levels[level].Downsample( source, destination );
+    source = destination;
+    }
+  Py_END_ALLOW_THREADS
+
+  return list;
+
+fail:
+  Py_XDECREF( list );
+  return NULL;
+}
+
+/** Parses the axes of an array, the image axes in the order of the
+ * array axes, with 0 for x and the dimension for the components of a
+ * vector image. Returns the axes of the array and of the image buffer
+ * in memory order, the fastest first. On failure a python exception
+ * is set.
+ */
+static bool
+sitk_ParseAxisOrder( PyObject *pyAxes, unsigned int dimension, bool isVector,
+                     std::vector< unsigned int > &arrayMemoryAxes,
+                     std::vector< unsigned int > &imageMemoryAxes )
+{
+  const unsigned int numberOfAxes = dimension + ( isVector ? 1 : 0 );
+  std::vector< unsigned int > axes;
+  std::vector< bool > found( numberOfAxes, false );
+
+  if( !sitk_ParseUnsignedSequence( pyAxes, numberOfAxes, axes, "axis order" ) )
+    {
+    return false;
+    }
+  for( unsigned int i = 0; i < numberOfAxes; ++i )
+    {
+    if( axes[i] >= numberOfAxes || found[axes[i]] )
       {
-      sitkSetReferenceCountOfVectorImage<uint16_t, 2>(sitkImage, bIncreaseRefCntOfitkImage);
+      PyErr_SetString( PyExc_ValueError, "The axis order is not a permutation of the image axes." );
+      return false;
       }
-    else if (dimension == 3)
-      {
-      sitkSetReferenceCountOfVectorImage<uint16_t, 3>(sitkImage, bIncreaseRefCntOfitkImage);
-      }
-    else
-      {
-      PyErr_SetString( PyExc_RuntimeError, "Unknown image dimension." );
-      goto fail;
-      }
-    pixelSize  = sizeof( uint16_t );
-    break;
-  case sitk::ConditionalValue< sitk::sitkUInt16 != sitk::sitkUnknown, sitk::sitkUInt16, -4 >::Value:
-    if(dimension == 2)
-      {
-      sitkSetReferenceCountOfScalarImage<uint16_t, 2>(sitkImage, bIncreaseRefCntOfitkImage);
-      }
-    else if (dimension == 3)
-      {
-      sitkSetReferenceCountOfScalarImage<uint16_t, 3>(sitkImage, bIncreaseRefCntOfitkImage);
-      }
-    else
-      {
-      PyErr_SetString( PyExc_RuntimeError, "Unknown image dimension." );
-      goto fail;
-      }
-    pixelSize  = sizeof( uint16_t );
-    break;
-  case sitk::ConditionalValue< sitk::sitkVectorInt16 != sitk::sitkUnknown, sitk::sitkVectorInt16, -17 >::Value:
-      if(dimension == 2)
-      {
-      sitkSetReferenceCountOfVectorImage<int16_t, 2>(sitkImage, bIncreaseRefCntOfitkImage);
-      }
-    else if (dimension == 3)
-      {
-      sitkSetReferenceCountOfVectorImage<int16_t, 3>(sitkImage, bIncreaseRefCntOfitkImage);
-      }
-    else
-      {
-      PyErr_SetString( PyExc_RuntimeError, "Unknown image dimension." );
-      goto fail;
-      }
-    pixelSize  = sizeof( int16_t );
-    break;
-  case sitk::ConditionalValue< sitk::sitkInt16 != sitk::sitkUnknown, sitk::sitkInt16, -5 >::Value:
-    if(dimension == 2)
-      {
-      sitkSetReferenceCountOfScalarImage<int16_t, 2>(sitkImage, bIncreaseRefCntOfitkImage);
-      }
-    else if (dimension == 3)
-      {
-      sitkSetReferenceCountOfScalarImage<int16_t, 3>(sitkImage, bIncreaseRefCntOfitkImage);
-      }
-    else
-      {
-      PyErr_SetString( PyExc_RuntimeError, "Unknown image dimension." );
-      goto fail;
-      }
-    pixelSize  = sizeof( int16_t );
-    break;
-  case sitk::ConditionalValue< sitk::sitkVectorUInt32 != sitk::sitkUnknown, sitk::sitkVectorUInt32, -18 >::Value:
-      if(dimension == 2)
-      {
-      sitkSetReferenceCountOfVectorImage<uint32_t, 2>(sitkImage, bIncreaseRefCntOfitkImage);
-      }
-    else if (dimension == 3)
-      {
-      sitkSetReferenceCountOfVectorImage<uint32_t, 3>(sitkImage, bIncreaseRefCntOfitkImage);
-      }
-    else
-      {
-      PyErr_SetString( PyExc_RuntimeError, "Unknown image dimension." );
-      goto fail;
-      }
-    pixelSize  = sizeof( uint32_t );
-    break;
-  case sitk::ConditionalValue< sitk::sitkUInt32 != sitk::sitkUnknown, sitk::sitkUInt32, -6 >::Value:
-    if(dimension == 2)
-      {
-      sitkSetReferenceCountOfScalarImage<uint32_t, 2>(sitkImage, bIncreaseRefCntOfitkImage);
-      }
-    else if (dimension == 3)
-      {
-      sitkSetReferenceCountOfScalarImage<uint32_t, 3>(sitkImage, bIncreaseRefCntOfitkImage);
-      }
-    else
-      {
-      PyErr_SetString( PyExc_RuntimeError, "Unknown image dimension." );
-      goto fail;
-      }
-    pixelSize  = sizeof( uint32_t );
-    break;
-  case sitk::ConditionalValue< sitk::sitkVectorInt32 != sitk::sitkUnknown, sitk::sitkVectorInt32, -19 >::Value:
-      if(dimension == 2)
-      {
-      sitkSetReferenceCountOfVectorImage<int32_t, 2>(sitkImage, bIncreaseRefCntOfitkImage);
-      }
-    else if (dimension == 3)
-      {
-      sitkSetReferenceCountOfVectorImage<int32_t, 3>(sitkImage, bIncreaseRefCntOfitkImage);
-      }
-    else
-      {
-      PyErr_SetString( PyExc_RuntimeError, "Unknown image dimension." );
-      goto fail;
-      }
-    pixelSize  = sizeof( int32_t );
-    break;
-  case sitk::ConditionalValue< sitk::sitkInt32 != sitk::sitkUnknown, sitk::sitkInt32, -7 >::Value:
-    if(dimension == 2)
-      {
-      sitkSetReferenceCountOfScalarImage<int32_t, 2>(sitkImage, bIncreaseRefCntOfitkImage);
-      }
-    else if (dimension == 3)
-      {
-      sitkSetReferenceCountOfScalarImage<int32_t, 3>(sitkImage, bIncreaseRefCntOfitkImage);
-      }
-    else
-      {
-      PyErr_SetString( PyExc_RuntimeError, "Unknown image dimension." );
-      goto fail;
-      }
-    pixelSize  = sizeof( int32_t );
-    break;
-  case sitk::ConditionalValue< sitk::sitkVectorUInt64 != sitk::sitkUnknown, sitk::sitkVectorUInt64, -20 >::Value:
-      if(dimension == 2)
-      {
-      sitkSetReferenceCountOfVectorImage<uint64_t, 2>(sitkImage, bIncreaseRefCntOfitkImage);
-      }
-    else if (dimension == 3)
-      {
-      sitkSetReferenceCountOfVectorImage<uint64_t, 3>(sitkImage, bIncreaseRefCntOfitkImage);
-      }
-    else
-      {
-      PyErr_SetString( PyExc_RuntimeError, "Unknown image dimension." );
-      goto fail;
-      }
-    pixelSize  = sizeof( uint64_t );
-    break;
-  case sitk::ConditionalValue< sitk::sitkUInt64 != sitk::sitkUnknown, sitk::sitkUInt64, -8 >::Value:
-    if(dimension == 2)
-      {
-      sitkSetReferenceCountOfScalarImage<uint64_t, 2>(sitkImage, bIncreaseRefCntOfitkImage);
-      }
-    else if (dimension == 3)
-      {
-      sitkSetReferenceCountOfScalarImage<uint64_t, 3>(sitkImage, bIncreaseRefCntOfitkImage);
-      }
-    else
-      {
-      PyErr_SetString( PyExc_RuntimeError, "Unknown image dimension." );
-      goto fail;
-      }
-    pixelSize  = sizeof( uint64_t );
-    break;
-  case sitk::ConditionalValue< sitk::sitkVectorInt64 != sitk::sitkUnknown, sitk::sitkVectorInt64, -21 >::Value:
-      if(dimension == 2)
-      {
-      sitkSetReferenceCountOfVectorImage<int64_t, 2>(sitkImage, bIncreaseRefCntOfitkImage);
-      }
-    else if (dimension == 3)
-      {
-      sitkSetReferenceCountOfVectorImage<int64_t, 3>(sitkImage, bIncreaseRefCntOfitkImage);
-      }
-    else
-      {
-      PyErr_SetString( PyExc_RuntimeError, "Unknown image dimension." );
-      goto fail;
-      }
-    pixelSize  = sizeof( int64_t );
-    break;
-  case sitk::ConditionalValue< sitk::sitkInt64 != sitk::sitkUnknown, sitk::sitkInt64, -9 >::Value:
-     if(dimension == 2)
-      {
-      sitkSetReferenceCountOfScalarImage<int64_t, 2>(sitkImage, bIncreaseRefCntOfitkImage);
-      }
-    else if (dimension == 3)
-      {
-      sitkSetReferenceCountOfScalarImage<int64_t, 3>(sitkImage, bIncreaseRefCntOfitkImage);
-      }
-    else
-      {
-      PyErr_SetString( PyExc_RuntimeError, "Unknown image dimension." );
-      goto fail;
-      }
-    pixelSize  = sizeof( int64_t );
-    break;
-  case sitk::ConditionalValue< sitk::sitkVectorFloat32 != sitk::sitkUnknown, sitk::sitkVectorFloat32, -22 >::Value:
-      if(dimension == 2)
-      {
-      sitkSetReferenceCountOfVectorImage<float, 2>(sitkImage, bIncreaseRefCntOfitkImage);
-      }
-    else if (dimension == 3)
-      {
-      sitkSetReferenceCountOfVectorImage<float, 3>(sitkImage, bIncreaseRefCntOfitkImage);
-      }
-    else
-      {
-      PyErr_SetString( PyExc_RuntimeError, "Unknown image dimension." );
-      goto fail;
-      }
-    pixelSize  = sizeof( float );
-    break;
-  case sitk::ConditionalValue< sitk::sitkFloat32 != sitk::sitkUnknown, sitk::sitkFloat32, -10 >::Value:
-    if(dimension == 2)
-      {
-      sitkSetReferenceCountOfScalarImage<float, 2>(sitkImage, bIncreaseRefCntOfitkImage);
-      }
-    else if (dimension == 3)
-      {
-      sitkSetReferenceCountOfScalarImage<float, 3>(sitkImage, bIncreaseRefCntOfitkImage);
-      }
-    else
-      {
-      PyErr_SetString( PyExc_RuntimeError, "Unknown image dimension." );
-      goto fail;
-      }
-    pixelSize  = sizeof( float );
-    break;
-  case sitk::ConditionalValue< sitk::sitkVectorFloat64 != sitk::sitkUnknown, sitk::sitkVectorFloat64, -23 >::Value:
-      if(dimension == 2)
-      {
-      sitkSetReferenceCountOfVectorImage<double, 2>(sitkImage, bIncreaseRefCntOfitkImage);
-      }
-    else if (dimension == 3)
-      {
-      sitkSetReferenceCountOfVectorImage<double, 3>(sitkImage, bIncreaseRefCntOfitkImage);
-      }
-    else
-      {
-      PyErr_SetString( PyExc_RuntimeError, "Unknown image dimension." );
-      goto fail;
-      }
-    pixelSize  = sizeof( double );
-    break;
-  case sitk::ConditionalValue< sitk::sitkFloat64 != sitk::sitkUnknown, sitk::sitkFloat64, -11 >::Value:
-    if(dimension == 2)
-      {
-      sitkSetReferenceCountOfScalarImage<double, 2>(sitkImage, bIncreaseRefCntOfitkImage);
-      }
-    else if (dimension == 3)
+    found[axes[i]] = true;
+    }
+
+  arrayMemoryAxes.assign( axes.rbegin(), axes.rend() );
+  imageMemoryAxes.clear();
+  if( isVector )
+    {
+    imageMemoryAxes.push_back( dimension );
+    }
+  for( unsigned int d = 0; d < dimension; ++d )
+    {
+    imageMemoryAxes.push_back( d );
+    }
+  return true;
+}
+
+/** Returns the permutation of a copy between buffers with the axes in
+ * the memory order of the source and the destination. */
+static std::vector< unsigned int >
+sitk_GetAxisPermutation( const std::vector< unsigned int > &sourceAxes,
+                         const std::vector< unsigned int > &destinationAxes )
+{
+  std::vector< unsigned int > permutation( destinationAxes.size() );
+  for( size_t k = 0; k < destinationAxes.size(); ++k )
+    {
+    permutation[k] = static_cast< unsigned int >(
+      std::find( sourceAxes.begin(), sourceAxes.end(), destinationAxes[k] ) - sourceAxes.begin() );
+    }
+  return permutation;
+}
+
+/** Copies a buffer of components into a buffer with permuted axes,
+ * without the GIL. If the statistics are requested they are computed
+ * from the tiles of the copy, in the same pass. Returns false if the
+ * pixel type can not be reordered. */
+static bool
+sitk_PermuteAxesWithStatistics( const sitk::PixelIDDispatchEntry &entry, const void *source, void *destination,
+                                const std::vector< size_t > &size, const std::vector< unsigned int > &permutation,
+                                PyObject *pyStatistics, sitk::ConversionStatistics &statistics )
+{
+  sitk::ConversionStatisticsReducer reducer( entry, statistics );
+  sitk::ConversionStatisticsReducer *statisticsReducer = sitk_IsStatisticsRequested( pyStatistics ) ? &reducer : NULL;
+  bool                               permuted;
+
+  Py_BEGIN_ALLOW_THREADS
+  permuted = sitk::PermuteAxes( source, destination, entry.ComponentSize, size, permutation, statisticsReducer );
+  Py_END_ALLOW_THREADS
+  return permuted;
+}
+
+/** An internal function that copies an image into a new NumPy array
+ * with the axes in the given order, with a cache blocked transpose of
+ * the image buffer.
+ */
+static PyObject *
+sitk_GetArrayFromImageWithAxisOrder( PyObject *SWIGUNUSEDPARM(self), PyObject *args )
+{
+  PyObject *                  pyImage;
+  PyObject *                  pyAxes;
+  PyObject *                  pyStatistics  = NULL;
+  void *                      voidImage;
+  int                         res           = 0;
+  const sitk::Image *         sitkImage;
+  PyArrayObject *             array         = NULL;
+  const void *                sitkBufferPtr;
+  npy_intp                    dims[SITK_MAX_DIMENSION + 1];
+  std::vector< size_t >       axisSize;
+  std::vector< size_t >       imageMemorySize;
+  std::vector< unsigned int > size;
+  std::vector< unsigned int > arrayMemoryAxes;
+  std::vector< unsigned int > imageMemoryAxes;
+  std::vector< unsigned int > permutation;
+  unsigned int                dimension;
+  const sitk::PixelIDDispatchEntry * entry;
+  sitk::ConversionStatistics  statistics;
+
+  if( !PyArg_ParseTuple( args, "OO|O", &pyImage, &pyAxes, &pyStatistics ) )
+    {
+    SWIG_fail;
+    }
+  res = SWIG_ConvertPtr( pyImage, &voidImage, SWIGTYPE_p_itk__simple__Image, 0 );
+  if( !SWIG_IsOK( res ) )
+    {
+    SWIG_exception_fail(SWIG_ArgError(res), "in method 'GetArrayFromImageWithAxisOrder', argument needs to be of type 'sitk::Image *'");
+    }
+  sitkImage = reinterpret_cast< sitk::Image * >( voidImage );
+  dimension = sitkImage->GetDimension();
+  size      = sitkImage->GetSize();
+
+  entry = sitk_GetPixelIDDispatchEntry( sitkImage->GetPixelIDValue(), dimension );
+  if( !entry
+      || !sitk_ParseStatisticsRequest( pyStatistics, statistics )
+      || !sitk_ParseAxisOrder( pyAxes, dimension, sitkImage->GetNumberOfComponentsPerPixel() > 1,
+                               arrayMemoryAxes, imageMemoryAxes ) )
+    {
+    SWIG_fail;
+    }
+
+  axisSize.assign( size.begin(), size.end() );
+  axisSize.push_back( sitkImage->GetNumberOfComponentsPerPixel() );
+  for( size_t k = 0; k < imageMemoryAxes.size(); ++k )
+    {
+    imageMemorySize.push_back( axisSize[imageMemoryAxes[k]] );
+    // the array shape is the reverse of the memory order
+    dims[arrayMemoryAxes.size() - 1 - k] = static_cast< npy_intp >( axisSize[arrayMemoryAxes[k]] );
+    }
+  permutation = sitk_GetAxisPermutation( imageMemoryAxes, arrayMemoryAxes );
+
+  array = sitk_NewAlignedNumPyArray( sitk_NumPyTypeMap::GetInstance().GetNumPyType( sitkImage->GetPixelIDValue() ),
+                                     static_cast< int >( arrayMemoryAxes.size() ), dims );
+  if( !array )
+    {
+    SWIG_fail;
+    }
+  sitkBufferPtr = entry->GetConstBuffer( *sitkImage );
+
+  if( !sitk_PermuteAxesWithStatistics( *entry, sitkBufferPtr, PyArray_DATA( array ), imageMemorySize, permutation,
+                                       pyStatistics, statistics ) )
+    {
+    PyErr_SetString( PyExc_TypeError, "The pixel type can not be reordered." );
+    SWIG_fail;
+    }
+
+  return sitk_ReturnWithStatistics( reinterpret_cast< PyObject * >( array ), pyStatistics, statistics );
+
+fail:
+  Py_XDECREF( array );
+  return NULL;
+}
+
+/** An internal function that copies a NumPy array, with the image axes
+ * in the given order, into a new image, with a cache blocked transpose
+ * of the array.
+ */
+static PyObject *
+sitk_SetImageFromArrayWithAxisOrder( PyObject *SWIGUNUSEDPARM(self), PyObject *args )
+{
+  PyObject *                  pyArray;
+  PyObject *                  pyAxes;
+  PyObject *                  pyStatistics  = NULL;
+  PyArrayObject *             array         = NULL;
+  int                         pixelID       = 0;
+  int                         isVector      = 0;
+  sitk::Image *               sitkImage     = NULL;
+  void *                      sitkBufferPtr = NULL;
+  std::vector< size_t >       axisSize;
+  std::vector< size_t >       arrayMemorySize;
+  std::vector< unsigned int > size;
+  std::vector< unsigned int > arrayMemoryAxes;
+  std::vector< unsigned int > imageMemoryAxes;
+  std::vector< unsigned int > permutation;
+  unsigned int                dimension;
+  unsigned int                numberOfComponents = 1;
+  int                         numpyType;
+  const sitk::PixelIDDispatchEntry * entry;
+  sitk::ConversionStatistics  statistics;
+
+  if( !PyArg_ParseTuple( args, "OOii|O", &pyArray, &pyAxes, &pixelID, &isVector, &pyStatistics ) )
+    {
+    SWIG_fail;
+    }
+  numpyType = sitk_NumPyTypeMap::GetInstance().GetNumPyType( pixelID );
+  if( numpyType < 0 )
+    {
+    PyErr_SetString( PyExc_TypeError, "The pixel type is not supported." );
+    SWIG_fail;
+    }
+  // a C contiguous array of the component type in the native byte order,
+  // the values of other types are converted if the cast is safe
+  array = reinterpret_cast< PyArrayObject * >( PyArray_FROM_OTF( pyArray, numpyType, NPY_ARRAY_CARRAY_RO ) );
+  if( !array )
+    {
+    SWIG_fail;
+    }
+  if( PyArray_NDIM( array ) < 1 + ( isVector ? 1 : 0 ) )
+    {
+    PyErr_SetString( PyExc_ValueError, "The array has too few dimensions." );
+    SWIG_fail;
+    }
+  dimension = static_cast< unsigned int >( PyArray_NDIM( array ) ) - ( isVector ? 1 : 0 );
+
+  entry = sitk_GetPixelIDDispatchEntry( pixelID, dimension );
+  if( !entry
+      || !sitk_ParseStatisticsRequest( pyStatistics, statistics )
+      || !sitk_ParseAxisOrder( pyAxes, dimension, isVector != 0, arrayMemoryAxes, imageMemoryAxes ) )
+    {
+    SWIG_fail;
+    }
+
+  axisSize.resize( dimension + 1, 1 );
+  for( size_t k = 0; k < arrayMemoryAxes.size(); ++k )
+    {
+    arrayMemorySize.push_back( static_cast< size_t >( PyArray_DIM( array, PyArray_NDIM( array ) - 1 - k ) ) );
+    axisSize[arrayMemoryAxes[k]] = arrayMemorySize.back();
+    }
+  size.assign( axisSize.begin(), axisSize.begin() + dimension );
+  numberOfComponents = static_cast< unsigned int >( axisSize[dimension] );
+  permutation = sitk_GetAxisPermutation( arrayMemoryAxes, imageMemoryAxes );
+
+  try
+    {
+    if( isVector )
       {
-      sitkSetReferenceCountOfScalarImage<double, 3>(sitkImage, bIncreaseRefCntOfitkImage);
+      sitkImage = new sitk::Image( size, static_cast< sitk::PixelIDValueEnum >( pixelID ), numberOfComponents );
       }
     else
       {
-      PyErr_SetString( PyExc_RuntimeError, "Unknown image dimension." );
-      goto fail;
+      sitkImage = new sitk::Image( size, static_cast< sitk::PixelIDValueEnum >( pixelID ) );
       }
-    pixelSize  = sizeof( double );
-    break;
-  case sitk::ConditionalValue< sitk::sitkComplexFloat32 != sitk::sitkUnknown, sitk::sitkComplexFloat32, -12 >::Value:
-  case sitk::ConditionalValue< sitk::sitkComplexFloat64 != sitk::sitkUnknown, sitk::sitkComplexFloat64, -13 >::Value:
-    PyErr_SetString( PyExc_RuntimeError, "Images of Complex Pixel types currently are not supported." );
+    sitkBufferPtr = entry->GetBuffer( *sitkImage );
+    }
+  catch( const std::exception &e )
+    {
+    std::string msg = "Exception thrown in SimpleITK new Image: ";
+    msg += e.what();
+    PyErr_SetString( PyExc_RuntimeError, msg.c_str() );
     SWIG_fail;
-    break;
-  default:
-    PyErr_SetString( PyExc_RuntimeError, "Unknown pixel type." );
+    }
+
+  if( !sitk_PermuteAxesWithStatistics( *entry, PyArray_DATA( array ), sitkBufferPtr, arrayMemorySize, permutation,
+                                       pyStatistics, statistics ) )
+    {
+    PyErr_SetString( PyExc_TypeError, "The pixel type can not be reordered." );
     SWIG_fail;
     }
 
-  Py_RETURN_NONE;
+  Py_DECREF( array );
+  return sitk_ReturnWithStatistics( SWIG_NewPointerObj( sitkImage, SWIGTYPE_p_itk__simple__Image, SWIG_POINTER_OWN | 0 ),
+                                    pyStatistics, statistics );
+
+fail:
+  delete sitkImage;
+  Py_XDECREF( array );
+  return NULL;
+}
+
+/** The fast path of GetArrayFromImage. The NumPy array is created with
+ * its final shape and type and the pixels are copied into it, without
+ * any processing in python.
+ */
+static PyObject *
+sitk_GetArrayFromImageFastImpl( PyObject *pyImage )
+{
+  void *                      voidImage;
+  sitk::Image *               sitkImage;
+  int                         res           = 0;
+  const sitk::PixelIDDispatchEntry * entry;
+
+  std::vector< unsigned int > size;
+  npy_intp                    dims[SITK_MAX_DIMENSION + 1];
+  int                         nd            = 0;
+  int                         numpyType;
+  unsigned int                numberOfComponents;
+  PyArrayObject *             array;
+
+  res = SWIG_ConvertPtr( pyImage, &voidImage, SWIGTYPE_p_itk__simple__Image, 0 );
+  if( !SWIG_IsOK( res ) )
+    {
+    SWIG_exception_fail(SWIG_ArgError(res), "in method 'GetArrayFromImageFast', argument needs to be of type 'sitk::Image *'");
+    }
+  sitkImage = reinterpret_cast< sitk::Image * >( voidImage );
+
+  entry = sitk_GetPixelIDDispatchEntry( sitkImage->GetPixelIDValue(), sitkImage->GetDimension() );
+  if( !entry )
+    {
+    SWIG_fail;
+    }
+  numpyType = sitk_NumPyTypeMap::GetInstance().GetNumPyType( sitkImage->GetPixelIDValue() );
+
+  // the array is indexed in the reverse order of the image
+  size = sitkImage->GetSize();
+  for( size_t d = size.size(); d > 0; --d )
+    {
+    dims[nd++] = size[d-1];
+    }
+  numberOfComponents = sitkImage->GetNumberOfComponentsPerPixel();
+  if( numberOfComponents > 1 )
+    {
+    dims[nd++] = numberOfComponents;
+    }
+
+  // aligned as the arrays of GetArrayFromImage, the image is only read
+  array = sitk_NewAlignedNumPyArray( numpyType, nd, dims );
+  if( !array )
+    {
+    SWIG_fail;
+    }
+  memcpy( PyArray_DATA( array ), entry->GetConstBuffer( *sitkImage ), PyArray_NBYTES( array ) );
+  return reinterpret_cast< PyObject * >( array );
 
 fail:
   return NULL;
+}
 
+/** The fast path of GetImageFromArray. The array is copied into a new
+ * image without any processing in python. As in GetImageFromArray, a
+ * 4D array or a 3D array with isVector set is a vector image.
+ */
+static PyObject *
+sitk_GetImageFromArrayFastImpl( PyObject *obj, int isVector )
+{
+  PyArrayObject *             array         = NULL;
+  sitk::Image *               sitkImage     = NULL;
+  const sitk::PixelIDDispatchEntry * entry;
+
+  std::vector< unsigned int > size;
+  int                         nd;
+  int                         pixelID;
+  unsigned int                dimension;
+  unsigned int                numberOfComponents = 1;
+
+  if( !PyArray_Check( obj ) )
+    {
+    PyErr_SetString( PyExc_TypeError, "in method 'GetImageFromArrayFast', argument needs to be of type 'numpy.ndarray'" );
+    return NULL;
+    }
+
+  nd = PyArray_NDIM( reinterpret_cast< PyArrayObject * >( obj ) );
+  if( nd < 2 || nd > 4 )
+    {
+    PyErr_SetString( PyExc_RuntimeError, "Only arrays of 2, 3 or 4 dimensions are supported." );
+    return NULL;
+    }
+  isVector = ( nd == 3 && isVector ) || nd == 4;
+
+  pixelID = sitk_NumPyTypeMap::GetInstance().GetPixelID( PyArray_TYPE( reinterpret_cast< PyArrayObject * >( obj ) ), isVector );
+  if( pixelID == sitk::sitkUnknown )
+    {
+    PyErr_SetString( PyExc_TypeError, "Unsupported array type." );
+    return NULL;
+    }
+
+  // a C contiguous array in the native byte order, usually the argument itself
+  array = reinterpret_cast< PyArrayObject * >(
+    PyArray_FromArray( reinterpret_cast< PyArrayObject * >( obj ),
+                       PyArray_DescrFromType( PyArray_TYPE( reinterpret_cast< PyArrayObject * >( obj ) ) ),
+                       NPY_ARRAY_CARRAY_RO ) );
+  if( !array )
+    {
+    return NULL;
+    }
+
+  dimension = isVector ? nd - 1 : nd;
+  for( unsigned int d = dimension; d > 0; --d )
+    {
+    size.push_back( static_cast< unsigned int >( PyArray_DIM( array, d-1 ) ) );
+    }
+  if( isVector )
+    {
+    numberOfComponents = static_cast< unsigned int >( PyArray_DIM( array, nd-1 ) );
+    }
+
+  entry = sitk_GetPixelIDDispatchEntry( pixelID, dimension );
+  if( !entry )
+    {
+    goto fail;
+    }
+
+  try
+    {
+    sitkImage = new sitk::Image( size, static_cast< sitk::PixelIDValueEnum >( pixelID ), numberOfComponents );
+    memcpy( entry->GetBuffer( *sitkImage ), PyArray_DATA( array ), PyArray_NBYTES( array ) );
+    }
+  catch( const std::exception &e )
+    {
+    std::string msg = "Exception thrown in SimpleITK new Image: ";
+    msg += e.what();
+    PyErr_SetString( PyExc_RuntimeError, msg.c_str() );
+    goto fail;
+    }
+
+  Py_DECREF( array );
+  return SWIG_NewPointerObj( sitkImage, SWIGTYPE_p_itk__simple__Image, SWIG_POINTER_OWN | 0 );
+
+fail:
+  delete sitkImage;
+  Py_XDECREF( array );
+  return NULL;
+}
+
+// The fast path functions use the vectorcall convention where available
+// to avoid building and parsing an argument tuple.
+#if PY_VERSION_HEX >= 0x03070000
+#define SITK_METH_FASTCALL METH_FASTCALL
+
+static PyObject *
+sitk_GetArrayFromImageFast( PyObject *SWIGUNUSEDPARM(self), PyObject *const *args, Py_ssize_t nargs )
+{
+  if( nargs != 1 )
+    {
+    PyErr_SetString( PyExc_TypeError, "GetArrayFromImageFast takes exactly one argument." );
+    return NULL;
+    }
+  return sitk_GetArrayFromImageFastImpl( args[0] );
+}
+
+static PyObject *
+sitk_GetImageFromArrayFast( PyObject *SWIGUNUSEDPARM(self), PyObject *const *args, Py_ssize_t nargs )
+{
+  int isVector = 0;
+  if( nargs < 1 || nargs > 2 )
+    {
+    PyErr_SetString( PyExc_TypeError, "GetImageFromArrayFast takes one or two arguments." );
+    return NULL;
+    }
+  if( nargs == 2 && ( isVector = PyObject_IsTrue( args[1] ) ) < 0 )
+    {
+    return NULL;
+    }
+  return sitk_GetImageFromArrayFastImpl( args[0], isVector );
+}
+
+#else
+#define SITK_METH_FASTCALL METH_VARARGS
+
+static PyObject *
+sitk_GetArrayFromImageFast( PyObject *SWIGUNUSEDPARM(self), PyObject *args )
+{
+  PyObject *pyImage;
+  if( !PyArg_ParseTuple( args, "O", &pyImage ) )
+    {
+    return NULL;
+    }
+  return sitk_GetArrayFromImageFastImpl( pyImage );
+}
+
+static PyObject *
+sitk_GetImageFromArrayFast( PyObject *SWIGUNUSEDPARM(self), PyObject *args )
+{
+  PyObject *obj;
+  int isVector = 0;
+  if( !PyArg_ParseTuple( args, "O|i", &obj, &isVector ) )
+    {
+    return NULL;
+    }
+  return sitk_GetImageFromArrayFastImpl( obj, isVector );
+}
+#endif
+
+static PyMethodDef sitk_FastConversionMethods[] = {
+  { "_GetArrayFromImageFast", (PyCFunction)(void(*)(void))sitk_GetArrayFromImageFast, SITK_METH_FASTCALL,
+    "GetArrayFromImageFast(image) -> numpy.ndarray\n\nCopy a SimpleITK Image into a new NumPy array." },
+  { "_GetImageFromArrayFast", (PyCFunction)(void(*)(void))sitk_GetImageFromArrayFast, SITK_METH_FASTCALL,
+    "GetImageFromArrayFast(array, isVector=False) -> Image\n\nCopy a NumPy array into a new SimpleITK Image." },
+  { NULL, NULL, 0, NULL }
+};
+
+/** Adds the functions which are not wrapped by SWIG, because they use
+ * a different calling convention, to the module dictionary.
+ */
+static int
+sitk_AddFastConversionFunctions( PyObject *moduleDict )
+{
+  for( PyMethodDef *def = sitk_FastConversionMethods; def->ml_name; ++def )
+    {
+    PyObject *function = PyCFunction_New( def, NULL );
+    if( !function || PyDict_SetItemString( moduleDict, def->ml_name, function ) < 0 )
+      {
+      Py_XDECREF( function );
+      return -1;
+      }
+    Py_DECREF( function );
+    }
+  return 0;
 }
 
 #ifdef __cplusplus
@@ -0,0 +1,393 @@
+/*=========================================================================
+*
+*  Copyright Insight Software Consortium
+*
+*  Licensed under the Apache License, Version 2.0 (the "License");
+*  you may not use this file except in compliance with the License.
+*  You may obtain a copy of the License at
+*
+*         http://www.apache.org/licenses/LICENSE-2.0.txt
+*
+*  Unless required by applicable law or agreed to in writing, software
+*  distributed under the License is distributed on an "AS IS" BASIS,
+*  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+*  See the License for the specific language governing permissions and
+*  limitations under the License.
+*
+*=========================================================================*/
+
+// Micro-benchmark of the raw conversion kernels of the NumPy bridge.
+//
+// The kernels of the PixelIDDispatchTable are timed without the Python
+// layer for every pixel type, dimension, size, copy or view mode and
+// number of concurrent callers. The results are written as JSON and
+// compared against a baseline by sitkNumpyArrayConversionBenchmark.py.
+
+#include <ctype.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <new>
+#include <set>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "sitkPixelIDDispatchTable.h"
+
+namespace sitk = itk::simple;
+
+// Count every heap allocation made while a kernel runs.
+static std::atomic< size_t > g_Allocations( 0 );
+
+void * operator new( size_t n )
+{
+  ++g_Allocations;
+  void *p = malloc( n ? n : 1 );
+  if( !p )
+    {
+    throw std::bad_alloc();
+    }
+  return p;
+}
+
+void operator delete( void *p ) noexcept
+{
+  free( p );
+}
+
+namespace
+{
+
+typedef std::chrono::steady_clock ClockType;
+
+struct BenchmarkOptions
+{
+  BenchmarkOptions()
+    : MaximumBytes( size_t(2) << 30 ),
+      MinimumTime( 0.2 ),
+      MaximumThreads( std::max( 1u, std::thread::hardware_concurrency() ) )
+    {}
+
+  std::string  JSONFileName;
+  std::string  Filter;
+  size_t       MaximumBytes;
+  double       MinimumTime;
+  unsigned int MaximumThreads;
+};
+
+struct BenchmarkResult
+{
+  std::string Name;
+  size_t      Bytes;
+  double      NanosecondsPerCall;
+  double      GigabytesPerSecond;
+  double      AllocationsPerCall;
+};
+
+/** The state owned by one benchmark thread. */
+struct BenchmarkWorker
+{
+  sitk::Image *       Image;
+  std::vector< char > Array;
+};
+
+enum BenchmarkMode
+{
+  CopyExport,
+  CopyImport,
+  ViewExport,
+  ViewImport
+};
+
+const char * ModeName( BenchmarkMode mode )
+{
+  switch( mode )
+    {
+    case CopyExport: return "copy_export";
+    case CopyImport: return "copy_import";
+    case ViewExport: return "view_export";
+    case ViewImport: return "view_import";
+    }
+  return "unknown";
+}
+
+/** Runs one conversion through the dispatch table, in the same
+ * sequence of kernel calls as the python functions. */
+void RunKernel( BenchmarkMode mode,
+                const sitk::PixelIDDispatchEntry * entry,
+                sitk::PixelIDValueType pixelID,
+                unsigned int numberOfComponents,
+                BenchmarkWorker & worker )
+{
+  const size_t len = worker.Array.size();
+  switch( mode )
+    {
+    case CopyExport:
+      {
+      char *array = new char[len];
+      memcpy( array, entry->GetBuffer( *worker.Image ), len );
+      delete [] array;
+      break;
+      }
+    case CopyImport:
+      {
+      sitk::Image *image = new sitk::Image( worker.Image->GetSize(),
+                                            static_cast< sitk::PixelIDValueEnum >( pixelID ),
+                                            numberOfComponents );
+      memcpy( entry->GetBuffer( *image ), &worker.Array[0], len );
+      delete image;
+      break;
+      }
+    case ViewExport:
+      entry->GetBuffer( *worker.Image );
+      entry->SetReferenceCount( *worker.Image, true );
+      entry->SetReferenceCount( *worker.Image, false );
+      break;
+    case ViewImport:
+      delete entry->ImportBuffer( &worker.Array[0], worker.Image->GetSize(), numberOfComponents, NULL );
+      break;
+    }
+}
+
+/** Collects the PixelIDValues of the vector pixel types. */
+struct VectorPixelIDCollector
+{
+  explicit VectorPixelIDCollector( std::set< sitk::PixelIDValueType > & ids ) : m_IDs( ids ) {}
+
+  template< typename TPixelIDType >
+  void operator()( void ) const
+    {
+    m_IDs.insert( sitk::PixelIDToPixelIDValue< TPixelIDType >::Result );
+    }
+
+  std::set< sitk::PixelIDValueType > & m_IDs;
+};
+
+std::string SanitizeName( const std::string & name )
+{
+  std::string result;
+  for( size_t i = 0; i < name.size(); ++i )
+    {
+    const char c = name[i];
+    result += ( isalnum( c ) ? c : '_' );
+    }
+  return result;
+}
+
+bool RunCase( const BenchmarkOptions & options,
+              BenchmarkMode mode,
+              sitk::PixelIDValueType pixelID,
+              const std::vector< unsigned int > & size,
+              unsigned int numberOfComponents,
+              unsigned int numberOfThreads,
+              BenchmarkResult & result )
+{
+  const sitk::PixelIDDispatchEntry * entry = sitk::PixelIDDispatchTable::GetEntry( pixelID, size.size() );
+  if( !entry )
+    {
+    return false;
+    }
+
+  size_t len = entry->ComponentSize * numberOfComponents;
+  for( size_t d = 0; d < size.size(); ++d )
+    {
+    len *= size[d];
+    }
+
+  std::ostringstream name;
+  name << ModeName( mode ) << "/" << SanitizeName( sitk::GetPixelIDValueAsString( pixelID ) )
+       << "/" << size.size() << "D/" << size[0] << "^" << size.size()
+       << "/c" << numberOfComponents << "/t" << numberOfThreads;
+  result.Name  = name.str();
+  result.Bytes = len;
+
+  if( !options.Filter.empty() && result.Name.find( options.Filter ) == std::string::npos )
+    {
+    return false;
+    }
+  // every thread holds an image and an array of the full size
+  if( 2 * len * numberOfThreads > options.MaximumBytes )
+    {
+    return false;
+    }
+
+  std::vector< BenchmarkWorker > workers( numberOfThreads );
+  for( unsigned int t = 0; t < numberOfThreads; ++t )
+    {
+    workers[t].Image = new sitk::Image( size, static_cast< sitk::PixelIDValueEnum >( pixelID ), numberOfComponents );
+    workers[t].Array.assign( len, char( 1 ) );
+    }
+
+  // warm up and estimate the number of iterations from a single call
+  ClockType::time_point start = ClockType::now();
+  RunKernel( mode, entry, pixelID, numberOfComponents, workers[0] );
+  const double single = std::chrono::duration< double >( ClockType::now() - start ).count();
+  const size_t iterations = static_cast< size_t >(
+    std::min( 100000.0, std::max( 3.0, options.MinimumTime / std::max( single, 1e-9 ) ) ) );
+
+  std::vector< std::thread > threads;
+  threads.reserve( numberOfThreads );
+
+  const size_t allocationsBefore = g_Allocations.load();
+  start = ClockType::now();
+
+  for( unsigned int t = 0; t < numberOfThreads; ++t )
+    {
+    BenchmarkWorker *worker = &workers[t];
+    threads.push_back( std::thread( [=]()
+      {
+      for( size_t i = 0; i < iterations; ++i )
+        {
+        RunKernel( mode, entry, pixelID, numberOfComponents, *worker );
+        }
+      } ) );
+    }
+  for( size_t t = 0; t < threads.size(); ++t )
+    {
+    threads[t].join();
+    }
+
+  const double elapsed = std::chrono::duration< double >( ClockType::now() - start ).count();
+  // the thread objects account for one allocation each
+  const size_t allocations = g_Allocations.load() - allocationsBefore - numberOfThreads;
+  const double calls = double( iterations ) * numberOfThreads;
+
+  result.NanosecondsPerCall = elapsed * 1e9 / iterations;
+  result.GigabytesPerSecond = double( len ) * calls / elapsed * 1e-9;
+  result.AllocationsPerCall = double( allocations ) / calls;
+
+  for( unsigned int t = 0; t < numberOfThreads; ++t )
+    {
+    delete workers[t].Image;
+    }
+  return true;
+}
+
+void WriteJSON( std::ostream & os, const std::vector< BenchmarkResult > & results )
+{
+  os << "{\n  \"harness\": \"native\",\n  \"results\": [\n";
+  for( size_t i = 0; i < results.size(); ++i )
+    {
+    const BenchmarkResult & r = results[i];
+    os << "    {\"name\": \"" << r.Name << "\", \"bytes\": " << r.Bytes
+       << ", \"ns_per_call\": " << r.NanosecondsPerCall
+       << ", \"gb_per_s\": " << r.GigabytesPerSecond
+       << ", \"allocations_per_call\": " << r.AllocationsPerCall << "}"
+       << ( i + 1 < results.size() ? ",\n" : "\n" );
+    }
+  os << "  ]\n}\n";
+}
+
+void Usage( const char * program )
+{
+  std::cerr << "Usage: " << program << " [--json FILE] [--filter SUBSTRING]"
+            << " [--max-bytes BYTES] [--min-time SECONDS] [--threads N]" << std::endl;
+}
+
+} // end anonymous namespace
+
+
+int main( int argc, char * argv[] )
+{
+  BenchmarkOptions options;
+  for( int i = 1; i < argc; ++i )
+    {
+    const std::string arg = argv[i];
+    if( i + 1 >= argc )
+      {
+      Usage( argv[0] );
+      return EXIT_FAILURE;
+      }
+    if( arg == "--json" )           { options.JSONFileName = argv[++i]; }
+    else if( arg == "--filter" )    { options.Filter = argv[++i]; }
+    else if( arg == "--max-bytes" ) { options.MaximumBytes = strtoull( argv[++i], NULL, 10 ); }
+    else if( arg == "--min-time" )  { options.MinimumTime = atof( argv[++i] ); }
+    else if( arg == "--threads" )   { options.MaximumThreads = std::max( 1, atoi( argv[++i] ) ); }
+    else
+      {
+      Usage( argv[0] );
+      return EXIT_FAILURE;
+      }
+    }
+
+  std::set< sitk::PixelIDValueType > vectorPixelIDs;
+  const VectorPixelIDCollector collector( vectorPixelIDs );
+  sitk::typelist::Visit< sitk::VectorPixelIDTypeList > visitEachType;
+  visitEachType( collector );
+
+  // edge lengths of the cubic images per dimension
+  std::vector< std::vector< unsigned int > > sizes;
+  const unsigned int edges2D[] = { 64, 256, 1024, 4096 };
+  const unsigned int edges3D[] = { 64, 128, 256, 512, 1024 };
+  const unsigned int edges4D[] = { 16, 32, 64 };
+  for( size_t i = 0; i < sizeof( edges2D ) / sizeof( edges2D[0] ); ++i )
+    {
+    sizes.push_back( std::vector< unsigned int >( 2, edges2D[i] ) );
+    }
+  for( size_t i = 0; i < sizeof( edges3D ) / sizeof( edges3D[0] ); ++i )
+    {
+    sizes.push_back( std::vector< unsigned int >( 3, edges3D[i] ) );
+    }
+  for( size_t i = 0; i < sizeof( edges4D ) / sizeof( edges4D[0] ); ++i )
+    {
+    sizes.push_back( std::vector< unsigned int >( 4, edges4D[i] ) );
+    }
+
+  std::vector< unsigned int > threadCounts;
+  for( unsigned int t = 1; t < options.MaximumThreads; t *= 2 )
+    {
+    threadCounts.push_back( t );
+    }
+  threadCounts.push_back( options.MaximumThreads );
+
+  const BenchmarkMode modes[] = { CopyExport, CopyImport, ViewExport, ViewImport };
+
+  const sitk::PixelIDValueType numberOfPixelIDs = sitk::typelist::Length< sitk::InstantiatedPixelIDTypeList >::Result;
+
+  std::vector< BenchmarkResult > results;
+  for( size_t m = 0; m < sizeof( modes ) / sizeof( modes[0] ); ++m )
+    {
+    // pixel types without conversion kernels are skipped by RunCase
+    for( sitk::PixelIDValueType pixelID = 0; pixelID < numberOfPixelIDs; ++pixelID )
+      {
+      const unsigned int numberOfComponents = vectorPixelIDs.count( pixelID ) ? 3 : 1;
+      for( size_t s = 0; s < sizes.size(); ++s )
+        {
+        for( size_t t = 0; t < threadCounts.size(); ++t )
+          {
+          BenchmarkResult result;
+          try
+            {
+            if( !RunCase( options, modes[m], pixelID, sizes[s], numberOfComponents, threadCounts[t], result ) )
+              {
+              continue;
+              }
+            }
+          catch( const std::exception & e )
+            {
+            std::cerr << "Skipping " << result.Name << ": " << e.what() << std::endl;
+            continue;
+            }
+          std::cout << result.Name << "\t" << result.GigabytesPerSecond << " GB/s\t"
+                    << result.NanosecondsPerCall << " ns/call\t"
+                    << result.AllocationsPerCall << " allocs/call" << std::endl;
+          results.push_back( result );
+          }
+        }
+      }
+    }
+
+  if( !options.JSONFileName.empty() )
+    {
+    std::ofstream json( options.JSONFileName.c_str() );
+    WriteJSON( json, results );
+    }
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,295 @@
+#==========================================================================
+#
+#   Copyright Insight Software Consortium
+#
+#   Licensed under the Apache License, Version 2.0 (the "License");
+#   you may not use this file except in compliance with the License.
+#   You may obtain a copy of the License at
+#
+#          http://www.apache.org/licenses/LICENSE-2.0.txt
+#
+#   Unless required by applicable law or agreed to in writing, software
+#   distributed under the License is distributed on an "AS IS" BASIS,
+#   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+#   See the License for the specific language governing permissions and
+#   limitations under the License.
+#
+#==========================================================================*/
+"""Benchmark of the SimpleITK <-> NumPy conversion functions.
+
+The "run" command times GetArrayFromImage and GetImageFromArray through
+the Python layer for every pixel type, dimension, size, copy or view
+mode and number of threads, and writes the results as JSON.
+
+The "scaling" command times the conversions of separate images by 1 up
+to N threads at once, and reports the speed up over one thread. With a
+free-threaded Python the speed up should be close to the number of
+threads, also for small images whose conversion is mostly Python code.
+
+The "compare" command checks one or more result files (of this script
+or of the native sitkNumpyArrayConversionBenchmark harness) against a
+stored baseline and fails if a case got slower than the tolerance.
+"""
+from __future__ import print_function
+import argparse
+import json
+import sys
+import threading
+import timeit
+
+try:
+    import tracemalloc
+except ImportError:
+    tracemalloc = None
+
+
+def _pixel_ids(sitk):
+    scalar = [sitk.sitkUInt8, sitk.sitkInt8, sitk.sitkUInt16, sitk.sitkInt16,
+              sitk.sitkUInt32, sitk.sitkInt32, sitk.sitkUInt64, sitk.sitkInt64,
+              sitk.sitkFloat32, sitk.sitkFloat64]
+    vector = [sitk.sitkVectorUInt8, sitk.sitkVectorInt8, sitk.sitkVectorUInt16,
+              sitk.sitkVectorInt16, sitk.sitkVectorUInt32, sitk.sitkVectorInt32,
+              sitk.sitkVectorUInt64, sitk.sitkVectorInt64, sitk.sitkVectorFloat32,
+              sitk.sitkVectorFloat64]
+    return [(p, 1) for p in scalar if p != sitk.sitkUnknown] + \
+           [(p, 3) for p in vector if p != sitk.sitkUnknown]
+
+
+def _sizes():
+    return [[64] * 2, [256] * 2, [1024] * 2, [4096] * 2,
+            [64] * 3, [128] * 3, [256] * 3, [512] * 3, [1024] * 3,
+            [16] * 4, [32] * 4, [64] * 4]
+
+
+def _conversions(sitk, image):
+    array = sitk.GetArrayFromImage(image)
+    isVector = image.GetNumberOfComponentsPerPixel() > 1
+    return {
+        "copy_export": lambda: sitk.GetArrayFromImage(image),
+        "view_export": lambda: sitk.GetArrayFromImage(image, arrayview=True),
+        "copy_import": lambda: sitk.GetImageFromArray(array, isVector=isVector),
+        "view_import": lambda: sitk.GetImageFromArray(array, isVector=isVector, imageview=True),
+    }
+
+
+def _time(function, threads, min_time):
+    """Returns the wall time per call of each thread and the number of calls."""
+    start = timeit.default_timer()
+    function()
+    single = max(timeit.default_timer() - start, 1e-9)
+    iterations = int(min(100000, max(3, min_time / single)))
+
+    def worker():
+        for _ in range(iterations):
+            function()
+
+    pool = [threading.Thread(target=worker) for _ in range(threads)]
+    start = timeit.default_timer()
+    for t in pool:
+        t.start()
+    for t in pool:
+        t.join()
+    elapsed = timeit.default_timer() - start
+    return elapsed, iterations
+
+
+def _peak_bytes(function):
+    if tracemalloc is None:
+        return None
+    tracemalloc.start()
+    try:
+        function()
+        return tracemalloc.get_traced_memory()[1]
+    finally:
+        tracemalloc.stop()
+
+
+def run(args):
+    import SimpleITK as sitk
+
+    results = []
+    for pixelID, components in _pixel_ids(sitk):
+        for size in _sizes():
+            # 4D arrays are vector images in GetImageFromArray
+            if len(size) == 4 and components == 1:
+                continue
+            image_size = size[:3] if len(size) == 4 else size
+            image_components = size[3] if len(size) == 4 else components
+            try:
+                image = sitk.Image(image_size, pixelID, image_components)
+            except RuntimeError:
+                continue
+            nbytes = sitk.GetArrayFromImage(image, arrayview=True).nbytes
+            if 2 * nbytes * args.threads > args.max_bytes:
+                continue
+            for mode, function in sorted(_conversions(sitk, image).items()):
+                for threads in sorted(set([1, args.threads])):
+                    name = "python/%s/%s/%dD/%d^%d/c%d/t%d" % (
+                        mode, image.GetPixelIDTypeAsString().replace(" ", "_"),
+                        len(image_size), image_size[0], len(image_size),
+                        image_components, threads)
+                    if args.filter and args.filter not in name:
+                        continue
+                    elapsed, iterations = _time(function, threads, args.min_time)
+                    record = {"name": name,
+                              "bytes": nbytes,
+                              "ns_per_call": elapsed * 1e9 / iterations,
+                              "gb_per_s": nbytes * iterations * threads / elapsed * 1e-9,
+                              "peak_bytes_per_call": _peak_bytes(function)}
+                    print("%s\t%.3f GB/s\t%.1f ns/call" % (name, record["gb_per_s"], record["ns_per_call"]))
+                    results.append(record)
+
+    with open(args.output, "w") as f:
+        json.dump({"harness": "python", "results": results}, f, indent=2)
+    return 0
+
+
+def scaling(args):
+    import SimpleITK as sitk
+
+    gil = getattr(sys, "_is_gil_enabled", lambda: True)()
+    print("GIL %s, %s" % ("enabled" if gil else "disabled", sys.version.split()[0]))
+
+    results = []
+    for size in args.sizes:
+        image_size = [size] * args.dimension
+        # each thread converts its own image
+        images = [sitk.Image(image_size, sitk.sitkFloat32) for _ in range(args.threads)]
+        nbytes = sitk.GetArrayFromImage(images[0], arrayview=True).nbytes
+        functions = [_conversions(sitk, image) for image in images]
+        for mode in sorted(functions[0]):
+            if args.filter and args.filter not in mode:
+                continue
+            single = None
+            for threads in range(1, args.threads + 1):
+                elapsed, iterations = _time_each([f[mode] for f in functions[:threads]], args.min_time)
+                calls_per_s = iterations * threads / elapsed
+                single = single or calls_per_s
+                name = "scaling/%s/%dD/%d^%d/t%d" % (mode, args.dimension, size, args.dimension, threads)
+                record = {"name": name,
+                          "bytes": nbytes,
+                          "ns_per_call": elapsed * 1e9 / iterations,
+                          "gb_per_s": nbytes * iterations * threads / elapsed * 1e-9,
+                          "speedup": calls_per_s / single,
+                          "efficiency": calls_per_s / single / threads}
+                print("%s\t%.0f calls/s\tspeed up %.2f\tefficiency %.0f%%"
+                      % (name, calls_per_s, record["speedup"], 100 * record["efficiency"]))
+                results.append(record)
+
+    if args.output:
+        with open(args.output, "w") as f:
+            json.dump({"harness": "python", "gil": gil, "results": results}, f, indent=2)
+
+    worst = min(r["efficiency"] for r in results) if results else 1.0
+    if worst < args.min_efficiency:
+        print("Efficiency %.0f%% is below %.0f%%." % (100 * worst, 100 * args.min_efficiency))
+        return 1
+    return 0
+
+
+def _time_each(functions, min_time):
+    """Like _time, with a separate function for each thread."""
+    start = timeit.default_timer()
+    functions[0]()
+    single = max(timeit.default_timer() - start, 1e-9)
+    iterations = int(min(100000, max(3, min_time / single)))
+    barrier = threading.Barrier(len(functions) + 1)
+
+    def worker(function):
+        barrier.wait()
+        for _ in range(iterations):
+            function()
+
+    pool = [threading.Thread(target=worker, args=(f,)) for f in functions]
+    for t in pool:
+        t.start()
+    barrier.wait()
+    start = timeit.default_timer()
+    for t in pool:
+        t.join()
+    elapsed = timeit.default_timer() - start
+    return elapsed, iterations
+
+
+def _load(filename):
+    with open(filename) as f:
+        return dict((r["name"], r) for r in json.load(f)["results"])
+
+
+def compare(args):
+    baseline = _load(args.baseline)
+    current = {}
+    for filename in args.results:
+        current.update(_load(filename))
+
+    if args.update_baseline:
+        baseline.update(current)
+        with open(args.baseline, "w") as f:
+            json.dump({"results": [baseline[k] for k in sorted(baseline)]}, f, indent=2)
+        print("Updated %s with %d results." % (args.baseline, len(current)))
+        return 0
+
+    regressions = []
+    for name, result in sorted(current.items()):
+        if name not in baseline:
+            continue
+        base = baseline[name]
+        if result["gb_per_s"] < base["gb_per_s"] * (1.0 - args.tolerance):
+            regressions.append("%s: %.3f GB/s, baseline %.3f GB/s"
+                               % (name, result["gb_per_s"], base["gb_per_s"]))
+        elif result["ns_per_call"] > base["ns_per_call"] * (1.0 + args.tolerance):
+            regressions.append("%s: %.1f ns/call, baseline %.1f ns/call"
+                               % (name, result["ns_per_call"], base["ns_per_call"]))
+
+    compared = len([n for n in current if n in baseline])
+    print("Compared %d of %d results against the baseline." % (compared, len(current)))
+    for r in regressions:
+        print("REGRESSION " + r)
+    return 1 if regressions else 0
+
+
+def main(argv):
+    parser = argparse.ArgumentParser(description=__doc__,
+                                     formatter_class=argparse.RawDescriptionHelpFormatter)
+    sub = parser.add_subparsers(dest="command")
+
+    p = sub.add_parser("run", help="time the python conversion functions")
+    p.add_argument("--output", required=True, help="JSON file of the results")
+    p.add_argument("--filter", default="", help="only run cases which contain this string")
+    p.add_argument("--max-bytes", type=int, default=2 << 30,
+                   help="skip cases which need more memory than this")
+    p.add_argument("--min-time", type=float, default=0.2, help="minimum time per case in seconds")
+    p.add_argument("--threads", type=int, default=1, help="maximum number of threads")
+
+    p = sub.add_parser("scaling", help="time the conversions of 1 to N threads at once")
+    p.add_argument("--output", default="", help="JSON file of the results")
+    p.add_argument("--filter", default="", help="only run the conversions which contain this string")
+    p.add_argument("--threads", type=int, default=4, help="maximum number of threads")
+    p.add_argument("--dimension", type=int, default=2, help="dimension of the images")
+    p.add_argument("--sizes", type=int, nargs="+", default=[32, 256],
+                   help="sizes of the axes of the images")
+    p.add_argument("--min-time", type=float, default=0.2, help="minimum time per case in seconds")
+    p.add_argument("--min-efficiency", type=float, default=0.0,
+                   help="fail if the speed up per thread of a case is below this")
+
+    p = sub.add_parser("compare", help="compare results against a baseline")
+    p.add_argument("--baseline", required=True, help="JSON file of the baseline")
+    p.add_argument("--tolerance", type=float, default=0.15,
+                   help="allowed relative slow down before a case fails")
+    p.add_argument("--update-baseline", action="store_true",
+                   help="store the results as the new baseline instead of comparing")
+    p.add_argument("results", nargs="+", help="JSON files of the results")
+
+    args = parser.parse_args(argv)
+    if args.command == "run":
+        return run(args)
+    elif args.command == "scaling":
+        return scaling(args)
+    elif args.command == "compare":
+        return compare(args)
+    parser.print_help()
+    return 1
+
+
+if __name__ == "__main__":
+    sys.exit(main(sys.argv[1:]))
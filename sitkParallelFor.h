@@ -0,0 +1,90 @@
+/*=========================================================================
+*
+*  Copyright Insight Software Consortium
+*
+*  Licensed under the Apache License, Version 2.0 (the "License");
+*  you may not use this file except in compliance with the License.
+*  You may obtain a copy of the License at
+*
+*         http://www.apache.org/licenses/LICENSE-2.0.txt
+*
+*  Unless required by applicable law or agreed to in writing, software
+*  distributed under the License is distributed on an "AS IS" BASIS,
+*  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+*  See the License for the specific language governing permissions and
+*  limitations under the License.
+*
+*=========================================================================*/
+#ifndef __sitkParallelFor_h
+#define __sitkParallelFor_h
+
+#include <algorithm>
+
+#include "itkMultiThreader.h"
+
+namespace itk
+{
+namespace simple
+{
+
+template< typename TFunction >
+struct ParallelForData
+{
+  TFunction * Function;
+  size_t      NumberOfItems;
+};
+
+template< typename TFunction >
+ITK_THREAD_RETURN_TYPE ParallelForCallback( void * arg )
+{
+  typedef MultiThreader::ThreadInfoStruct ThreadInfoType;
+  ThreadInfoType * info = static_cast< ThreadInfoType * >( arg );
+  ParallelForData< TFunction > * data = static_cast< ParallelForData< TFunction > * >( info->UserData );
+
+  const size_t threadId   = info->ThreadID;
+  const size_t numThreads = info->NumberOfThreads;
+  const size_t begin      = data->NumberOfItems * threadId / numThreads;
+  const size_t end        = data->NumberOfItems * ( threadId + 1 ) / numThreads;
+  if( begin < end )
+    {
+    ( *data->Function )( begin, end );
+    }
+  return ITK_THREAD_RETURN_VALUE;
+}
+
+/** \brief Calls function( begin, end ) on disjoint ranges which cover
+ * [0, numberOfItems), in parallel with the ITK MultiThreader.
+ *
+ * Each thread gets one contiguous range of at least grainSize items,
+ * so small problems run on the calling thread only. The function must
+ * not throw.
+ */
+template< typename TFunction >
+void ParallelFor( size_t numberOfItems, size_t grainSize, TFunction & function )
+{
+  const size_t maximumThreads = static_cast< size_t >( MultiThreader::GetGlobalDefaultNumberOfThreads() );
+  const size_t numberOfThreads = std::min( maximumThreads, numberOfItems / std::max( grainSize, size_t(1) ) );
+
+  if( numberOfThreads <= 1 )
+    {
+    if( numberOfItems > 0 )
+      {
+      function( 0, numberOfItems );
+      }
+    return;
+    }
+
+  ParallelForData< TFunction > data;
+  data.Function      = &function;
+  data.NumberOfItems = numberOfItems;
+
+  MultiThreader::Pointer threader = MultiThreader::New();
+  threader->SetNumberOfThreads( static_cast< ThreadIdType >( numberOfThreads ) );
+  threader->SetSingleMethod( &ParallelForCallback< TFunction >, &data );
+  threader->SingleMethodExecute();
+}
+
+} // namespace simple
+} // namespace itk
+
+#endif // __sitkParallelFor_h
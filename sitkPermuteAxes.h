@@ -0,0 +1,260 @@
+/*=========================================================================
+*
+*  Copyright Insight Software Consortium
+*
+*  Licensed under the Apache License, Version 2.0 (the "License");
+*  you may not use this file except in compliance with the License.
+*  You may obtain a copy of the License at
+*
+*         http://www.apache.org/licenses/LICENSE-2.0.txt
+*
+*  Unless required by applicable law or agreed to in writing, software
+*  distributed under the License is distributed on an "AS IS" BASIS,
+*  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+*  See the License for the specific language governing permissions and
+*  limitations under the License.
+*
+*=========================================================================*/
+#ifndef __sitkPermuteAxes_h
+#define __sitkPermuteAxes_h
+
+#include <string.h>
+#include <stdint.h>
+
+#include <algorithm>
+#include <vector>
+
+#include "sitkParallelFor.h"
+#include "sitkComponentInterleave.h"
+
+namespace itk
+{
+namespace simple
+{
+
+/** \class PermuteAxesCopy
+ *  \brief Copies a contiguous N-d buffer into a buffer with permuted
+ *  axes, e.g. the transpose of an image buffer into a NumPy array.
+ *
+ * The axes are in memory order, axis 0 is the fastest. Axis k of the
+ * destination is axis permutation[k] of the source. If the fastest
+ * axis is the same for both buffers the rows are copied with memcpy,
+ * otherwise the plane of the two fastest axes is transposed in
+ * square tiles, which fit in the cache for both the reads and the
+ * writes. The rows or tiles are distributed over the ITK threads.
+ * With a statistics reducer the statistics of the source are computed
+ * from the rows each thread reads.
+ */
+template< typename TElement >
+class PermuteAxesCopy
+{
+public:
+  typedef TElement ElementType;
+
+  /** The size of the transposed tiles, in elements. */
+  enum { TileSize = 32 };
+
+  PermuteAxesCopy( const std::vector< size_t > & size,
+                   const std::vector< unsigned int > & permutation )
+    : m_Size( size )
+    {
+    const size_t n = size.size();
+
+    // the strides of the source axes in the source and the destination
+    m_SourceStrides.resize( n );
+    m_DestinationStrides.resize( n );
+    size_t sourceStride = 1;
+    size_t destinationStride = 1;
+    for( size_t d = 0; d < n; ++d )
+      {
+      m_SourceStrides[d] = sourceStride;
+      sourceStride *= size[d];
+      m_DestinationStrides[permutation[d]] = destinationStride;
+      destinationStride *= size[permutation[d]];
+      }
+
+    m_SourceAxis = 0;
+    m_DestinationAxis = n > 0 ? permutation[0] : 0;
+    for( size_t d = 0; d < n; ++d )
+      {
+      if( d != m_SourceAxis && d != m_DestinationAxis )
+        {
+        m_OuterAxes.push_back( d );
+        }
+      }
+    }
+
+  void Copy( const ElementType * source, ElementType * destination,
+             ConversionStatisticsReducer * statistics = NULL )
+    {
+    if( m_Size.empty() )
+      {
+      return;
+      }
+    m_Source = source;
+    m_Destination = destination;
+    m_Statistics = statistics;
+
+    size_t numberOfOuter = 1;
+    for( size_t i = 0; i < m_OuterAxes.size(); ++i )
+      {
+      numberOfOuter *= m_Size[m_OuterAxes[i]];
+      }
+
+    size_t elementsPerItem;
+    if( m_SourceAxis == m_DestinationAxis )
+      {
+      m_NumberOfTiles = 1;
+      elementsPerItem = m_Size[m_SourceAxis];
+      }
+    else
+      {
+      // an item is a row of tiles along the source axis
+      m_NumberOfTiles = ( m_Size[m_DestinationAxis] + TileSize - 1 ) / TileSize;
+      elementsPerItem = m_Size[m_SourceAxis] * std::min( m_Size[m_DestinationAxis], size_t( TileSize ) );
+      }
+
+    // at least 64K elements per thread
+    const size_t grainSize = std::max( size_t(1), size_t(65536) / std::max( elementsPerItem, size_t(1) ) );
+    ParallelFor( numberOfOuter * m_NumberOfTiles, grainSize, *this );
+    }
+
+  void operator()( size_t beginItem, size_t endItem ) const
+    {
+    ConversionStatisticsAccumulator accumulator( m_Statistics );
+    for( size_t item = beginItem; item < endItem; ++item )
+      {
+      // the offsets of the outer index in both buffers
+      size_t outer = item / m_NumberOfTiles;
+      size_t sourceOffset = 0;
+      size_t destinationOffset = 0;
+      for( size_t i = 0; i < m_OuterAxes.size(); ++i )
+        {
+        const size_t d = m_OuterAxes[i];
+        const size_t index = outer % m_Size[d];
+        outer /= m_Size[d];
+        sourceOffset += index * m_SourceStrides[d];
+        destinationOffset += index * m_DestinationStrides[d];
+        }
+
+      if( m_SourceAxis == m_DestinationAxis )
+        {
+        memcpy( m_Destination + destinationOffset, m_Source + sourceOffset, m_Size[m_SourceAxis] * sizeof( ElementType ) );
+        accumulator.Add( m_Source, sourceOffset, m_Size[m_SourceAxis] );
+        }
+      else
+        {
+        this->CopyTileRow( item % m_NumberOfTiles, sourceOffset, destinationOffset, accumulator );
+        }
+      }
+    }
+
+private:
+
+  void CopyTileRow( size_t tile, size_t sourceOffset, size_t destinationOffset,
+                    ConversionStatisticsAccumulator & accumulator ) const
+    {
+    const size_t a = m_SourceAxis;
+    const size_t b = m_DestinationAxis;
+    const size_t sourceStrideB = m_SourceStrides[b];
+    const size_t destinationStrideA = m_DestinationStrides[a];
+    const size_t beginB = tile * TileSize;
+    const size_t endB = std::min( beginB + TileSize, m_Size[b] );
+
+    for( size_t beginA = 0; beginA < m_Size[a]; beginA += TileSize )
+      {
+      const size_t endA = std::min( beginA + TileSize, m_Size[a] );
+      for( size_t j = beginB; j < endB; ++j )
+        {
+        // the source is contiguous along a, the destination along b
+        const ElementType * s = m_Source + sourceOffset + j * sourceStrideB;
+        ElementType * t = m_Destination + destinationOffset + j;
+        for( size_t i = beginA; i < endA; ++i )
+          {
+          t[i * destinationStrideA] = s[i];
+          }
+        }
+      // the source rows of the tile, while they are in the cache
+      for( size_t j = beginB; j < endB; ++j )
+        {
+        accumulator.Add( m_Source, sourceOffset + j * sourceStrideB + beginA, endA - beginA );
+        }
+      }
+    }
+
+  std::vector< size_t >         m_Size;
+  std::vector< size_t >         m_SourceStrides;
+  std::vector< size_t >         m_DestinationStrides;
+  std::vector< size_t >         m_OuterAxes;
+  size_t                        m_SourceAxis;
+  size_t                        m_DestinationAxis;
+  size_t                        m_NumberOfTiles;
+  const ElementType *           m_Source;
+  ElementType *                 m_Destination;
+  ConversionStatisticsReducer * m_Statistics;
+};
+
+
+/** Copies a buffer of elements of elementSize bytes into a buffer
+ * with permuted axes, see PermuteAxesCopy. Moving the fastest axis of
+ * a few components to the slowest, or back, e.g. between the pixels
+ * of a vector image and planes, is done by the ComponentInterleave
+ * kernels. If a statistics reducer is given, the elements are the
+ * components of its pixel type and their statistics are computed in
+ * the same pass. Returns false if the element size is not supported. */
+inline bool PermuteAxes( const void * source,
+                         void * destination,
+                         size_t elementSize,
+                         const std::vector< size_t > & size,
+                         const std::vector< unsigned int > & permutation,
+                         ConversionStatisticsReducer * statistics = NULL )
+{
+  // more components are transposed in tiles
+  const size_t maximumNumberOfComponents = 16;
+  const size_t n = size.size();
+  if( n > 1 )
+    {
+    bool deinterleave = permutation[n-1] == 0 && size[0] <= maximumNumberOfComponents;
+    bool interleave = permutation[0] == n-1 && size[n-1] <= maximumNumberOfComponents;
+    size_t numberOfElements = 1;
+    for( size_t k = 0; k < n; ++k )
+      {
+      deinterleave = deinterleave && ( k == n-1 || permutation[k] == k+1 );
+      interleave = interleave && ( k == 0 || permutation[k] == k-1 );
+      numberOfElements *= size[k];
+      }
+    if( deinterleave && size[0] > 0 )
+      {
+      return ConvertComponentLayout( source, destination, elementSize, numberOfElements / size[0],
+                                     static_cast< unsigned int >( size[0] ), false, statistics );
+      }
+    if( interleave && size[n-1] > 0 )
+      {
+      return ConvertComponentLayout( source, destination, elementSize, numberOfElements / size[n-1],
+                                     static_cast< unsigned int >( size[n-1] ), true, statistics );
+      }
+    }
+
+  switch( elementSize )
+    {
+    case 1:
+      PermuteAxesCopy< uint8_t >( size, permutation ).Copy( static_cast< const uint8_t * >( source ), static_cast< uint8_t * >( destination ), statistics );
+      return true;
+    case 2:
+      PermuteAxesCopy< uint16_t >( size, permutation ).Copy( static_cast< const uint16_t * >( source ), static_cast< uint16_t * >( destination ), statistics );
+      return true;
+    case 4:
+      PermuteAxesCopy< uint32_t >( size, permutation ).Copy( static_cast< const uint32_t * >( source ), static_cast< uint32_t * >( destination ), statistics );
+      return true;
+    case 8:
+      PermuteAxesCopy< uint64_t >( size, permutation ).Copy( static_cast< const uint64_t * >( source ), static_cast< uint64_t * >( destination ), statistics );
+      return true;
+    default:
+      return false;
+    }
+}
+
+} // namespace simple
+} // namespace itk
+
+#endif // __sitkPermuteAxes_h
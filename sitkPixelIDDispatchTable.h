@@ -0,0 +1,417 @@
+/*=========================================================================
+*
+*  Copyright Insight Software Consortium
+*
+*  Licensed under the Apache License, Version 2.0 (the "License");
+*  you may not use this file except in compliance with the License.
+*  You may obtain a copy of the License at
+*
+*         http://www.apache.org/licenses/LICENSE-2.0.txt
+*
+*  Unless required by applicable law or agreed to in writing, software
+*  distributed under the License is distributed on an "AS IS" BASIS,
+*  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+*  See the License for the specific language governing permissions and
+*  limitations under the License.
+*
+*=========================================================================*/
+#ifndef __sitkPixelIDDispatchTable_h
+#define __sitkPixelIDDispatchTable_h
+
+#include <string.h>
+
+#include <algorithm>
+#include <limits>
+#include <vector>
+
+#include "sitkImage.h"
+#include "sitkConfigure.h"
+#include "sitkEnableIf.h"
+#include "sitkPixelIDTokens.h"
+#include "sitkPixelIDTypeLists.h"
+#include "sitkPixelIDTypes.h"
+#include "sitkPixelIDValues.h"
+#include "itkCommand.h"
+#include "itkImage.h"
+#include "itkMutexLockHolder.h"
+#include "itkNumericTraits.h"
+#include "itkSimpleFastMutexLock.h"
+#include "itkVectorImage.h"
+
+// Older SimpleITK configurations do not export the maximum dimension.
+#ifndef SITK_MAX_DIMENSION
+#ifdef SITK_4D_IMAGES
+#define SITK_MAX_DIMENSION 4
+#else
+#define SITK_MAX_DIMENSION 3
+#endif
+#endif
+
+namespace itk
+{
+namespace simple
+{
+
+/** \class PixelIDDispatchEntry
+ *  \brief The conversion kernels of a single pixel type and dimension.
+ *
+ * Every kernel operates on the pixel container of the underlying ITK
+ * image, so the entry is all that is needed to convert an image
+ * without knowing its type at the call site. Casts between two pixel
+ * types combine the kernels of both entries, see CastComponents.
+ */
+struct PixelIDDispatchEntry
+{
+  typedef void *       (*GetBufferFunctionType)( Image & );
+  typedef const void * (*GetConstBufferFunctionType)( const Image & );
+  typedef const ::itk::Object * (*GetPixelContainerFunctionType)( const Image & );
+  typedef bool         (*IsBufferImportedFunctionType)( const Image & );
+  typedef Image *      (*ImportBufferFunctionType)( void *, const std::vector< unsigned int > &, unsigned int, ::itk::Command * );
+  typedef void         (*ReferenceCountFunctionType)( Image &, bool );
+  typedef void         (*LoadComponentsFunctionType)( const void *, size_t, size_t, double * );
+  typedef void         (*StoreComponentsFunctionType)( const double *, size_t, void *, size_t );
+  typedef void         (*RoundComponentsFunctionType)( double *, size_t );
+
+  /** Size in bytes of one pixel component. */
+  size_t                      ComponentSize;
+
+  /** The limits of the component type, as doubles. */
+  bool                        ComponentIsInteger;
+  double                      ComponentMinimum;
+  double                      ComponentMaximum;
+
+  /** Returns the (unique) pixel buffer of the image. */
+  GetBufferFunctionType       GetBuffer;
+
+  /** Returns the pixel buffer of the image for reading, without
+   * making the image unique. */
+  GetConstBufferFunctionType  GetConstBuffer;
+
+  /** Returns the pixel container of the image, e.g. to identify the
+   * buffer and its modification time. */
+  GetPixelContainerFunctionType GetPixelContainer;
+
+  /** Returns true if the pixel container does not own its buffer, e.g.
+   * an imported array, shared memory or a mapped file, which may be
+   * written without modifying the image. */
+  IsBufferImportedFunctionType IsBufferImported;
+
+  /** Creates a new image which uses, but does not own, an external
+   * buffer. The optional command is called when the pixel container is
+   * deleted, i.e. when the buffer is no longer used. */
+  ImportBufferFunctionType    ImportBuffer;
+
+  /** Registers or unregisters an exported view of the pixel container. */
+  ReferenceCountFunctionType  SetReferenceCount;
+
+  /** Converts n components, starting at component offset of a buffer,
+   * to double. */
+  LoadComponentsFunctionType  LoadComponents;
+
+  /** Converts n doubles to components of the pixel type, written
+   * starting at component offset of a buffer. */
+  StoreComponentsFunctionType StoreComponents;
+
+  /** Replaces n doubles with the value they have when converted to the
+   * component type, e.g. the wrap around of integer types. */
+  RoundComponentsFunctionType RoundComponents;
+};
+
+
+/** Converts a double to a pixel component the way an integer result
+ * of C++ arithmetic is converted, i.e. truncated and wrapped around
+ * for integer types, instead of the undefined conversion of an out of
+ * range double. */
+template< typename TComponentType >
+inline TComponentType ConvertComponent( double value )
+{
+  if( !std::numeric_limits< TComponentType >::is_integer )
+    {
+    return static_cast< TComponentType >( value );
+    }
+  // not a number converts to zero, and out of range values saturate in 64 bits
+  if( !( value == value ) )
+    {
+    return TComponentType( 0 );
+    }
+  const double maximum = 9223372036854775807.0;
+  // the upper half of the unsigned 64 bit range is not a long long
+  if( !std::numeric_limits< TComponentType >::is_signed
+      && std::numeric_limits< TComponentType >::digits >= 64 && value >= maximum )
+    {
+    return value >= 18446744073709551615.0 ? std::numeric_limits< TComponentType >::max()
+                                            : static_cast< TComponentType >( value );
+    }
+  if( value >= maximum )
+    {
+    return static_cast< TComponentType >( std::numeric_limits< long long >::max() );
+    }
+  if( value <= -maximum )
+    {
+    return static_cast< TComponentType >( std::numeric_limits< long long >::min() );
+    }
+  return static_cast< TComponentType >( static_cast< long long >( value ) );
+}
+
+
+/** Casts n components of the pixel type of sourceEntry, starting at
+ * component sourceOffset of a buffer, to the pixel type of
+ * destinationEntry, written starting at component destinationOffset.
+ *
+ * The components are converted through blocks of doubles with the
+ * LoadComponents and StoreComponents kernels of the two types, so any
+ * pair of pixel types is cast with two indirect calls per block,
+ * instead of a kernel for each pair. Values are converted as by
+ * ConvertComponent, 64 bit integers beyond 2^53 are not exact. */
+inline void CastComponents( const PixelIDDispatchEntry & sourceEntry,
+                            const void * source,
+                            size_t sourceOffset,
+                            const PixelIDDispatchEntry & destinationEntry,
+                            void * destination,
+                            size_t destinationOffset,
+                            size_t n )
+{
+  const size_t blockSize = 1024;
+  double values[blockSize];
+  for( size_t i = 0; i < n; i += blockSize )
+    {
+    const size_t m = std::min( blockSize, n - i );
+    sourceEntry.LoadComponents( source, sourceOffset + i, m, values );
+    destinationEntry.StoreComponents( values, m, destination, destinationOffset + i );
+    }
+}
+
+
+/** Returns the lock of the exported views of a pixel container. The
+ * containers share a small table of locks by their address, so that
+ * registering views of different images rarely contends. */
+inline SimpleFastMutexLock & GetReferenceCountLock( const void * container )
+{
+  static SimpleFastMutexLock locks[64];
+  const size_t address = reinterpret_cast< size_t >( container );
+  return locks[( address >> 6 ) % 64];
+}
+
+
+/** \brief Kernels shared by itk::Image and itk::VectorImage types. */
+template< typename TImageType >
+struct PixelIDDispatchKernels
+{
+  typedef TImageType                             ImageType;
+  typedef typename ImageType::InternalPixelType  ComponentType;
+
+  static void * GetBuffer( Image & sitkImage )
+    {
+    // the non-const GetITKBase makes the image unique before the
+    // buffer is handed out for writing, and the modified container
+    // invalidates the copies of the conversion cache
+    ImageType * itkImage = static_cast< ImageType * >( sitkImage.GetITKBase() );
+    itkImage->GetPixelContainer()->Modified();
+    return itkImage->GetBufferPointer();
+    }
+
+  static const void * GetConstBuffer( const Image & sitkImage )
+    {
+    const ImageType * itkImage = static_cast< const ImageType * >( sitkImage.GetITKBase() );
+    return itkImage->GetBufferPointer();
+    }
+
+  static const ::itk::Object * GetPixelContainer( const Image & sitkImage )
+    {
+    const ImageType * itkImage = static_cast< const ImageType * >( sitkImage.GetITKBase() );
+    return itkImage->GetPixelContainer();
+    }
+
+  static bool IsBufferImported( const Image & sitkImage )
+    {
+    const ImageType * itkImage = static_cast< const ImageType * >( sitkImage.GetITKBase() );
+    return !itkImage->GetPixelContainer()->GetContainerManageMemory();
+    }
+
+  static Image * ImportBuffer( void * buffer,
+                               const std::vector< unsigned int > & size,
+                               unsigned int numberOfComponents,
+                               ::itk::Command * deleteCommand )
+    {
+    typename ImageType::SizeType itkSize;
+    for( unsigned int d = 0; d < ImageType::ImageDimension; ++d )
+      {
+      itkSize[d] = size[d];
+      }
+    typename ImageType::RegionType region;
+    region.SetSize( itkSize );
+
+    typename ImageType::Pointer itkImage = ImageType::New();
+    itkImage->SetRegions( region );
+    itkImage->SetNumberOfComponentsPerPixel( numberOfComponents );
+
+    // the container does not manage the memory, the caller keeps
+    // the buffer alive for the life time of the image
+    itkImage->GetPixelContainer()->SetImportPointer( static_cast< ComponentType * >( buffer ),
+                                                     region.GetNumberOfPixels() * numberOfComponents,
+                                                     false );
+    if( deleteCommand )
+      {
+      itkImage->GetPixelContainer()->AddObserver( DeleteEvent(), deleteCommand );
+      }
+    return new Image( itkImage.GetPointer() );
+    }
+
+  static void SetReferenceCount( Image & sitkImage, bool bIncreaseRefCnt )
+    {
+    ImageType * itkImage = static_cast< ImageType * >( sitkImage.GetITKBase() );
+    // the count is tested and decremented as one step, views of the
+    // same image may be released by several threads at once
+    MutexLockHolder< SimpleFastMutexLock > lock( GetReferenceCountLock( itkImage->GetPixelContainer() ) );
+    if( bIncreaseRefCnt )
+      {
+      itkImage->GetPixelContainer()->Register();
+      }
+    else
+      {
+      if( itkImage->GetPixelContainer()->GetReferenceCount() > 1 )
+        {
+        itkImage->GetPixelContainer()->UnRegister();
+        }
+      }
+    }
+
+  // The loops below are kept simple so that the compiler vectorizes them.
+
+  static void LoadComponents( const void * buffer, size_t offset, size_t n, double * values )
+    {
+    const ComponentType * components = static_cast< const ComponentType * >( buffer ) + offset;
+    for( size_t i = 0; i < n; ++i )
+      {
+      values[i] = static_cast< double >( components[i] );
+      }
+    }
+
+  static void StoreComponents( const double * values, size_t n, void * buffer, size_t offset )
+    {
+    ComponentType * components = static_cast< ComponentType * >( buffer ) + offset;
+    for( size_t i = 0; i < n; ++i )
+      {
+      components[i] = ConvertComponent< ComponentType >( values[i] );
+      }
+    }
+
+  static void RoundComponents( double * values, size_t n )
+    {
+    for( size_t i = 0; i < n; ++i )
+      {
+      values[i] = static_cast< double >( ConvertComponent< ComponentType >( values[i] ) );
+      }
+    }
+
+  static PixelIDDispatchEntry MakeEntry( void )
+    {
+    PixelIDDispatchEntry entry;
+    entry.ComponentSize      = sizeof( ComponentType );
+    entry.ComponentIsInteger = std::numeric_limits< ComponentType >::is_integer;
+    entry.ComponentMinimum   = static_cast< double >( NumericTraits< ComponentType >::NonpositiveMin() );
+    entry.ComponentMaximum   = static_cast< double >( NumericTraits< ComponentType >::max() );
+    entry.GetBuffer          = &GetBuffer;
+    entry.GetConstBuffer     = &GetConstBuffer;
+    entry.GetPixelContainer  = &GetPixelContainer;
+    entry.IsBufferImported   = &IsBufferImported;
+    entry.ImportBuffer       = &ImportBuffer;
+    entry.SetReferenceCount  = &SetReferenceCount;
+    entry.LoadComponents     = &LoadComponents;
+    entry.StoreComponents    = &StoreComponents;
+    entry.RoundComponents    = &RoundComponents;
+    return entry;
+    }
+};
+
+
+/** \class PixelIDDispatchTable
+ *  \brief A table of conversion kernels indexed by PixelIDValue and
+ *  image dimension.
+ *
+ * The table is generated from the SimpleITK pixel type lists for all
+ * dimensions up to SITK_MAX_DIMENSION, so that dispatching on a
+ * run-time pixel type is a single lookup followed by an indirect
+ * call. Pixel types without a flat pixel buffer (label maps, complex)
+ * have no entry.
+ */
+class PixelIDDispatchTable
+{
+public:
+  /** The pixel types which have conversion kernels. */
+  typedef typelist::Append< BasicPixelIDTypeList, VectorPixelIDTypeList >::Type PixelIDTypeList;
+
+  /** The number of PixelIDValues, the first extent of the table. */
+  enum { NumberOfPixelIDs = typelist::Length< InstantiatedPixelIDTypeList >::Result };
+
+  /** Returns the kernels for the pixel type and dimension, or NULL
+   * if the combination is not supported. */
+  static const PixelIDDispatchEntry * GetEntry( PixelIDValueType pixelID, unsigned int dimension )
+    {
+    static const PixelIDDispatchTable table;
+
+    if( pixelID < 0 || pixelID >= NumberOfPixelIDs
+        || dimension > SITK_MAX_DIMENSION )
+      {
+      return NULL;
+      }
+    const PixelIDDispatchEntry * entry = &table.m_Entries[pixelID][dimension];
+    return entry->GetBuffer ? entry : NULL;
+    }
+
+private:
+  typedef PixelIDDispatchEntry EntryArrayType[NumberOfPixelIDs][SITK_MAX_DIMENSION + 1];
+
+  template< unsigned int VImageDimension >
+  struct Register
+  {
+    explicit Register( EntryArrayType & entries ) : m_Entries( entries ) {}
+
+    template< typename TPixelIDType >
+    typename EnableIf< IsInstantiated< TPixelIDType, VImageDimension >::Value >::Type
+    operator()( void ) const
+      {
+      typedef typename PixelIDToImageType< TPixelIDType, VImageDimension >::ImageType ImageType;
+      const int pixelID = PixelIDToPixelIDValue< TPixelIDType >::Result;
+      m_Entries[pixelID][VImageDimension] = PixelIDDispatchKernels< ImageType >::MakeEntry();
+      }
+
+    template< typename TPixelIDType >
+    typename DisableIf< IsInstantiated< TPixelIDType, VImageDimension >::Value >::Type
+    operator()( void ) const {}
+
+    EntryArrayType & m_Entries;
+  };
+
+  // Recursively registers the pixel types for dimensions VImageDimension down to 2.
+  template< unsigned int VImageDimension, bool VDone = ( VImageDimension < 2 ) >
+  struct RegisterDimensions
+  {
+    static void Apply( EntryArrayType & entries )
+      {
+      const Register< VImageDimension > visitor( entries );
+      typelist::Visit< PixelIDTypeList > visitEachType;
+      visitEachType( visitor );
+      RegisterDimensions< VImageDimension - 1 >::Apply( entries );
+      }
+  };
+
+  template< unsigned int VImageDimension >
+  struct RegisterDimensions< VImageDimension, true >
+  {
+    static void Apply( EntryArrayType & ) {}
+  };
+
+  PixelIDDispatchTable( void )
+    {
+    memset( m_Entries, 0, sizeof( m_Entries ) );
+    RegisterDimensions< SITK_MAX_DIMENSION >::Apply( m_Entries );
+    }
+
+  EntryArrayType m_Entries;
+};
+
+} // namespace simple
+} // namespace itk
+
+#endif // __sitkPixelIDDispatchTable_h
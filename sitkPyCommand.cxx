@@ -23,6 +23,7 @@
 
 #include "sitkPyCommand.h"
 #include "sitkExceptionObject.h"
+#include "itkMutexLockHolder.h"
 
 #include <iostream>
 
@@ -70,70 +71,83 @@ PyCommand::~PyCommand()
 
 void PyCommand::SetCallbackPyCallable(PyObject *o)
 {
-  if (o != this->m_Object)
-    {
-    PyGILStateEnsure gil;
-    if (this->m_Object)
-      {
-      // get rid of our reference
-      Py_DECREF(this->m_Object);
-      }
-
-    // store the new object
-    this->m_Object = o;
-
-    if (this->m_Object)
-      {
-      // take out reference (so that the calling code doesn't
-      // have to keep a binding to the callable around)
-      Py_INCREF(this->m_Object);
-      }
-    }
+  PyGILStateEnsure gil;
+
+  // take out reference (so that the calling code doesn't
+  // have to keep a binding to the callable around)
+  Py_XINCREF(o);
+
+  PyObject *previous;
+  {
+  itk::MutexLockHolder<itk::SimpleFastMutexLock> lock(this->m_ObjectLock);
+  previous = this->m_Object;
+  this->m_Object = o;
+  }
+
+  // get rid of our reference outside of the lock, the callable may be
+  // deleted which runs python code
+  Py_XDECREF(previous);
 }
 
 PyObject * PyCommand::GetCallbackPyCallable()
 {
+  itk::MutexLockHolder<itk::SimpleFastMutexLock> lock(this->m_ObjectLock);
+  return this->m_Object;
+}
+
+PyObject * PyCommand::GetNewReferenceToCallable()
+{
+  itk::MutexLockHolder<itk::SimpleFastMutexLock> lock(this->m_ObjectLock);
+  Py_XINCREF(this->m_Object);
   return this->m_Object;
 }
 
 void PyCommand::Execute()
 {
   // if null do nothing
-  if (!this->m_Object)
+  if (!this->GetCallbackPyCallable())
+    {
+    return;
+    }
+
+  PyGILStateEnsure gil;
+
+  // a reference for this call, the callable may be replaced by
+  // another thread while it runs
+  PyObject *callable = this->GetNewReferenceToCallable();
+  if (!callable)
     {
     return;
     }
 
   // make sure that the CommandCallable is in fact callable
-  if (!PyCallable_Check(this->m_Object))
+  if (!PyCallable_Check(callable))
     {
+    Py_DECREF(callable);
     // we throw a standard ITK exception: this makes it possible for
     // our standard CableSwig exception handling logic to take this
     // through to the invoking Python process
     sitkExceptionMacro(<<"Python Callable is not a callable Python object, "
                        <<"or it has not been set.");
     }
+
+  PyObject *result;
+
+  result = PyObject_CallObject(callable, (PyObject *)NULL);
+  Py_DECREF(callable);
+
+  if (result)
+    {
+    Py_DECREF(result);
+    }
   else
     {
-    PyGILStateEnsure gil;
-
-    PyObject *result;
-
-    result = PyObject_CallObject(this->m_Object, (PyObject *)NULL);
-
-    if (result)
-      {
-      Py_DECREF(result);
-      }
-    else
-      {
-      // there was a Python error.  Clear the error by printing to stdout
-      PyErr_Print();
-      // make sure the invoking Python code knows there was a problem
-      // by raising an exception
-      sitkExceptionMacro(<<"There was an error executing the "
-                         <<"Python Callable.");
-      }
+    // there was a Python error.  Clear the error by printing to stdout
+    PyErr_Print();
+    // make sure the invoking Python code knows there was a problem
+    // by raising an exception
+    sitkExceptionMacro(<<"There was an error executing the "
+                       <<"Python Callable.");
     }
 }
 
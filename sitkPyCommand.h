@@ -20,6 +20,7 @@
 #define __sitkPyCommand_h
 
 #include "sitkCommand.h"
+#include "itkSimpleFastMutexLock.h"
 
 
 
@@ -40,6 +41,10 @@ namespace simple
  * With this class, arbitrary Python callable objects (e.g. functions)
  * can be associated with an instance to be used in AddObserver calls.
  *
+ * The command may be executed by several threads at once, e.g. with a
+ * free-threaded Python, each call holds its own reference to the
+ * callable, so that the callable may be replaced concurrently.
+ *
  * Based of the WrapITK itkPyCommand class originally contributed by
  * Charl P. Botha <cpbotha |AT| ieee.org>.
  */
@@ -79,7 +84,13 @@ protected:
   PyCommand & operator=(const Self&);
 
 private:
+  // returns a new reference to the callable, or NULL
+  PyObject * GetNewReferenceToCallable();
+
   PyObject *m_Object;
+
+  // guards m_Object, only held to read or replace the pointer
+  itk::SimpleFastMutexLock m_ObjectLock;
 };
 
 } // namespace simple
@@ -0,0 +1,354 @@
+/*=========================================================================
+*
+*  Copyright Insight Software Consortium
+*
+*  Licensed under the Apache License, Version 2.0 (the "License");
+*  you may not use this file except in compliance with the License.
+*  You may obtain a copy of the License at
+*
+*         http://www.apache.org/licenses/LICENSE-2.0.txt
+*
+*  Unless required by applicable law or agreed to in writing, software
+*  distributed under the License is distributed on an "AS IS" BASIS,
+*  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+*  See the License for the specific language governing permissions and
+*  limitations under the License.
+*
+*=========================================================================*/
+#include <list>
+
+#include "itkIntTypes.h"
+#include "itkObject.h"
+
+// This file is included inline after sitkNumpyArrayConversion.cxx, whose
+// sitk_GetByteArrayFromImage makes the copies of the cache.
+
+namespace
+{
+
+/** \class sitk_ConversionCache
+ * \brief A least recently used cache of the read only NumPy arrays
+ * copied from images, for repeated conversions of unchanged images.
+ *
+ * An array is identified by the pixel container of the image and the
+ * latest modification time of the image and the container. The cache
+ * registers a reference to the container, not to the image, so that
+ * it does not make the next write to the image copy the pixels. The
+ * writes of the conversions and of SetPixel modify the container.
+ *
+ * A container which does not own its buffer, e.g. an imported array,
+ * shared memory or a mapped file, may be written by others without a
+ * modification, and is not cached. Neither is a container referenced
+ * by exported array views, of any wrapper of the image. Containers
+ * which are only referenced by the cache are evicted, as are the least
+ * recently used arrays when the arrays exceed the budget in bytes.
+ *
+ * The cache is only used with the GIL held. A free-threaded python
+ * has no GIL, so the entries are guarded by a mutex, which is not
+ * held while an array is copied.
+ */
+class sitk_ConversionCache
+{
+public:
+  static sitk_ConversionCache & GetInstance( void )
+    {
+    // never deleted, the arrays can not be released after python is
+    // finalized
+    static sitk_ConversionCache *cache = new sitk_ConversionCache;
+    return *cache;
+    }
+
+  /** Returns a new reference to the cached array of the image, which
+   * is copied on a miss. On failure a python exception is set and NULL
+   * is returned. */
+  PyObject * GetArray( PyObject *pyImage, const sitk::Image &image, const sitk::PixelIDDispatchEntry &entry )
+    {
+    const ::itk::Object *container = entry.GetPixelContainer( image );
+    const ::itk::ModifiedTimeType modifiedTime = std::max( image.GetITKBase()->GetMTime(), container->GetMTime() );
+    const bool cacheable = !entry.IsBufferImported( image );
+
+    {
+    LockHolderType lock( m_Mutex );
+    this->EvictUnreferenced();
+    EntryListType::iterator it = this->Find( container );
+    if( it != m_Entries.end() )
+      {
+      // only the image and the entry reference the container, there
+      // is no exported view which may have written it
+      if( it->ModifiedTime == modifiedTime && container->GetReferenceCount() <= 2 )
+        {
+        ++m_Hits;
+        m_Entries.splice( m_Entries.begin(), m_Entries, it );
+        Py_INCREF( it->Array );
+        return it->Array;
+        }
+      this->Erase( it );
+      }
+    ++m_Misses;
+    }
+
+    PyObject *args = Py_BuildValue( "(OiO)", pyImage, 0, Py_None );
+    if( !args )
+      {
+      return NULL;
+      }
+    PyObject *array = sitk_GetByteArrayFromImage( NULL, args );
+    Py_DECREF( args );
+    if( !array )
+      {
+      return NULL;
+      }
+    PyArray_CLEARFLAGS( reinterpret_cast< PyArrayObject * >( array ), NPY_ARRAY_WRITEABLE );
+
+    const size_t size = static_cast< size_t >( PyArray_NBYTES( reinterpret_cast< PyArrayObject * >( array ) ) );
+    LockHolderType lock( m_Mutex );
+    // another thread may have added the image while it was copied
+    EntryListType::iterator it = this->Find( container );
+    if( it != m_Entries.end() )
+      {
+      this->Erase( it );
+      }
+    if( cacheable && size <= m_Budget && container->GetReferenceCount() <= 1 )
+      {
+      m_Entries.push_front( EntryType( container, modifiedTime, array, size ) );
+      Py_INCREF( array );
+      m_Size += size;
+      this->EvictToBudget();
+      }
+    return array;
+    }
+
+  void SetBudget( size_t budget )
+    {
+    LockHolderType lock( m_Mutex );
+    m_Budget = budget;
+    this->EvictToBudget();
+    }
+
+  void Clear( void )
+    {
+    LockHolderType lock( m_Mutex );
+    while( !m_Entries.empty() )
+      {
+      this->Erase( m_Entries.begin() );
+      }
+    }
+
+  /** Returns a new dictionary of the counters of the cache. */
+  PyObject * GetStatistics( void )
+    {
+    LockHolderType lock( m_Mutex );
+    return Py_BuildValue( "{s:K,s:K,s:K,s:n,s:n,s:n}",
+                          "Hits", m_Hits,
+                          "Misses", m_Misses,
+                          "Evictions", m_Evictions,
+                          "NumberOfEntries", static_cast< Py_ssize_t >( m_Entries.size() ),
+                          "Size", static_cast< Py_ssize_t >( m_Size ),
+                          "Budget", static_cast< Py_ssize_t >( m_Budget ) );
+    }
+
+private:
+#ifdef Py_GIL_DISABLED
+  typedef PyMutex MutexType;
+
+  class LockHolderType
+  {
+  public:
+    explicit LockHolderType( MutexType &mutex ) : m_Mutex( mutex )
+      {
+      PyMutex_Lock( &m_Mutex );
+      }
+    ~LockHolderType( void )
+      {
+      PyMutex_Unlock( &m_Mutex );
+      }
+  private:
+    MutexType &m_Mutex;
+  };
+#else
+  // the GIL guards the cache
+  struct MutexType {};
+
+  struct LockHolderType
+  {
+    explicit LockHolderType( MutexType & ) {}
+  };
+#endif
+
+  struct EntryType
+  {
+    EntryType( const ::itk::Object *container, ::itk::ModifiedTimeType modifiedTime,
+               PyObject *array, size_t size )
+      : PixelContainer( container ), ModifiedTime( modifiedTime ),
+        Array( array ), Size( size ) {}
+
+    // the registered reference keeps the container from being reused
+    ::itk::Object::ConstPointer PixelContainer;
+    ::itk::ModifiedTimeType ModifiedTime;
+    PyObject *              Array;
+    size_t                  Size;
+  };
+
+  // the most recently used entry first
+  typedef std::list< EntryType > EntryListType;
+
+  sitk_ConversionCache( void )
+    : m_Budget( 256 * 1024 * 1024 ), m_Size( 0 ),
+      m_Hits( 0 ), m_Misses( 0 ), m_Evictions( 0 )
+    {
+#ifdef Py_GIL_DISABLED
+    memset( &m_Mutex, 0, sizeof( m_Mutex ) );
+#endif
+    }
+
+  EntryListType::iterator Find( const ::itk::Object *container )
+    {
+    EntryListType::iterator it = m_Entries.begin();
+    while( it != m_Entries.end() && it->PixelContainer.GetPointer() != container )
+      {
+      ++it;
+      }
+    return it;
+    }
+
+  void Erase( EntryListType::iterator it )
+    {
+    m_Size -= it->Size;
+    Py_DECREF( it->Array );
+    m_Entries.erase( it );
+    }
+
+  void EvictToBudget( void )
+    {
+    while( m_Size > m_Budget )
+      {
+      ++m_Evictions;
+      this->Erase( --m_Entries.end() );
+      }
+    }
+
+  // the entry holds the last reference to the container
+  void EvictUnreferenced( void )
+    {
+    EntryListType::iterator it = m_Entries.begin();
+    while( it != m_Entries.end() )
+      {
+      EntryListType::iterator next = it;
+      ++next;
+      if( it->PixelContainer->GetReferenceCount() <= 1 )
+        {
+        ++m_Evictions;
+        this->Erase( it );
+        }
+      it = next;
+      }
+    }
+
+  MutexType          m_Mutex;
+  EntryListType      m_Entries;
+  size_t             m_Budget;
+  size_t             m_Size;
+  unsigned long long m_Hits;
+  unsigned long long m_Misses;
+  unsigned long long m_Evictions;
+};
+
+} // end anonymous namespace
+
+/** Returns the read only array of an image from the conversion cache. */
+static PyObject *
+sitk_GetCachedArrayFromImage( PyObject *SWIGUNUSEDPARM(self), PyObject *args )
+{
+  PyObject *          pyImage;
+  void *              voidImage;
+  int                 res       = 0;
+  const sitk::Image * sitkImage;
+  const sitk::PixelIDDispatchEntry * entry;
+
+  if( !PyArg_ParseTuple( args, "O", &pyImage ) )
+    {
+    SWIG_fail;
+    }
+  res = SWIG_ConvertPtr( pyImage, &voidImage, SWIGTYPE_p_itk__simple__Image, 0 );
+  if( !SWIG_IsOK( res ) )
+    {
+    SWIG_exception_fail(SWIG_ArgError(res), "in method 'GetCachedArrayFromImage', argument needs to be of type 'sitk::Image *'");
+    }
+  sitkImage = reinterpret_cast< sitk::Image * >( voidImage );
+
+  entry = sitk_GetPixelIDDispatchEntry( sitkImage->GetPixelIDValue(), sitkImage->GetDimension() );
+  if( !entry )
+    {
+    SWIG_fail;
+    }
+  return sitk_ConversionCache::GetInstance().GetArray( pyImage, *sitkImage, *entry );
+
+fail:
+  return NULL;
+}
+
+/** Modifies the pixel container of an image which is written without
+ * the conversions, e.g. by SetPixel, so that its cached array is a miss. */
+static PyObject *
+sitk_InvalidateCachedArray( PyObject *SWIGUNUSEDPARM(self), PyObject *args )
+{
+  PyObject *          pyImage;
+  void *              voidImage;
+  int                 res       = 0;
+  const sitk::Image * sitkImage;
+  const sitk::PixelIDDispatchEntry * entry;
+
+  if( !PyArg_ParseTuple( args, "O", &pyImage ) )
+    {
+    SWIG_fail;
+    }
+  res = SWIG_ConvertPtr( pyImage, &voidImage, SWIGTYPE_p_itk__simple__Image, 0 );
+  if( !SWIG_IsOK( res ) )
+    {
+    SWIG_exception_fail(SWIG_ArgError(res), "in method 'InvalidateCachedArray', argument needs to be of type 'sitk::Image *'");
+    }
+  sitkImage = reinterpret_cast< sitk::Image * >( voidImage );
+
+  entry = sitk_GetPixelIDDispatchEntry( sitkImage->GetPixelIDValue(), sitkImage->GetDimension() );
+  if( !entry )
+    {
+    SWIG_fail;
+    }
+  entry->GetPixelContainer( *sitkImage )->Modified();
+  Py_RETURN_NONE;
+
+fail:
+  return NULL;
+}
+
+/** Sets the budget of the conversion cache in bytes, 0 disables it. */
+static PyObject *
+sitk_SetConversionCacheBudget( PyObject *SWIGUNUSEDPARM(self), PyObject *args )
+{
+  Py_ssize_t budget = 0;
+
+  if( !PyArg_ParseTuple( args, "n", &budget ) )
+    {
+    return NULL;
+    }
+  if( budget < 0 )
+    {
+    PyErr_SetString( PyExc_ValueError, "The conversion cache budget must not be negative." );
+    return NULL;
+    }
+  sitk_ConversionCache::GetInstance().SetBudget( static_cast< size_t >( budget ) );
+  Py_RETURN_NONE;
+}
+
+static PyObject *
+sitk_GetConversionCacheStatistics( PyObject *SWIGUNUSEDPARM(self), PyObject *SWIGUNUSEDPARM(args) )
+{
+  return sitk_ConversionCache::GetInstance().GetStatistics();
+}
+
+static PyObject *
+sitk_ClearConversionCache( PyObject *SWIGUNUSEDPARM(self), PyObject *SWIGUNUSEDPARM(args) )
+{
+  sitk_ConversionCache::GetInstance().Clear();
+  Py_RETURN_NONE;
+}
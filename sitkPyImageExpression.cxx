@@ -0,0 +1,238 @@
+/*=========================================================================
+*
+*  Copyright Insight Software Consortium
+*
+*  Licensed under the Apache License, Version 2.0 (the "License");
+*  you may not use this file except in compliance with the License.
+*  You may obtain a copy of the License at
+*
+*         http://www.apache.org/licenses/LICENSE-2.0.txt
+*
+*  Unless required by applicable law or agreed to in writing, software
+*  distributed under the License is distributed on an "AS IS" BASIS,
+*  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+*  See the License for the specific language governing permissions and
+*  limitations under the License.
+*
+*=========================================================================*/
+#include <vector>
+
+#include "sitkImage.h"
+#include "sitkImageExpression.h"
+
+// This file is included inline after sitkNumpyArrayConversion.cxx, whose
+// sitk_GetPixelIDDispatchEntry is used.
+
+/** An internal function which evaluates a lazy image expression in a
+ * single fused pass over the input images.
+ *
+ * The program is a sequence of ( name, pixelID, operand ) tuples in
+ * postfix order. The name is "Image", "Constant" or the name of the
+ * SimpleITK filter of the operation, the pixelID is the pixel type of
+ * the result of the instruction, or of the image or constant, and the
+ * operand is the index of the image in the sequence of images, or the
+ * value of the constant. The result is a new image with the geometry
+ * of the first image or, if an output image is given, it is written
+ * into the pixel buffer of the output image, which may be one of the
+ * images.
+ */
+static PyObject *
+sitk_EvaluateImageExpression( PyObject *SWIGUNUSEDPARM(self), PyObject *args )
+{
+  PyObject *                  pyProgram;
+  PyObject *                  pyImages;
+  PyObject *                  pyOutput      = NULL;
+  PyObject *                  programSeq    = NULL;
+  PyObject *                  imagesSeq     = NULL;
+  void *                      voidImage;
+  int                         res           = 0;
+
+  std::vector< sitk::Image * > inputs;
+  std::vector< unsigned int >  size;
+  unsigned int                 dimension    = 0;
+  size_t                       numberOfPixels = 1;
+  int                          resultPixelID = sitk::sitkUnknown;
+  sitk::ImageExpression        expression;
+  sitk::Image *                sitkImage    = NULL;
+  sitk::Image *                outputImage  = NULL;
+  void *                       outputBuffer;
+
+  if( !PyArg_ParseTuple( args, "OO|O", &pyProgram, &pyImages, &pyOutput ) )
+    {
+    SWIG_fail;
+    }
+  programSeq = PySequence_Fast( pyProgram, "expected a sequence of instructions" );
+  imagesSeq  = programSeq ? PySequence_Fast( pyImages, "expected a sequence of images" ) : NULL;
+  if( !imagesSeq )
+    {
+    SWIG_fail;
+    }
+  if( PySequence_Fast_GET_SIZE( imagesSeq ) == 0 )
+    {
+    PyErr_SetString( PyExc_ValueError, "An image expression needs at least one image." );
+    SWIG_fail;
+    }
+
+  for( Py_ssize_t i = 0; i < PySequence_Fast_GET_SIZE( imagesSeq ); ++i )
+    {
+    res = SWIG_ConvertPtr( PySequence_Fast_GET_ITEM( imagesSeq, i ), &voidImage, SWIGTYPE_p_itk__simple__Image, 0 );
+    if( !SWIG_IsOK( res ) )
+      {
+      SWIG_exception_fail(SWIG_ArgError(res), "in method 'EvaluateImageExpression', the images need to be of type 'sitk::Image *'");
+      }
+    inputs.push_back( reinterpret_cast< sitk::Image * >( voidImage ) );
+
+    if( inputs.back()->GetNumberOfComponentsPerPixel() != 1 )
+      {
+      PyErr_SetString( PyExc_ValueError, "Only scalar images are supported in image expressions." );
+      SWIG_fail;
+      }
+    if( i == 0 )
+      {
+      size      = inputs[0]->GetSize();
+      dimension = inputs[0]->GetDimension();
+      }
+    else if( inputs.back()->GetSize() != size )
+      {
+      PyErr_SetString( PyExc_ValueError, "The images of an image expression must have the same size." );
+      SWIG_fail;
+      }
+    }
+
+  for( Py_ssize_t p = 0; p < PySequence_Fast_GET_SIZE( programSeq ); ++p )
+    {
+    const char *                      name;
+    int                               pixelID;
+    PyObject *                        operand;
+    sitk::ImageExpression::Instruction instruction;
+
+    if( !PyArg_ParseTuple( PySequence_Fast_GET_ITEM( programSeq, p ), "siO", &name, &pixelID, &operand ) )
+      {
+      SWIG_fail;
+      }
+    if( !sitk::ImageExpression::GetOpcode( name, instruction.Opcode ) )
+      {
+      PyErr_Format( PyExc_ValueError, "Unknown image expression operation \"%s\".", name );
+      SWIG_fail;
+      }
+    instruction.Entry    = sitk_GetPixelIDDispatchEntry( pixelID, dimension );
+    instruction.Input    = 0;
+    instruction.Constant = 0.0;
+    if( !instruction.Entry )
+      {
+      SWIG_fail;
+      }
+
+    if( instruction.Opcode == sitk::ImageExpression::OpImage )
+      {
+      const long input = PyInt_AsLong( operand );
+      if( input < 0 || input >= static_cast< long >( inputs.size() )
+          || inputs[input]->GetPixelIDValue() != pixelID )
+        {
+        if( !PyErr_Occurred() )
+          {
+          PyErr_SetString( PyExc_ValueError, "Invalid image in image expression." );
+          }
+        SWIG_fail;
+        }
+      instruction.Input = static_cast< unsigned int >( input );
+      }
+    else if( instruction.Opcode == sitk::ImageExpression::OpConstant )
+      {
+      instruction.Constant = PyFloat_AsDouble( operand );
+      if( PyErr_Occurred() )
+        {
+        SWIG_fail;
+        }
+      }
+
+    if( !expression.AddInstruction( instruction ) )
+      {
+      PyErr_SetString( PyExc_ValueError, "Invalid image expression." );
+      SWIG_fail;
+      }
+    resultPixelID = pixelID;
+    }
+
+  if( PySequence_Fast_GET_SIZE( programSeq ) == 0 || !expression.IsComplete() )
+    {
+    PyErr_SetString( PyExc_ValueError, "Invalid image expression." );
+    SWIG_fail;
+    }
+
+  if( pyOutput && pyOutput != Py_None )
+    {
+    res = SWIG_ConvertPtr( pyOutput, &voidImage, SWIGTYPE_p_itk__simple__Image, 0 );
+    if( !SWIG_IsOK( res ) )
+      {
+      SWIG_exception_fail(SWIG_ArgError(res), "in method 'EvaluateImageExpression', the output needs to be of type 'sitk::Image *'");
+      }
+    outputImage = reinterpret_cast< sitk::Image * >( voidImage );
+    if( outputImage->GetPixelIDValue() != resultPixelID
+        || outputImage->GetNumberOfComponentsPerPixel() != 1
+        || outputImage->GetSize() != size )
+      {
+      PyErr_SetString( PyExc_ValueError, "The output image does not match the result of the image expression." );
+      SWIG_fail;
+      }
+    }
+
+  try
+    {
+    if( outputImage )
+      {
+      // the buffer is only copied if it is shared with another image
+      outputBuffer = expression.GetResultEntry()->GetBuffer( *outputImage );
+      }
+    else
+      {
+      sitkImage = new sitk::Image( size, static_cast< sitk::PixelIDValueEnum >( resultPixelID ) );
+      sitkImage->SetOrigin( inputs[0]->GetOrigin() );
+      sitkImage->SetSpacing( inputs[0]->GetSpacing() );
+      sitkImage->SetDirection( inputs[0]->GetDirection() );
+      outputBuffer = expression.GetResultEntry()->GetBuffer( *sitkImage );
+      }
+    }
+  catch( const std::exception &e )
+    {
+    std::string msg = "Exception thrown in SimpleITK new Image: ";
+    msg += e.what();
+    PyErr_SetString( PyExc_RuntimeError, msg.c_str() );
+    SWIG_fail;
+    }
+
+  // the input buffers are taken after the output buffer was made unique,
+  // as the output may be one of the inputs
+  for( size_t i = 0; i < inputs.size(); ++i )
+    {
+    const sitk::PixelIDDispatchEntry * entry = sitk_GetPixelIDDispatchEntry( inputs[i]->GetPixelIDValue(), dimension );
+    if( !entry )
+      {
+      SWIG_fail;
+      }
+    expression.SetInput( static_cast< unsigned int >( i ), entry->GetConstBuffer( *inputs[i] ) );
+    }
+
+  for( size_t d = 0; d < size.size(); ++d )
+    {
+    numberOfPixels *= size[d];
+    }
+
+  Py_BEGIN_ALLOW_THREADS
+  expression.Evaluate( outputBuffer, numberOfPixels );
+  Py_END_ALLOW_THREADS
+
+  Py_DECREF( programSeq );
+  Py_DECREF( imagesSeq );
+  if( outputImage )
+    {
+    Py_RETURN_NONE;
+    }
+  return SWIG_NewPointerObj( sitkImage, SWIGTYPE_p_itk__simple__Image, SWIG_POINTER_OWN | 0 );
+
+fail:
+  delete sitkImage;
+  Py_XDECREF( programSeq );
+  Py_XDECREF( imagesSeq );
+  return NULL;
+}
@@ -0,0 +1,244 @@
+/*=========================================================================
+*
+*  Copyright Insight Software Consortium
+*
+*  Licensed under the Apache License, Version 2.0 (the "License");
+*  you may not use this file except in compliance with the License.
+*  You may obtain a copy of the License at
+*
+*         http://www.apache.org/licenses/LICENSE-2.0.txt
+*
+*  Unless required by applicable law or agreed to in writing, software
+*  distributed under the License is distributed on an "AS IS" BASIS,
+*  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+*  See the License for the specific language governing permissions and
+*  limitations under the License.
+*
+*=========================================================================*/
+#include "sitkRunLengthEncoding.h"
+
+// This file is included inline after sitkNumpyArrayConversion.cxx, whose
+// sitk_NewNumPyArray is used.
+
+template< typename TLabel >
+static PyObject *
+sitk_EncodeRunLengthArray( PyArrayObject *array, size_t numberOfRows, size_t rowLength )
+{
+  typedef sitk::RunLengthEncoding< TLabel > EncodingType;
+
+  const TLabel *  buffer     = static_cast< const TLabel * >( PyArray_DATA( array ) );
+  PyArrayObject * rowOffsets = NULL;
+  PyArrayObject * starts     = NULL;
+  PyArrayObject * lengths    = NULL;
+  PyArrayObject * labels     = NULL;
+  npy_intp        dims[1];
+  typename EncodingType::OffsetType numberOfRuns;
+
+  dims[0] = static_cast< npy_intp >( numberOfRows + 1 );
+  rowOffsets = sitk_NewNumPyArray( NPY_INT64, 1, dims );
+  if( !rowOffsets )
+    {
+    return NULL;
+    }
+  typename EncodingType::OffsetType * offsets = static_cast< typename EncodingType::OffsetType * >( PyArray_DATA( rowOffsets ) );
+
+  Py_BEGIN_ALLOW_THREADS
+  numberOfRuns = EncodingType::CountRuns( buffer, numberOfRows, rowLength, offsets );
+  Py_END_ALLOW_THREADS
+
+  dims[0] = static_cast< npy_intp >( numberOfRuns );
+  starts  = sitk_NewNumPyArray( NPY_UINT32, 1, dims );
+  lengths = starts ? sitk_NewNumPyArray( NPY_UINT32, 1, dims ) : NULL;
+  labels  = lengths ? sitk_NewNumPyArray( PyArray_TYPE( array ), 1, dims ) : NULL;
+  if( !labels )
+    {
+    Py_DECREF( rowOffsets );
+    Py_XDECREF( starts );
+    Py_XDECREF( lengths );
+    return NULL;
+    }
+
+  Py_BEGIN_ALLOW_THREADS
+  EncodingType::Encode( buffer, numberOfRows, rowLength, offsets,
+                        static_cast< typename EncodingType::RunType * >( PyArray_DATA( starts ) ),
+                        static_cast< typename EncodingType::RunType * >( PyArray_DATA( lengths ) ),
+                        static_cast< TLabel * >( PyArray_DATA( labels ) ) );
+  Py_END_ALLOW_THREADS
+
+  return Py_BuildValue( "NNNN", rowOffsets, starts, lengths, labels );
+}
+
+template< typename TLabel >
+static void
+sitk_DecodeRunLengthArray( PyArrayObject *rowOffsets, PyArrayObject *starts, PyArrayObject *lengths,
+                           PyArrayObject *labels, size_t rowBegin, size_t rowEnd, size_t rowLength,
+                           PyArrayObject *output )
+{
+  typedef sitk::RunLengthEncoding< TLabel > EncodingType;
+
+  Py_BEGIN_ALLOW_THREADS
+  EncodingType::Decode( static_cast< const typename EncodingType::OffsetType * >( PyArray_DATA( rowOffsets ) ),
+                        static_cast< const typename EncodingType::RunType * >( PyArray_DATA( starts ) ),
+                        static_cast< const typename EncodingType::RunType * >( PyArray_DATA( lengths ) ),
+                        static_cast< const TLabel * >( PyArray_DATA( labels ) ),
+                        rowBegin, rowEnd, rowLength,
+                        static_cast< TLabel * >( PyArray_DATA( output ) ) );
+  Py_END_ALLOW_THREADS
+}
+
+/** An internal function which run length encodes the rows of a label
+ * array, whose last axis is the fastest. It returns the arrays of the
+ * row offsets, and of the starts, lengths and labels of the runs.
+ */
+static PyObject *
+sitk_EncodeRunLength( PyObject *SWIGUNUSEDPARM(self), PyObject *args )
+{
+  PyObject *      pyArray;
+  PyArrayObject * array     = NULL;
+  PyObject *      result    = NULL;
+  Py_ssize_t      rowLength = 0;
+  size_t          numberOfRows;
+
+  if( !PyArg_ParseTuple( args, "On", &pyArray, &rowLength ) )
+    {
+    SWIG_fail;
+    }
+  // the labels are compared and copied in native byte order
+  array = reinterpret_cast< PyArrayObject * >(
+    PyArray_CheckFromAny( pyArray, NULL, 0, 0, NPY_ARRAY_CARRAY_RO | NPY_ARRAY_NOTSWAPPED, NULL ) );
+  if( !array )
+    {
+    SWIG_fail;
+    }
+  if( rowLength <= 0 || static_cast< unsigned long long >( rowLength ) > 0xffffffffULL || PyArray_SIZE( array ) % rowLength != 0 )
+    {
+    PyErr_SetString( PyExc_ValueError, "The row length does not match the label array." );
+    SWIG_fail;
+    }
+  numberOfRows = static_cast< size_t >( PyArray_SIZE( array ) / rowLength );
+
+  switch( PyArray_TYPE( array ) )
+    {
+    case NPY_BOOL:      result = sitk_EncodeRunLengthArray< npy_bool >( array, numberOfRows, rowLength ); break;
+    case NPY_BYTE:      result = sitk_EncodeRunLengthArray< npy_byte >( array, numberOfRows, rowLength ); break;
+    case NPY_UBYTE:     result = sitk_EncodeRunLengthArray< npy_ubyte >( array, numberOfRows, rowLength ); break;
+    case NPY_SHORT:     result = sitk_EncodeRunLengthArray< npy_short >( array, numberOfRows, rowLength ); break;
+    case NPY_USHORT:    result = sitk_EncodeRunLengthArray< npy_ushort >( array, numberOfRows, rowLength ); break;
+    case NPY_INT:       result = sitk_EncodeRunLengthArray< npy_int >( array, numberOfRows, rowLength ); break;
+    case NPY_UINT:      result = sitk_EncodeRunLengthArray< npy_uint >( array, numberOfRows, rowLength ); break;
+    case NPY_LONG:      result = sitk_EncodeRunLengthArray< npy_long >( array, numberOfRows, rowLength ); break;
+    case NPY_ULONG:     result = sitk_EncodeRunLengthArray< npy_ulong >( array, numberOfRows, rowLength ); break;
+    case NPY_LONGLONG:  result = sitk_EncodeRunLengthArray< npy_longlong >( array, numberOfRows, rowLength ); break;
+    case NPY_ULONGLONG: result = sitk_EncodeRunLengthArray< npy_ulonglong >( array, numberOfRows, rowLength ); break;
+    default:
+      PyErr_SetString( PyExc_TypeError, "Only arrays of integer labels can be run length encoded." );
+      SWIG_fail;
+    }
+
+  Py_DECREF( array );
+  return result;
+
+fail:
+  Py_XDECREF( array );
+  return NULL;
+}
+
+/** An internal function which decodes the rows [rowBegin, rowEnd) of a
+ * run length encoding into a writable array, e.g. the array view of an
+ * image, of the type of the labels.
+ */
+static PyObject *
+sitk_DecodeRunLength( PyObject *SWIGUNUSEDPARM(self), PyObject *args )
+{
+  PyObject *      pyRowOffsets;
+  PyObject *      pyStarts;
+  PyObject *      pyLengths;
+  PyObject *      pyLabels;
+  PyObject *      pyOutput;
+  Py_ssize_t      rowBegin   = 0;
+  Py_ssize_t      rowEnd     = 0;
+  PyArrayObject * rowOffsets = NULL;
+  PyArrayObject * starts     = NULL;
+  PyArrayObject * lengths    = NULL;
+  PyArrayObject * labels     = NULL;
+  PyArrayObject * output;
+  npy_intp        numberOfRuns;
+  const npy_int64 * offsets;
+  size_t          rowLength;
+
+  if( !PyArg_ParseTuple( args, "OOOOOnn", &pyRowOffsets, &pyStarts, &pyLengths, &pyLabels, &pyOutput, &rowBegin, &rowEnd ) )
+    {
+    SWIG_fail;
+    }
+  rowOffsets = reinterpret_cast< PyArrayObject * >( PyArray_FROMANY( pyRowOffsets, NPY_INT64, 1, 1, NPY_ARRAY_CARRAY_RO ) );
+  starts     = rowOffsets ? reinterpret_cast< PyArrayObject * >( PyArray_FROMANY( pyStarts, NPY_UINT32, 1, 1, NPY_ARRAY_CARRAY_RO ) ) : NULL;
+  lengths    = starts ? reinterpret_cast< PyArrayObject * >( PyArray_FROMANY( pyLengths, NPY_UINT32, 1, 1, NPY_ARRAY_CARRAY_RO ) ) : NULL;
+  labels     = lengths ? reinterpret_cast< PyArrayObject * >( PyArray_CheckFromAny( pyLabels, NULL, 1, 1, NPY_ARRAY_CARRAY_RO | NPY_ARRAY_NOTSWAPPED, NULL ) ) : NULL;
+  if( !labels )
+    {
+    SWIG_fail;
+    }
+  if( !PyArray_Check( pyOutput ) )
+    {
+    PyErr_SetString( PyExc_TypeError, "The output needs to be a NumPy array." );
+    SWIG_fail;
+    }
+  output = reinterpret_cast< PyArrayObject * >( pyOutput );
+  if( !PyArray_ISCARRAY( output ) || PyArray_TYPE( output ) != PyArray_TYPE( labels ) )
+    {
+    PyErr_SetString( PyExc_ValueError, "The output needs to be a writable, contiguous array of the type of the labels." );
+    SWIG_fail;
+    }
+
+  numberOfRuns = PyArray_DIM( labels, 0 );
+  if( rowBegin < 0 || rowEnd <= rowBegin || rowEnd >= PyArray_DIM( rowOffsets, 0 )
+      || PyArray_DIM( starts, 0 ) != numberOfRuns || PyArray_DIM( lengths, 0 ) != numberOfRuns
+      || PyArray_SIZE( output ) % ( rowEnd - rowBegin ) != 0 )
+    {
+    PyErr_SetString( PyExc_ValueError, "The run length encoding does not match the output." );
+    SWIG_fail;
+    }
+  rowLength = static_cast< size_t >( PyArray_SIZE( output ) / ( rowEnd - rowBegin ) );
+
+  // the offsets of the decoded rows must index the runs
+  offsets = static_cast< const npy_int64 * >( PyArray_DATA( rowOffsets ) );
+  for( Py_ssize_t r = rowBegin; r < rowEnd; ++r )
+    {
+    if( offsets[r] < 0 || offsets[r+1] < offsets[r] || offsets[r+1] > numberOfRuns )
+      {
+      PyErr_SetString( PyExc_ValueError, "Invalid row offsets of the run length encoding." );
+      SWIG_fail;
+      }
+    }
+
+  switch( PyArray_TYPE( labels ) )
+    {
+    case NPY_BOOL:      sitk_DecodeRunLengthArray< npy_bool >( rowOffsets, starts, lengths, labels, rowBegin, rowEnd, rowLength, output ); break;
+    case NPY_BYTE:      sitk_DecodeRunLengthArray< npy_byte >( rowOffsets, starts, lengths, labels, rowBegin, rowEnd, rowLength, output ); break;
+    case NPY_UBYTE:     sitk_DecodeRunLengthArray< npy_ubyte >( rowOffsets, starts, lengths, labels, rowBegin, rowEnd, rowLength, output ); break;
+    case NPY_SHORT:     sitk_DecodeRunLengthArray< npy_short >( rowOffsets, starts, lengths, labels, rowBegin, rowEnd, rowLength, output ); break;
+    case NPY_USHORT:    sitk_DecodeRunLengthArray< npy_ushort >( rowOffsets, starts, lengths, labels, rowBegin, rowEnd, rowLength, output ); break;
+    case NPY_INT:       sitk_DecodeRunLengthArray< npy_int >( rowOffsets, starts, lengths, labels, rowBegin, rowEnd, rowLength, output ); break;
+    case NPY_UINT:      sitk_DecodeRunLengthArray< npy_uint >( rowOffsets, starts, lengths, labels, rowBegin, rowEnd, rowLength, output ); break;
+    case NPY_LONG:      sitk_DecodeRunLengthArray< npy_long >( rowOffsets, starts, lengths, labels, rowBegin, rowEnd, rowLength, output ); break;
+    case NPY_ULONG:     sitk_DecodeRunLengthArray< npy_ulong >( rowOffsets, starts, lengths, labels, rowBegin, rowEnd, rowLength, output ); break;
+    case NPY_LONGLONG:  sitk_DecodeRunLengthArray< npy_longlong >( rowOffsets, starts, lengths, labels, rowBegin, rowEnd, rowLength, output ); break;
+    case NPY_ULONGLONG: sitk_DecodeRunLengthArray< npy_ulonglong >( rowOffsets, starts, lengths, labels, rowBegin, rowEnd, rowLength, output ); break;
+    default:
+      PyErr_SetString( PyExc_TypeError, "Only integer labels can be run length decoded." );
+      SWIG_fail;
+    }
+
+  Py_DECREF( rowOffsets );
+  Py_DECREF( starts );
+  Py_DECREF( lengths );
+  Py_DECREF( labels );
+  Py_RETURN_NONE;
+
+fail:
+  Py_XDECREF( rowOffsets );
+  Py_XDECREF( starts );
+  Py_XDECREF( lengths );
+  Py_XDECREF( labels );
+  return NULL;
+}
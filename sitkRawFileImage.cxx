@@ -0,0 +1,366 @@
+/*=========================================================================
+*
+*  Copyright Insight Software Consortium
+*
+*  Licensed under the Apache License, Version 2.0 (the "License");
+*  you may not use this file except in compliance with the License.
+*  You may obtain a copy of the License at
+*
+*         http://www.apache.org/licenses/LICENSE-2.0.txt
+*
+*  Unless required by applicable law or agreed to in writing, software
+*  distributed under the License is distributed on an "AS IS" BASIS,
+*  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+*  See the License for the specific language governing permissions and
+*  limitations under the License.
+*
+*=========================================================================*/
+#include "sitkRawFileImage.h"
+#include "sitkPixelIDDispatchTable.h"
+#include "sitkParallelFor.h"
+#include "sitkMacro.h"
+
+#include "itkCommand.h"
+#include "itkSimpleFastMutexLock.h"
+#include "itkMutexLockHolder.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+
+#ifndef _WIN32
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+namespace itk
+{
+namespace simple
+{
+
+#ifndef _WIN32
+
+namespace
+{
+
+/** \class RawFileBufferCommand
+ * \brief Releases the buffer of a raw file image, allocated or memory
+ * mapped, when the pixel container which uses it is deleted.
+ */
+class RawFileBufferCommand
+  : public ::itk::Command
+{
+public:
+  typedef RawFileBufferCommand Self;
+  typedef ::itk::Command       Superclass;
+  typedef SmartPointer< Self > Pointer;
+
+  itkNewMacro( Self );
+
+  void SetAllocatedBuffer( void * buffer )
+    {
+    m_Address = buffer;
+    m_Length  = 0;
+    }
+
+  void SetMappedBuffer( void * address, size_t length )
+    {
+    m_Address = address;
+    m_Length  = length;
+    }
+
+  virtual void Execute( ::itk::Object *, const EventObject & )
+    {
+    this->Release();
+    }
+
+  virtual void Execute( const ::itk::Object *, const EventObject & )
+    {
+    this->Release();
+    }
+
+protected:
+  RawFileBufferCommand( void ) : m_Address( NULL ), m_Length( 0 ) {}
+
+  // the buffer is released even if the command was never attached
+  ~RawFileBufferCommand( void )
+    {
+    this->Release();
+    }
+
+private:
+  RawFileBufferCommand( const Self & );
+  void operator=( const Self & );
+
+  void Release( void )
+    {
+    if( !m_Address )
+      {
+      return;
+      }
+    if( m_Length )
+      {
+      munmap( m_Address, m_Length );
+      }
+    else
+      {
+      free( m_Address );
+      }
+    m_Address = NULL;
+    }
+
+  void * m_Address;
+  size_t m_Length;
+};
+
+bool IsBigEndian( void )
+{
+  const uint16_t one = 1;
+  return *reinterpret_cast< const unsigned char * >( &one ) == 0;
+}
+
+/** Reverses the bytes of each of n components. */
+void SwapComponentBytes( char * buffer, size_t n, size_t componentSize )
+{
+  for( size_t i = 0; i < n; ++i )
+    {
+    std::reverse( buffer + i * componentSize, buffer + ( i + 1 ) * componentSize );
+    }
+}
+
+/** \class RawFileReadFunction
+ * \brief Reads chunks of the components of a raw file into an image
+ * buffer, with pread, swapping and converting each chunk after it is
+ * read while it is in the cache. For ParallelFor.
+ */
+class RawFileReadFunction
+{
+public:
+  /** The number of components of a chunk. */
+  enum { ChunkSize = 1 << 20 };
+
+  RawFileReadFunction( int fd, uint64_t offset,
+                       const PixelIDDispatchEntry & fileEntry,
+                       const PixelIDDispatchEntry & imageEntry,
+                       bool convert, bool swap,
+                       char * destination, size_t numberOfComponents )
+    : m_FileDescriptor( fd ), m_Offset( offset ),
+      m_FileEntry( fileEntry ), m_ImageEntry( imageEntry ),
+      m_Convert( convert ), m_Swap( swap ),
+      m_Destination( destination ), m_NumberOfComponents( numberOfComponents ),
+      m_Error( 0 ) {}
+
+  size_t GetNumberOfChunks( void ) const
+    {
+    return ( m_NumberOfComponents + ChunkSize - 1 ) / ChunkSize;
+    }
+
+  /** Returns the errno of the first failed read, or -1 if the file
+   * ended early, 0 on success. */
+  int GetError( void ) const
+    {
+    return m_Error;
+    }
+
+  void operator()( size_t beginChunk, size_t endChunk )
+    {
+    const size_t fileComponentSize = m_FileEntry.ComponentSize;
+    std::vector< char > fileBuffer;
+
+    for( size_t chunk = beginChunk; chunk < endChunk; ++chunk )
+      {
+      const size_t first = chunk * ChunkSize;
+      const size_t n = std::min( size_t( ChunkSize ), m_NumberOfComponents - first );
+      const uint64_t position = m_Offset + uint64_t( first ) * fileComponentSize;
+
+      // the components are read in place, unless they are converted
+      char * buffer = m_Destination + first * fileComponentSize;
+      if( m_Convert )
+        {
+        fileBuffer.resize( n * fileComponentSize );
+        buffer = &fileBuffer[0];
+        }
+      if( !this->Read( buffer, n * fileComponentSize, position ) )
+        {
+        return;
+        }
+      if( m_Swap )
+        {
+        SwapComponentBytes( buffer, n, fileComponentSize );
+        }
+      if( m_Convert )
+        {
+        CastComponents( m_FileEntry, buffer, 0, m_ImageEntry, m_Destination, first, n );
+        }
+      }
+    }
+
+private:
+
+  bool Read( char * buffer, size_t bytes, uint64_t position )
+    {
+    while( bytes > 0 )
+      {
+      const ssize_t count = pread( m_FileDescriptor, buffer, bytes, static_cast< off_t >( position ) );
+      if( count < 0 && errno == EINTR )
+        {
+        continue;
+        }
+      if( count <= 0 )
+        {
+        this->SetError( count < 0 ? errno : -1 );
+        return false;
+        }
+      buffer   += count;
+      bytes    -= static_cast< size_t >( count );
+      position += static_cast< uint64_t >( count );
+      }
+    return true;
+    }
+
+  void SetError( int error )
+    {
+    MutexLockHolder< SimpleFastMutexLock > lock( m_Mutex );
+    if( !m_Error )
+      {
+      m_Error = error;
+      }
+    }
+
+  int                          m_FileDescriptor;
+  uint64_t                     m_Offset;
+  const PixelIDDispatchEntry & m_FileEntry;
+  const PixelIDDispatchEntry & m_ImageEntry;
+  bool                         m_Convert;
+  bool                         m_Swap;
+  char *                       m_Destination;
+  size_t                       m_NumberOfComponents;
+  int                          m_Error;
+  SimpleFastMutexLock          m_Mutex;
+};
+
+} // end anonymous namespace
+
+
+Image ImageFromRawFile( const std::string & path,
+                        const std::vector< unsigned int > & size,
+                        PixelIDValueEnum pixelID,
+                        unsigned int numberOfComponents,
+                        uint64_t offset,
+                        RawFileByteOrderEnum byteOrder,
+                        PixelIDValueEnum filePixelID,
+                        bool memoryMapped )
+{
+  const unsigned int dimension = static_cast< unsigned int >( size.size() );
+  const PixelIDDispatchEntry * entry = PixelIDDispatchTable::GetEntry( pixelID, dimension );
+  const PixelIDDispatchEntry * fileEntry = filePixelID == sitkUnknown ? entry : PixelIDDispatchTable::GetEntry( filePixelID, dimension );
+  if( !entry || !fileEntry )
+    {
+    sitkExceptionMacro( << "The pixel type or dimension is not supported for raw files." );
+    }
+
+  // the component types are equal if their limits are
+  const bool convert = fileEntry->ComponentSize != entry->ComponentSize
+    || fileEntry->ComponentIsInteger != entry->ComponentIsInteger
+    || fileEntry->ComponentMinimum != entry->ComponentMinimum;
+  const bool swap = byteOrder != RawFileNativeByteOrder
+    && ( byteOrder == RawFileBigEndian ) != IsBigEndian()
+    && fileEntry->ComponentSize > 1;
+
+  // a single pixel image of the type resolves the number of components
+  const Image reference( std::vector< unsigned int >( dimension, 1 ), pixelID, numberOfComponents );
+  const unsigned int components = reference.GetNumberOfComponentsPerPixel();
+  size_t totalComponents = components;
+  for( unsigned int d = 0; d < dimension; ++d )
+    {
+    totalComponents *= size[d];
+    }
+  const uint64_t fileBytes = uint64_t( totalComponents ) * fileEntry->ComponentSize;
+
+  if( memoryMapped && ( convert || swap || offset % entry->ComponentSize != 0 ) )
+    {
+    sitkExceptionMacro( << "A memory mapped raw file must have the component type and byte order of the image, "
+                        << "at an offset which is a multiple of the component size." );
+    }
+
+  const int fd = open( path.c_str(), O_RDONLY );
+  if( fd == -1 )
+    {
+    sitkExceptionMacro( << "Unable to open the raw file \"" << path << "\": " << strerror( errno ) );
+    }
+  struct stat status;
+  if( fstat( fd, &status ) != 0 || uint64_t( status.st_size ) < offset + fileBytes )
+    {
+    close( fd );
+    sitkExceptionMacro( << "The raw file \"" << path << "\" is smaller than " << offset + fileBytes << " bytes." );
+    }
+
+  RawFileBufferCommand::Pointer command = RawFileBufferCommand::New();
+  char * buffer = NULL;
+
+  if( memoryMapped )
+    {
+    const uint64_t pageSize = static_cast< uint64_t >( sysconf( _SC_PAGESIZE ) );
+    const uint64_t mapOffset = offset / pageSize * pageSize;
+    const size_t length = static_cast< size_t >( fileBytes + ( offset - mapOffset ) );
+
+    // private pages, writes to the image are not written to the file
+    void * address = mmap( NULL, std::max( length, size_t( 1 ) ), PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, static_cast< off_t >( mapOffset ) );
+    const int error = errno;
+    close( fd );
+    if( address == MAP_FAILED )
+      {
+      sitkExceptionMacro( << "Unable to map the raw file \"" << path << "\": " << strerror( error ) );
+      }
+    command->SetMappedBuffer( address, std::max( length, size_t( 1 ) ) );
+    buffer = static_cast< char * >( address ) + ( offset - mapOffset );
+    }
+  else
+    {
+    buffer = static_cast< char * >( malloc( std::max( totalComponents * entry->ComponentSize, size_t( 1 ) ) ) );
+    if( !buffer )
+      {
+      close( fd );
+      sitkExceptionMacro( << "Unable to allocate the buffer of the raw file \"" << path << "\"." );
+      }
+    command->SetAllocatedBuffer( buffer );
+
+    RawFileReadFunction function( fd, offset, *fileEntry, *entry, convert, swap, buffer, totalComponents );
+    ParallelFor( function.GetNumberOfChunks(), 1, function );
+    close( fd );
+    if( function.GetError() )
+      {
+      // the buffer is freed with the command
+      sitkExceptionMacro( << "Unable to read the raw file \"" << path << "\": "
+                          << ( function.GetError() > 0 ? strerror( function.GetError() ) : "unexpected end of file" ) );
+      }
+    }
+
+  Image * sitkImage = entry->ImportBuffer( buffer, size, components, command.GetPointer() );
+  Image image( *sitkImage );
+  delete sitkImage;
+  return image;
+}
+
+#else
+
+Image ImageFromRawFile( const std::string &,
+                        const std::vector< unsigned int > &,
+                        PixelIDValueEnum,
+                        unsigned int,
+                        uint64_t,
+                        RawFileByteOrderEnum,
+                        PixelIDValueEnum,
+                        bool )
+{
+  sitkExceptionMacro( << "Raw file images are not supported on this platform." );
+}
+
+#endif
+
+} // namespace simple
+} // namespace itk
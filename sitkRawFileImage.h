@@ -0,0 +1,74 @@
+/*=========================================================================
+*
+*  Copyright Insight Software Consortium
+*
+*  Licensed under the Apache License, Version 2.0 (the "License");
+*  you may not use this file except in compliance with the License.
+*  You may obtain a copy of the License at
+*
+*         http://www.apache.org/licenses/LICENSE-2.0.txt
+*
+*  Unless required by applicable law or agreed to in writing, software
+*  distributed under the License is distributed on an "AS IS" BASIS,
+*  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+*  See the License for the specific language governing permissions and
+*  limitations under the License.
+*
+*=========================================================================*/
+#ifndef __sitkRawFileImage_h
+#define __sitkRawFileImage_h
+
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+
+#include "sitkImage.h"
+#include "sitkPixelIDValues.h"
+
+namespace itk
+{
+namespace simple
+{
+
+/** The byte order of the components in a raw file. */
+enum RawFileByteOrderEnum
+{
+  RawFileNativeByteOrder = 0,
+  RawFileLittleEndian    = 1,
+  RawFileBigEndian       = 2
+};
+
+/** \brief Reads an image from a headerless raw file.
+ *
+ * The file has the pixels at offset bytes, in the order of the image
+ * buffer, x the fastest and the components of a pixel consecutive.
+ * The components are read with parallel pread calls straight into the
+ * pixel buffer of the new image. Byte swapping, and the conversion of
+ * the component type of filePixelID to the one of pixelID, are done
+ * in the same pass as the read. A filePixelID of sitkUnknown is the
+ * component type of pixelID.
+ *
+ * With memoryMapped, the image buffer is a private memory map of the
+ * file, whose pages are read on demand. Writes to the image are not
+ * written to the file. A memory mapped file can not be byte swapped
+ * or converted.
+ *
+ * For a vector pixel type, a numberOfComponents of 0 is the image
+ * dimension, as in the Image constructor. The image has the default
+ * origin, spacing and direction. Raw file images are not supported
+ * on Windows.
+ */
+Image ImageFromRawFile( const std::string & path,
+                        const std::vector< unsigned int > & size,
+                        PixelIDValueEnum pixelID,
+                        unsigned int numberOfComponents = 0,
+                        uint64_t offset = 0,
+                        RawFileByteOrderEnum byteOrder = RawFileNativeByteOrder,
+                        PixelIDValueEnum filePixelID = sitkUnknown,
+                        bool memoryMapped = false );
+
+} // namespace simple
+} // namespace itk
+
+#endif // __sitkRawFileImage_h
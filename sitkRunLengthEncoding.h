@@ -0,0 +1,213 @@
+/*=========================================================================
+*
+*  Copyright Insight Software Consortium
+*
+*  Licensed under the Apache License, Version 2.0 (the "License");
+*  you may not use this file except in compliance with the License.
+*  You may obtain a copy of the License at
+*
+*         http://www.apache.org/licenses/LICENSE-2.0.txt
+*
+*  Unless required by applicable law or agreed to in writing, software
+*  distributed under the License is distributed on an "AS IS" BASIS,
+*  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+*  See the License for the specific language governing permissions and
+*  limitations under the License.
+*
+*=========================================================================*/
+#ifndef __sitkRunLengthEncoding_h
+#define __sitkRunLengthEncoding_h
+
+#include <stdint.h>
+
+#include <algorithm>
+
+#include "sitkParallelFor.h"
+
+namespace itk
+{
+namespace simple
+{
+
+/** \class RunLengthEncoding
+ *  \brief Run length encoding of label images along the rows of the
+ *  fastest axis.
+ *
+ * Each row is stored as the runs of equal, non zero labels, given by
+ * the start and length of the run in the row and its label. The runs
+ * of all rows are stored consecutively, the runs of row r are
+ * [ rowOffsets[r], rowOffsets[r+1] ). As the rows are indexed, any
+ * range of rows, e.g. a slice, is decoded without the others.
+ *
+ * Rows are encoded and decoded in parallel with the ITK threads.
+ */
+template< typename TLabel >
+class RunLengthEncoding
+{
+public:
+  typedef TLabel   LabelType;
+  typedef uint32_t RunType;
+  typedef int64_t  OffsetType;
+
+  /** Computes the rowOffsets, numberOfRows + 1 values, of the runs of
+   * a buffer of rows and returns the total number of runs. */
+  static OffsetType CountRuns( const LabelType * buffer,
+                               size_t numberOfRows,
+                               size_t rowLength,
+                               OffsetType * rowOffsets )
+    {
+    CountFunction function( buffer, rowLength, rowOffsets );
+    ParallelFor( numberOfRows, GetGrainSize( rowLength ), function );
+
+    // the number of runs of each row are accumulated into the offsets
+    rowOffsets[0] = 0;
+    for( size_t r = 0; r < numberOfRows; ++r )
+      {
+      rowOffsets[r+1] += rowOffsets[r];
+      }
+    return rowOffsets[numberOfRows];
+    }
+
+  /** Encodes the runs of the rows, with the rowOffsets computed by
+   * CountRuns. */
+  static void Encode( const LabelType * buffer,
+                      size_t numberOfRows,
+                      size_t rowLength,
+                      const OffsetType * rowOffsets,
+                      RunType * starts,
+                      RunType * lengths,
+                      LabelType * labels )
+    {
+    EncodeFunction function( buffer, rowLength, rowOffsets, starts, lengths, labels );
+    ParallelFor( numberOfRows, GetGrainSize( rowLength ), function );
+    }
+
+  /** Decodes the rows [rowBegin, rowEnd) into an output buffer of
+   * ( rowEnd - rowBegin ) * rowLength labels. Runs beyond the end of
+   * a row are clipped. */
+  static void Decode( const OffsetType * rowOffsets,
+                      const RunType * starts,
+                      const RunType * lengths,
+                      const LabelType * labels,
+                      size_t rowBegin,
+                      size_t rowEnd,
+                      size_t rowLength,
+                      LabelType * output )
+    {
+    DecodeFunction function( rowOffsets, starts, lengths, labels, rowBegin, rowLength, output );
+    ParallelFor( rowEnd - rowBegin, GetGrainSize( rowLength ), function );
+    }
+
+private:
+
+  // at least 64K labels per thread
+  static size_t GetGrainSize( size_t rowLength )
+    {
+    return std::max( size_t(1), size_t(65536) / std::max( rowLength, size_t(1) ) );
+    }
+
+  struct CountFunction
+  {
+    CountFunction( const LabelType * buffer, size_t rowLength, OffsetType * rowOffsets )
+      : m_Buffer( buffer ), m_RowLength( rowLength ), m_RowOffsets( rowOffsets ) {}
+
+    void operator()( size_t beginRow, size_t endRow ) const
+      {
+      for( size_t r = beginRow; r < endRow; ++r )
+        {
+        const LabelType * row = m_Buffer + r * m_RowLength;
+        OffsetType numberOfRuns = 0;
+        for( size_t x = 0; x < m_RowLength; ++x )
+          {
+          if( row[x] != LabelType(0) && ( x == 0 || row[x] != row[x-1] ) )
+            {
+            ++numberOfRuns;
+            }
+          }
+        m_RowOffsets[r+1] = numberOfRuns;
+        }
+      }
+
+    const LabelType * m_Buffer;
+    size_t            m_RowLength;
+    OffsetType *      m_RowOffsets;
+  };
+
+  struct EncodeFunction
+  {
+    EncodeFunction( const LabelType * buffer, size_t rowLength, const OffsetType * rowOffsets,
+                    RunType * starts, RunType * lengths, LabelType * labels )
+      : m_Buffer( buffer ), m_RowLength( rowLength ), m_RowOffsets( rowOffsets ),
+        m_Starts( starts ), m_Lengths( lengths ), m_Labels( labels ) {}
+
+    void operator()( size_t beginRow, size_t endRow ) const
+      {
+      for( size_t r = beginRow; r < endRow; ++r )
+        {
+        const LabelType * row = m_Buffer + r * m_RowLength;
+        OffsetType run = m_RowOffsets[r];
+        size_t x = 0;
+        while( x < m_RowLength )
+          {
+          const LabelType label = row[x];
+          size_t end = x + 1;
+          while( end < m_RowLength && row[end] == label )
+            {
+            ++end;
+            }
+          if( label != LabelType(0) )
+            {
+            m_Starts[run]  = static_cast< RunType >( x );
+            m_Lengths[run] = static_cast< RunType >( end - x );
+            m_Labels[run]  = label;
+            ++run;
+            }
+          x = end;
+          }
+        }
+      }
+
+    const LabelType *  m_Buffer;
+    size_t             m_RowLength;
+    const OffsetType * m_RowOffsets;
+    RunType *          m_Starts;
+    RunType *          m_Lengths;
+    LabelType *        m_Labels;
+  };
+
+  struct DecodeFunction
+  {
+    DecodeFunction( const OffsetType * rowOffsets, const RunType * starts, const RunType * lengths,
+                    const LabelType * labels, size_t rowBegin, size_t rowLength, LabelType * output )
+      : m_RowOffsets( rowOffsets ), m_Starts( starts ), m_Lengths( lengths ), m_Labels( labels ),
+        m_RowBegin( rowBegin ), m_RowLength( rowLength ), m_Output( output ) {}
+
+    void operator()( size_t begin, size_t end ) const
+      {
+      std::fill( m_Output + begin * m_RowLength, m_Output + end * m_RowLength, LabelType(0) );
+      for( size_t r = begin; r < end; ++r )
+        {
+        LabelType * row = m_Output + r * m_RowLength;
+        for( OffsetType run = m_RowOffsets[m_RowBegin + r]; run < m_RowOffsets[m_RowBegin + r + 1]; ++run )
+          {
+          const size_t start = std::min( size_t( m_Starts[run] ), m_RowLength );
+          const size_t stop  = std::min( start + m_Lengths[run], m_RowLength );
+          std::fill( row + start, row + stop, m_Labels[run] );
+          }
+        }
+      }
+
+    const OffsetType * m_RowOffsets;
+    const RunType *    m_Starts;
+    const RunType *    m_Lengths;
+    const LabelType *  m_Labels;
+    size_t             m_RowBegin;
+    size_t             m_RowLength;
+    LabelType *        m_Output;
+  };
+};
+
+} // namespace simple
+} // namespace itk
+
+#endif // __sitkRunLengthEncoding_h
@@ -0,0 +1,341 @@
+/*=========================================================================
+*
+*  Copyright Insight Software Consortium
+*
+*  Licensed under the Apache License, Version 2.0 (the "License");
+*  you may not use this file except in compliance with the License.
+*  You may obtain a copy of the License at
+*
+*         http://www.apache.org/licenses/LICENSE-2.0.txt
+*
+*  Unless required by applicable law or agreed to in writing, software
+*  distributed under the License is distributed on an "AS IS" BASIS,
+*  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+*  See the License for the specific language governing permissions and
+*  limitations under the License.
+*
+*=========================================================================*/
+#include "sitkSharedMemoryImage.h"
+#include "sitkPixelIDDispatchTable.h"
+#include "sitkMacro.h"
+
+#include "itkCommand.h"
+
+#include <string.h>
+
+#include <sstream>
+
+#ifndef _WIN32
+#include <errno.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+namespace itk
+{
+namespace simple
+{
+
+#ifndef _WIN32
+
+namespace
+{
+
+const char         SharedMemoryMagic[8]          = { 'S', 'I', 'T', 'K', 'S', 'H', 'M', '1' };
+const unsigned int SharedMemoryMaximumDimension  = 8;
+const size_t       SharedMemoryBufferAlignment   = 64;
+
+/** The layout of the beginning of a shared memory segment, followed
+ * by the pixel buffer at BufferOffset. */
+struct SharedMemoryHeader
+{
+  char             Magic[8];
+  uint32_t         HeaderSize;
+  int32_t          PixelID;
+  uint32_t         Dimension;
+  uint32_t         NumberOfComponents;
+  uint64_t         Size[SharedMemoryMaximumDimension];
+  double           Origin[SharedMemoryMaximumDimension];
+  double           Spacing[SharedMemoryMaximumDimension];
+  double           Direction[SharedMemoryMaximumDimension*SharedMemoryMaximumDimension];
+  uint64_t         BufferOffset;
+  uint64_t         BufferSize;
+
+  /** The number of pixel containers, in all processes, which use the
+   * segment. */
+  volatile int32_t ReferenceCount;
+};
+
+std::string GetSharedMemoryName( const std::string & name )
+{
+  if( name.empty() || name[0] != '/' )
+    {
+    return "/" + name;
+    }
+  return name;
+}
+
+/** \class SharedMemoryDetachCommand
+ * \brief Unmaps a shared memory segment when the pixel container which
+ * uses it is deleted, and removes the segment with the last user.
+ */
+class SharedMemoryDetachCommand
+  : public ::itk::Command
+{
+public:
+  typedef SharedMemoryDetachCommand Self;
+  typedef ::itk::Command            Superclass;
+  typedef SmartPointer< Self >      Pointer;
+
+  itkNewMacro( Self );
+
+  void SetSegment( const std::string & name, void * address, size_t length )
+    {
+    m_Name    = name;
+    m_Address = address;
+    m_Length  = length;
+    }
+
+  virtual void Execute( ::itk::Object *, const EventObject & )
+    {
+    this->Detach();
+    }
+
+  virtual void Execute( const ::itk::Object *, const EventObject & )
+    {
+    this->Detach();
+    }
+
+protected:
+  SharedMemoryDetachCommand( void ) : m_Address( NULL ), m_Length( 0 ) {}
+
+  // the segment is released even if the command was never attached
+  ~SharedMemoryDetachCommand( void )
+    {
+    this->Detach();
+    }
+
+private:
+  SharedMemoryDetachCommand( const Self & );
+  void operator=( const Self & );
+
+  void Detach( void )
+    {
+    if( !m_Address )
+      {
+      return;
+      }
+    SharedMemoryHeader * header = static_cast< SharedMemoryHeader * >( m_Address );
+    if( __sync_sub_and_fetch( &header->ReferenceCount, 1 ) == 0 )
+      {
+      shm_unlink( m_Name.c_str() );
+      }
+    munmap( m_Address, m_Length );
+    m_Address = NULL;
+    }
+
+  std::string m_Name;
+  void *      m_Address;
+  size_t      m_Length;
+};
+
+/** Returns an image of the buffer of a mapped segment, which is owned
+ * by the image from then on. */
+Image ImportSharedMemory( const std::string & name, void * address, size_t length )
+{
+  SharedMemoryDetachCommand::Pointer command = SharedMemoryDetachCommand::New();
+  command->SetSegment( name, address, length );
+
+  const SharedMemoryHeader * header = static_cast< const SharedMemoryHeader * >( address );
+  const PixelIDDispatchEntry * entry = PixelIDDispatchTable::GetEntry( header->PixelID, header->Dimension );
+  std::vector< unsigned int > size( header->Size, header->Size + header->Dimension );
+
+  Image * sitkImage = entry->ImportBuffer( static_cast< char * >( address ) + header->BufferOffset,
+                                           size,
+                                           header->NumberOfComponents,
+                                           command.GetPointer() );
+  const unsigned int dimension = header->Dimension;
+  sitkImage->SetOrigin( std::vector< double >( header->Origin, header->Origin + dimension ) );
+  sitkImage->SetSpacing( std::vector< double >( header->Spacing, header->Spacing + dimension ) );
+  sitkImage->SetDirection( std::vector< double >( header->Direction, header->Direction + dimension*dimension ) );
+
+  Image image( *sitkImage );
+  delete sitkImage;
+  return image;
+}
+
+/** Creates and maps a new segment for an image of the size, with the
+ * pixel type and geometry of the reference image. The pixels are
+ * copied into the segment if given. */
+Image CreateSharedMemory( const std::string & name,
+                          const Image & reference,
+                          const std::vector< unsigned int > & size,
+                          const void * pixels )
+{
+  const std::string shmName = GetSharedMemoryName( name );
+  const unsigned int dimension = reference.GetDimension();
+  const PixelIDDispatchEntry * entry = PixelIDDispatchTable::GetEntry( reference.GetPixelIDValue(), dimension );
+  if( !entry || dimension > SharedMemoryMaximumDimension )
+    {
+    sitkExceptionMacro( << "The pixel type " << reference.GetPixelIDTypeAsString()
+                        << " is not supported for shared memory images." );
+    }
+
+  const unsigned int numberOfComponents = reference.GetNumberOfComponentsPerPixel();
+  uint64_t bufferSize = entry->ComponentSize * numberOfComponents;
+  for( unsigned int d = 0; d < dimension; ++d )
+    {
+    bufferSize *= size[d];
+    }
+  const uint64_t bufferOffset = ( sizeof( SharedMemoryHeader ) + SharedMemoryBufferAlignment - 1 )
+    / SharedMemoryBufferAlignment * SharedMemoryBufferAlignment;
+  const size_t length = static_cast< size_t >( bufferOffset + bufferSize );
+
+  const int fd = shm_open( shmName.c_str(), O_CREAT | O_EXCL | O_RDWR, S_IRUSR | S_IWUSR );
+  if( fd == -1 )
+    {
+    sitkExceptionMacro( << "Unable to create the shared memory segment \"" << shmName << "\": " << strerror( errno ) );
+    }
+  // the new segment is zero filled
+  void * address = MAP_FAILED;
+  if( ftruncate( fd, static_cast< off_t >( length ) ) == 0 )
+    {
+    address = mmap( NULL, length, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0 );
+    }
+  const int error = errno;
+  close( fd );
+  if( address == MAP_FAILED )
+    {
+    shm_unlink( shmName.c_str() );
+    sitkExceptionMacro( << "Unable to map the shared memory segment \"" << shmName << "\": " << strerror( error ) );
+    }
+
+  SharedMemoryHeader * header = static_cast< SharedMemoryHeader * >( address );
+  memcpy( header->Magic, SharedMemoryMagic, sizeof( header->Magic ) );
+  header->HeaderSize         = sizeof( SharedMemoryHeader );
+  header->PixelID            = reference.GetPixelIDValue();
+  header->Dimension          = dimension;
+  header->NumberOfComponents = numberOfComponents;
+  const std::vector< double > origin    = reference.GetOrigin();
+  const std::vector< double > spacing   = reference.GetSpacing();
+  const std::vector< double > direction = reference.GetDirection();
+  std::copy( size.begin(), size.end(), header->Size );
+  std::copy( origin.begin(), origin.end(), header->Origin );
+  std::copy( spacing.begin(), spacing.end(), header->Spacing );
+  std::copy( direction.begin(), direction.end(), header->Direction );
+  header->BufferOffset   = bufferOffset;
+  header->BufferSize     = bufferSize;
+  header->ReferenceCount = 1;
+
+  if( pixels )
+    {
+    memcpy( static_cast< char * >( address ) + bufferOffset, pixels, static_cast< size_t >( bufferSize ) );
+    }
+
+  return ImportSharedMemory( shmName, address, length );
+}
+
+} // end anonymous namespace
+
+
+Image CreateSharedMemoryImage( const std::string & name,
+                               const std::vector< unsigned int > & size,
+                               PixelIDValueEnum pixelID,
+                               unsigned int numberOfComponents )
+{
+  // a single pixel image of the type resolves the number of components
+  // and has the default geometry
+  const Image reference( std::vector< unsigned int >( size.size(), 1 ), pixelID, numberOfComponents );
+  return CreateSharedMemory( name, reference, size, NULL );
+}
+
+
+Image CreateSharedMemoryImage( const std::string & name, const Image & image )
+{
+  const PixelIDDispatchEntry * entry = PixelIDDispatchTable::GetEntry( image.GetPixelIDValue(), image.GetDimension() );
+  return CreateSharedMemory( name, image, image.GetSize(), entry ? entry->GetConstBuffer( image ) : NULL );
+}
+
+
+Image AttachSharedMemoryImage( const std::string & name )
+{
+  const std::string shmName = GetSharedMemoryName( name );
+
+  const int fd = shm_open( shmName.c_str(), O_RDWR, 0 );
+  if( fd == -1 )
+    {
+    sitkExceptionMacro( << "Unable to open the shared memory segment \"" << shmName << "\": " << strerror( errno ) );
+    }
+  struct stat status;
+  void * address = MAP_FAILED;
+  if( fstat( fd, &status ) == 0 && static_cast< size_t >( status.st_size ) >= sizeof( SharedMemoryHeader ) )
+    {
+    address = mmap( NULL, static_cast< size_t >( status.st_size ), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0 );
+    }
+  close( fd );
+  if( address == MAP_FAILED )
+    {
+    sitkExceptionMacro( << "Unable to map the shared memory segment \"" << shmName << "\"." );
+    }
+  const size_t length = static_cast< size_t >( status.st_size );
+
+  SharedMemoryHeader * header = static_cast< SharedMemoryHeader * >( address );
+  if( memcmp( header->Magic, SharedMemoryMagic, sizeof( header->Magic ) ) != 0
+      || header->HeaderSize != sizeof( SharedMemoryHeader )
+      || header->Dimension > SharedMemoryMaximumDimension
+      || header->BufferOffset + header->BufferSize > length
+      || !PixelIDDispatchTable::GetEntry( header->PixelID, header->Dimension ) )
+    {
+    munmap( address, length );
+    sitkExceptionMacro( << "The shared memory segment \"" << shmName << "\" is not a SimpleITK image." );
+    }
+
+  // a segment whose last user already detached may only be unlinked yet
+  int32_t count = header->ReferenceCount;
+  while( count > 0 )
+    {
+    const int32_t previous = __sync_val_compare_and_swap( &header->ReferenceCount, count, count + 1 );
+    if( previous == count )
+      {
+      break;
+      }
+    count = previous;
+    }
+  if( count <= 0 )
+    {
+    munmap( address, length );
+    sitkExceptionMacro( << "The shared memory segment \"" << shmName << "\" has been released." );
+    }
+
+  return ImportSharedMemory( shmName, address, length );
+}
+
+#else
+
+Image CreateSharedMemoryImage( const std::string &,
+                               const std::vector< unsigned int > &,
+                               PixelIDValueEnum,
+                               unsigned int )
+{
+  sitkExceptionMacro( << "Shared memory images are not supported on this platform." );
+}
+
+
+Image CreateSharedMemoryImage( const std::string &, const Image & )
+{
+  sitkExceptionMacro( << "Shared memory images are not supported on this platform." );
+}
+
+
+Image AttachSharedMemoryImage( const std::string & )
+{
+  sitkExceptionMacro( << "Shared memory images are not supported on this platform." );
+}
+
+#endif
+
+} // namespace simple
+} // namespace itk
@@ -0,0 +1,79 @@
+/*=========================================================================
+*
+*  Copyright Insight Software Consortium
+*
+*  Licensed under the Apache License, Version 2.0 (the "License");
+*  you may not use this file except in compliance with the License.
+*  You may obtain a copy of the License at
+*
+*         http://www.apache.org/licenses/LICENSE-2.0.txt
+*
+*  Unless required by applicable law or agreed to in writing, software
+*  distributed under the License is distributed on an "AS IS" BASIS,
+*  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+*  See the License for the specific language governing permissions and
+*  limitations under the License.
+*
+*=========================================================================*/
+#ifndef __sitkSharedMemoryImage_h
+#define __sitkSharedMemoryImage_h
+
+#include <string>
+#include <vector>
+
+#include "sitkImage.h"
+#include "sitkPixelIDValues.h"
+
+namespace itk
+{
+namespace simple
+{
+
+/** \brief Creates an image whose pixel buffer is a new named shared
+ * memory segment, initialized with zeros.
+ *
+ * Other processes get an image of the same pixels, without copying,
+ * with AttachSharedMemoryImage. The segment is removed when the last
+ * image or view of it, in any process, is deleted.
+ *
+ * The pixel type, size and the image geometry are stored in the
+ * segment when it is created, later changes of the geometry are not
+ * shared.
+ *
+ * \warning The pixels are only shared while the image is not shared
+ * with another SimpleITK image in the same process, e.g. a copy with
+ * the Image copy constructor or assignment, or the input held by a
+ * filter. The next write to either image then copies the pixels out
+ * of the segment, and the write is not seen by the other processes.
+ *
+ * For a vector pixel type, a numberOfComponents of 0 is the image
+ * dimension, as in the Image constructor.
+ *
+ * The name follows the POSIX shm_open conventions, a leading "/" is
+ * added if missing. Shared memory images are not supported on Windows.
+ */
+Image CreateSharedMemoryImage( const std::string & name,
+                               const std::vector< unsigned int > & size,
+                               PixelIDValueEnum pixelID,
+                               unsigned int numberOfComponents = 0 );
+
+/** \brief Creates a shared memory image with a copy of the pixels
+ * and the geometry of an image. */
+Image CreateSharedMemoryImage( const std::string & name, const Image & image );
+
+/** \brief Returns an image of the pixels of an existing shared memory
+ * segment, created with CreateSharedMemoryImage in any process.
+ *
+ * The pixels are not copied. An exception is thrown if there is no
+ * such segment, or if it has already been removed.
+ *
+ * \warning As for CreateSharedMemoryImage, a write to the image while
+ * it is shared with another SimpleITK image copies the pixels out of
+ * the segment.
+ */
+Image AttachSharedMemoryImage( const std::string & name );
+
+} // namespace simple
+} // namespace itk
+
+#endif // __sitkSharedMemoryImage_h